@@ -0,0 +1,202 @@
+#include "ChapterReader.h"
+#include <taglib/fileref.h>
+#include <taglib/tpropertymap.h>
+#include <taglib/mpegfile.h>
+#include <taglib/id3v2tag.h>
+#include <taglib/chapterframe.h>
+#include <algorithm>
+
+// ------------------- Expand -------------------
+std::vector<PlaylistEntry> ChapterReader::expand(const juce::File& file)
+{
+    if(file.hasFileExtension("cue"))
+        return parseCueSheet(file);
+
+    // album.flac + album.cue rips: the sibling sheet wins over embedded tags
+    auto sibling = file.withFileExtension("cue");
+    if(sibling.existsAsFile())
+    {
+        auto entries = parseCueText(sibling.loadFileAsString(), file.getParentDirectory(), file);
+        if(!entries.empty()) return entries;
+    }
+
+    auto entries = readEmbeddedChapters(file);
+    if(!entries.empty()) return entries;
+
+    PlaylistEntry plain;
+    plain.file = file;
+    return { plain };
+}
+
+// ------------------- Cue sheets -------------------
+std::vector<PlaylistEntry> ChapterReader::parseCueSheet(const juce::File& cueFile)
+{
+    return parseCueText(cueFile.loadFileAsString(), cueFile.getParentDirectory(), {});
+}
+
+std::vector<PlaylistEntry> ChapterReader::parseCueText(const juce::String& text, const juce::File& baseDirectory,
+                                                       const juce::File& fallbackAudioFile)
+{
+    std::vector<PlaylistEntry> entries;
+    juce::File currentFile = fallbackAudioFile;
+    juce::String albumPerformer;
+    PlaylistEntry* track = nullptr;
+
+    for(auto& rawLine : juce::StringArray::fromLines(text))
+    {
+        juce::StringArray tokens;
+        tokens.addTokens(rawLine.trim(), " \t", "\"");
+        tokens.removeEmptyStrings();
+        if(tokens.isEmpty()) continue;
+
+        auto keyword = tokens[0].toUpperCase();
+        auto argument = tokens[1].unquoted();
+
+        if(keyword == "FILE")
+        {
+            // Embedded sheets name the original rip; the audio they live in is what we play
+            auto named = baseDirectory.getChildFile(argument);
+            currentFile = named.existsAsFile() || fallbackAudioFile == juce::File() ? named : fallbackAudioFile;
+            track = nullptr;
+        }
+        else if(keyword == "TRACK")
+        {
+            PlaylistEntry e;
+            e.file = currentFile;
+            e.title = "Track " + argument;
+            e.artist = albumPerformer;
+            e.startTime = -1.0;
+            e.isVirtual = true;
+            entries.push_back(e);
+            track = &entries.back();
+        }
+        else if(keyword == "TITLE" && track != nullptr)
+            track->title = argument;
+        else if(keyword == "PERFORMER")
+        {
+            if(track != nullptr) track->artist = argument;
+            else albumPerformer = argument;
+        }
+        else if(keyword == "INDEX" && track != nullptr && tokens.size() >= 3)
+        {
+            // INDEX 01 is where the track starts; INDEX 00 (pregap) only counts if 01 is missing
+            int number = tokens[1].getIntValue();
+            if(number == 1 || (number == 0 && track->startTime < 0.0))
+                track->startTime = parseCueTime(tokens[2]);
+        }
+    }
+
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [](const PlaylistEntry& e){ return e.startTime < 0.0 || !e.file.existsAsFile(); }),
+                  entries.end());
+    closeRanges(entries);
+    return entries;
+}
+
+double ChapterReader::parseCueTime(const juce::String& text)
+{
+    juce::StringArray parts;
+    parts.addTokens(text, ":", "");
+    if(parts.size() != 3) return -1.0;
+
+    // Frames are 1/75 s, a whole number of samples at 44.1 and 48 kHz
+    return parts[0].getIntValue() * 60.0 + parts[1].getIntValue() + parts[2].getIntValue() / 75.0;
+}
+
+// ------------------- Embedded chapters -------------------
+std::vector<PlaylistEntry> ChapterReader::readEmbeddedChapters(const juce::File& audioFile)
+{
+    std::vector<PlaylistEntry> entries;
+    auto path = audioFile.getFullPathName().toStdString();
+
+    // ID3v2 CHAP frames (MP3 audiobooks and podcasts)
+    if(audioFile.hasFileExtension("mp3"))
+    {
+        TagLib::MPEG::File mpeg(path.c_str(), false);
+        if(mpeg.isValid() && mpeg.hasID3v2Tag())
+        {
+            for(auto* frame : mpeg.ID3v2Tag()->frameList("CHAP"))
+            {
+                auto* chapter = dynamic_cast<TagLib::ID3v2::ChapterFrame*>(frame);
+                if(chapter == nullptr) continue;
+
+                PlaylistEntry e;
+                e.file = audioFile;
+                e.startTime = chapter->startTime() / 1000.0;
+                e.isVirtual = true;
+                auto& titles = chapter->embeddedFrameList("TIT2");
+                e.title = titles.isEmpty() ? "Chapter " + juce::String((int)entries.size() + 1)
+                                           : juce::String(juce::CharPointer_UTF8(titles.front()->toString().toCString(true)));
+                entries.push_back(e);
+            }
+        }
+    }
+
+    // Vorbis-comment style CHAPTERxxx / CHAPTERxxxNAME tags and embedded CUESHEETs (FLAC, Ogg, M4B via property map)
+    if(entries.empty())
+    {
+        TagLib::FileRef f(path.c_str(), false);
+        if(f.isNull()) return entries;
+
+        auto properties = f.properties();
+        auto cueSheet = properties.find("CUESHEET");
+        if(cueSheet != properties.end() && !cueSheet->second.isEmpty())
+        {
+            juce::String text(juce::CharPointer_UTF8(cueSheet->second.toString("\n").toCString(true)));
+            return parseCueText(text, audioFile.getParentDirectory(), audioFile);
+        }
+
+        for(int i = 0; i < 1000; ++i)
+        {
+            auto key = "CHAPTER" + juce::String(i).paddedLeft('0', 3);
+            auto start = properties.find(key.toStdString());
+            if(start == properties.end())
+            {
+                if(i == 0) continue; // numbering may start at 000 or 001
+                break;
+            }
+
+            PlaylistEntry e;
+            e.file = audioFile;
+            e.startTime = parseChapterTime(juce::String(juce::CharPointer_UTF8(start->second.toString().toCString(true))));
+            e.isVirtual = true;
+            auto name = properties.find((key + "NAME").toStdString());
+            e.title = name != properties.end() ? juce::String(juce::CharPointer_UTF8(name->second.toString().toCString(true)))
+                                               : "Chapter " + juce::String(i);
+            if(e.startTime >= 0.0) entries.push_back(e);
+        }
+    }
+
+    closeRanges(entries);
+    return entries;
+}
+
+double ChapterReader::parseChapterTime(const juce::String& text)
+{
+    juce::StringArray parts;
+    parts.addTokens(text.trim(), ":", "");
+    if(parts.isEmpty() || parts.size() > 3) return -1.0;
+
+    double seconds = 0.0;
+    for(auto& p : parts)
+        seconds = seconds * 60.0 + p.getDoubleValue();
+    return seconds;
+}
+
+// ------------------- Helpers -------------------
+// Sorts each run of entries over the same file by start time and ends every entry where the next one begins
+void ChapterReader::closeRanges(std::vector<PlaylistEntry>& entries)
+{
+    for(auto run = entries.begin(); run != entries.end();)
+    {
+        auto runEnd = std::find_if(run, entries.end(), [&](const PlaylistEntry& e){ return e.file != run->file; });
+        std::stable_sort(run, runEnd, [](const PlaylistEntry& a, const PlaylistEntry& b){ return a.startTime < b.startTime; });
+        run = runEnd;
+    }
+
+    for(size_t i = 0; i < entries.size(); ++i)
+    {
+        bool hasNext = i + 1 < entries.size() && entries[i + 1].file == entries[i].file;
+        entries[i].endTime = hasNext ? entries[i + 1].startTime : -1.0;
+    }
+}
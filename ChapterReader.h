@@ -0,0 +1,26 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PlaylistEntry.h"
+#include <vector>
+
+// Turns a file the user opened into playlist entries.
+// .cue sheets (standalone, next to the audio file, or embedded as a CUESHEET tag)
+// and chapter tags read through TagLib become virtual tracks over one file;
+// anything else becomes a single plain entry.
+class ChapterReader
+{
+public:
+    static std::vector<PlaylistEntry> expand(const juce::File& file);
+
+    static std::vector<PlaylistEntry> parseCueSheet(const juce::File& cueFile);
+    static std::vector<PlaylistEntry> parseCueText(const juce::String& text, const juce::File& baseDirectory,
+                                                   const juce::File& fallbackAudioFile);
+    static std::vector<PlaylistEntry> readEmbeddedChapters(const juce::File& audioFile);
+
+    // Parses cue "MM:SS:FF" (75 frames per second) and "HH:MM:SS.mmm" chapter times
+    static double parseCueTime(const juce::String& text);
+    static double parseChapterTime(const juce::String& text);
+
+private:
+    static void closeRanges(std::vector<PlaylistEntry>& entries);
+};
@@ -0,0 +1,123 @@
+#include "ClockBridge.h"
+#include <cmath>
+
+ClockBridge::ClockBridge(double targetLatencySeconds)
+    : targetLatency(targetLatencySeconds),
+      capacity((int)(maxSampleRate * ringSeconds)),
+      fifo(capacity),
+      ring(numChannels, capacity),
+      scratch(numChannels, capacity)
+{
+    ring.clear();
+}
+
+void ClockBridge::setInputRate(double sampleRate)
+{
+    if(inputRate.exchange(sampleRate) != sampleRate)
+        resyncRequested.store(true);
+}
+
+void ClockBridge::prepareOutput(double sampleRate, int maximumBlockSize)
+{
+    outputRate = sampleRate;
+    resampled.setSize(numChannels, juce::jmax(1, maximumBlockSize));
+    resyncRequested.store(true);
+}
+
+ClockBridge::Stats ClockBridge::getStats() const
+{
+    Stats stats;
+    stats.driftPpm = driftPpm.load();
+    stats.bufferedMs = bufferedMs.load();
+    stats.underruns = underruns.load();
+    stats.overruns = overruns.load();
+    return stats;
+}
+
+// ------------------- Writer -------------------
+void ClockBridge::write(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const int available = bufferToFill.buffer->getNumChannels();
+    if(available == 0 || bufferToFill.numSamples <= 0) return;
+    if(fifo.getFreeSpace() < bufferToFill.numSamples)
+    {
+        overruns.fetch_add(1);
+        return;
+    }
+
+    auto scope = fifo.write(bufferToFill.numSamples);
+    for(int ch = 0; ch < numChannels; ++ch)
+    {
+        const float* source = bufferToFill.buffer->getReadPointer(juce::jmin(ch, available - 1), bufferToFill.startSample);
+        if(scope.blockSize1 > 0) ring.copyFrom(ch, scope.startIndex1, source, scope.blockSize1);
+        if(scope.blockSize2 > 0) ring.copyFrom(ch, scope.startIndex2, source + scope.blockSize1, scope.blockSize2);
+    }
+}
+
+// ------------------- Reader -------------------
+// Empties the ring from the reader's side, the only side allowed to consume it
+void ClockBridge::restart()
+{
+    fifo.finishedRead(fifo.getNumReady());
+    for(auto& interpolator : interpolators)
+        interpolator.reset();
+    priming = true;
+    filteredFill = 0.0;
+}
+
+void ClockBridge::read(float* const* outputs, int numOutputChannels, int numSamples)
+{
+    for(int ch = 0; ch < numOutputChannels; ++ch)
+        if(outputs[ch] != nullptr) juce::FloatVectorOperations::clear(outputs[ch], numSamples);
+
+    const double rateIn = inputRate.load();
+    if(rateIn <= 0.0 || outputRate <= 0.0 || numSamples > resampled.getNumSamples()) return;
+    if(resyncRequested.exchange(false)) restart();
+
+    const int ready = fifo.getNumReady();
+    const double fill = ready / rateIn;
+    bufferedMs.store(fill * 1000.0);
+    if(priming)
+    {
+        if(fill < targetLatency) return;
+        // Priming ends on a block edge, a few ms above the average fill; starting the filter
+        // there would make the controller chase that step and wind up the integral
+        priming = false;
+        filteredFill = targetLatency;
+    }
+
+    const double dt = numSamples / outputRate;
+    filteredFill += (fill - filteredFill) * dt / (fillSmoothingSeconds + dt);
+    const double error = filteredFill - targetLatency;
+    const double limit = maxCorrectionPpm * 1.0e-6;
+    // The integral only moves while the correction is within its limit
+    const double nextIntegral = juce::jlimit(-limit, limit, integral + integralGain * error * dt);
+    if(std::abs(proportionalGain * error + nextIntegral) <= limit)
+        integral = nextIntegral;
+    const double correction = juce::jlimit(-limit, limit, proportionalGain * error + integral);
+    const double ratio = rateIn / outputRate * (1.0 + correction);
+    driftPpm.store(integral * 1.0e6);
+
+    // The interpolator may take a sample or two more than ratio * numSamples
+    const int needed = (int)std::ceil(numSamples * ratio) + 4;
+    if(ready < needed)
+    {
+        underruns.fetch_add(1);
+        priming = true;
+        return;
+    }
+
+    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+    fifo.prepareToRead(needed, start1, size1, start2, size2);
+    int used = 0;
+    for(int ch = 0; ch < numChannels; ++ch)
+    {
+        scratch.copyFrom(ch, 0, ring, ch, start1, size1);
+        if(size2 > 0) scratch.copyFrom(ch, size1, ring, ch, start2, size2);
+        used = interpolators[(size_t)ch].process(ratio, scratch.getReadPointer(ch), resampled.getWritePointer(ch), numSamples);
+    }
+    fifo.finishedRead(juce::jmin(used, needed));
+
+    for(int ch = 0; ch < juce::jmin(numOutputChannels, numChannels); ++ch)
+        if(outputs[ch] != nullptr) juce::FloatVectorOperations::copy(outputs[ch], resampled.getReadPointer(ch), numSamples);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+// Carries audio from one device's clock to another's: the writer's callback pushes blocks
+// into a lock-free ring and the reader's callback pulls them out through a resampler.
+// - Two sound cards never run at exactly their nominal rates. So the resampling ratio is
+//   the nominal one, corrected by a PI controller that holds the ring at targetLatency.
+//   The correction the integral term settles on is the drift between the two clocks.
+// - Corrections are limited to maxCorrectionPpm: a few cents of pitch at most, far below
+//   what anyone hears, and enough for any crystal.
+// - The reader waits for the ring to reach targetLatency before it plays. If the ring runs
+//   dry, the reader plays silence, counts an underrun and waits again. A full ring drops the
+//   writer's block and counts an overrun. Neither side ever waits for the other.
+// write() and read() each belong to one thread; setInputRate() and prepareOutput() are
+// called before their side's callbacks start; the stats may be read from anywhere.
+class ClockBridge
+{
+public:
+    static constexpr int numChannels = 2;
+    static constexpr double maxSampleRate = 192000.0;
+    static constexpr double ringSeconds = 0.5;
+    static constexpr double maxCorrectionPpm = 1000.0;
+
+    struct Stats
+    {
+        double driftPpm = 0.0;   // positive when the reader's clock runs slow against the writer's
+        double bufferedMs = 0.0; // audio waiting in the ring
+        int underruns = 0, overruns = 0;
+    };
+
+    explicit ClockBridge(double targetLatencySeconds = 0.04);
+
+    // Writer side; a new rate empties the ring
+    void setInputRate(double sampleRate);
+    // Reader side; maximumBlockSize is the most read() will be asked for at once
+    void prepareOutput(double sampleRate, int maximumBlockSize);
+
+    // Writer thread. A mono block is written to both channels.
+    void write(const juce::AudioSourceChannelInfo& bufferToFill);
+    // Reader thread: fills numSamples of the first two channels and clears the rest
+    void read(float* const* outputs, int numOutputChannels, int numSamples);
+
+    Stats getStats() const;
+    double getTargetLatencySeconds() const { return targetLatency; }
+
+private:
+    // Smoothing of the fill level: the writer adds a whole block at a time, so the raw fill
+    // is a sawtooth the controller must not chase
+    static constexpr double fillSmoothingSeconds = 1.0;
+    // Critically damped; a new drift is measured to within a few ppm in under a minute
+    static constexpr double proportionalGain = 0.4; // correction per second of fill error
+    static constexpr double integralGain = 0.04;    // correction per second of error, per second
+
+    const double targetLatency;
+    const int capacity;
+    juce::AbstractFifo fifo;
+    juce::AudioBuffer<float> ring;
+    std::atomic<double> inputRate { 0.0 };
+    std::atomic<bool> resyncRequested { true };
+
+    // Reader state
+    double outputRate = 0.0;
+    juce::AudioBuffer<float> scratch, resampled;
+    std::array<juce::LagrangeInterpolator, numChannels> interpolators;
+    bool priming = true;
+    double filteredFill = 0.0;
+    double integral = 0.0;
+
+    std::atomic<double> driftPpm { 0.0 }, bufferedMs { 0.0 };
+    std::atomic<int> underruns { 0 }, overruns { 0 };
+
+    void restart();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ClockBridge)
+};
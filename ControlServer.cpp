@@ -0,0 +1,510 @@
+#include "ControlServer.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace
+{
+    juce::var makeObject(std::initializer_list<std::pair<const char*, juce::var>> properties)
+    {
+        auto* object = new juce::DynamicObject();
+        juce::var result(object);
+        for(auto& [name, value] : properties)
+            object->setProperty(name, value);
+        return result;
+    }
+
+    juce::var makeError(const juce::String& message)
+    {
+        return makeObject({ { "ok", false }, { "error", message } });
+    }
+
+    // A position further than this from where playback should have got to is a seek
+    constexpr double positionJumpSeconds = 0.5;
+    // While playing, the position is sent at least this often
+    constexpr double positionIntervalMs = 1000.0;
+    // Without a running audio device nothing is acknowledged; give up on commands this old
+    constexpr double acknowledgementTimeoutMs = 5000.0;
+    // A subscriber that stops reading is dropped once this much is waiting for it
+    constexpr size_t maxOutboxBytes = 1 << 20;
+    constexpr size_t maxLineBytes = 64 << 10;
+}
+
+// ------------------- Connection -------------------
+// One TCP client. Its thread reads command lines and writes whatever is queued for it.
+class ControlServer::Connection : public juce::Thread
+{
+public:
+    Connection(ControlServer& serverToUse, juce::StreamingSocket* socketToServe, int connectionId)
+        : juce::Thread("Control connection"), server(serverToUse), socket(socketToServe), id(connectionId)
+    {
+        startThread();
+    }
+
+    ~Connection() override
+    {
+        signalThreadShouldExit();
+        socket->close();
+        stopThread(2000);
+    }
+
+    int getId() const { return id; }
+    bool isSubscribed() const { return subscribed.load(); }
+    void setSubscribed(bool shouldBeSubscribed) { subscribed.store(shouldBeSubscribed); }
+    bool isFinished() const { return finished.load(); }
+
+    // Any thread
+    void send(const juce::var& message)
+    {
+        const juce::ScopedLock sl(outboxLock);
+        if(outbox.size() > maxOutboxBytes)
+        {
+            finished.store(true);
+            return;
+        }
+        outbox += juce::JSON::toString(message, true).toStdString();
+        outbox += '\n';
+    }
+
+private:
+    ControlServer& server;
+    std::unique_ptr<juce::StreamingSocket> socket;
+    const int id;
+    std::atomic<bool> subscribed { false }, finished { false };
+    juce::CriticalSection outboxLock;
+    std::string outbox;
+
+    void run() override
+    {
+        std::string received;
+        char buffer[4096];
+        while(!threadShouldExit() && !finished.load())
+        {
+            if(!flush()) break;
+            const int ready = socket->waitUntilReady(true, 10);
+            if(ready < 0) break;
+            if(ready == 0) continue;
+
+            const int n = socket->read(buffer, (int)sizeof(buffer), false);
+            if(n <= 0) break;
+            const double receivedMs = juce::Time::getMillisecondCounterHiRes();
+            received.append(buffer, (size_t)n);
+
+            for(auto end = received.find('\n'); end != std::string::npos; end = received.find('\n'))
+            {
+                auto line = juce::String::fromUTF8(received.data(), (int)end).trim();
+                received.erase(0, end + 1);
+                if(line.isNotEmpty()) send(server.handleLine(line, *this, receivedMs));
+            }
+            if(received.size() > maxLineBytes) break;
+        }
+        flush();
+        finished.store(true);
+    }
+
+    bool flush()
+    {
+        std::string data;
+        {
+            const juce::ScopedLock sl(outboxLock);
+            data.swap(outbox);
+        }
+        return data.empty() || socket->write(data.data(), (int)data.size()) == (int)data.size();
+    }
+};
+
+// ------------------- Commands and state -------------------
+const char* ControlServer::Command::getName(Type type)
+{
+    static constexpr const char* names[] = { "play", "pause", "toggle", "stop", "seek", "gain", "mute", "loop", "load", "queue" };
+    return type >= 0 && type < numTypes ? names[type] : "";
+}
+
+bool ControlServer::State::sameExceptPosition(const State& other) const
+{
+    return playing == other.playing && muted == other.muted && looping == other.looping
+        && length == other.length && gain == other.gain && track == other.track && queued == other.queued;
+}
+
+juce::var ControlServer::State::toVar() const
+{
+    return makeObject({ { "playing", playing }, { "position", position }, { "length", length }, { "gain", (double)gain },
+                        { "muted", muted }, { "looping", looping }, { "track", track }, { "queued", queued } });
+}
+
+bool ControlServer::parse(const juce::String& line, Command& command, juce::String& error)
+{
+    const auto trimmed = line.trim();
+    const auto word = trimmed.upToFirstOccurrenceOf(" ", false, false).toLowerCase();
+    const auto argument = trimmed.fromFirstOccurrenceOf(" ", false, false).trim();
+
+    int type = -1;
+    for(int t = 0; t < Command::numTypes; ++t)
+        if(word == Command::getName((Command::Type)t)) type = t;
+    if(type < 0)
+    {
+        error = "unknown command \"" + word + "\"";
+        return false;
+    }
+    command.type = (Command::Type)type;
+
+    switch(command.type)
+    {
+        case Command::seek:
+        case Command::gain:
+        {
+            const double value = argument.getDoubleValue();
+            if(argument.isEmpty() || !argument.containsOnly("0123456789.+-eE") || !std::isfinite(value))
+            {
+                error = word + " needs a number";
+                return false;
+            }
+            command.value = command.type == Command::gain ? juce::jlimit(0.0, 1.0, value) : juce::jmax(0.0, value);
+            return true;
+        }
+        case Command::mute:
+        case Command::loop:
+        {
+            const auto setting = argument.toLowerCase();
+            if(setting == "on" || setting == "1" || setting == "true") command.value = 1.0;
+            else if(setting == "off" || setting == "0" || setting == "false") command.value = 0.0;
+            else
+            {
+                error = word + " needs on or off";
+                return false;
+            }
+            return true;
+        }
+        case Command::load:
+        case Command::queue:
+            command.text = argument.unquoted();
+            if(command.text.isEmpty())
+            {
+                error = word + " needs a path or URL";
+                return false;
+            }
+            return true;
+        case Command::play:
+        case Command::pause:
+        case Command::toggle:
+        case Command::stop:
+        case Command::numTypes:
+            break;
+    }
+
+    if(argument.isNotEmpty())
+    {
+        error = word + " takes no argument";
+        return false;
+    }
+    return true;
+}
+
+// ------------------- Server -------------------
+ControlServer::ControlServer(PlayerAudio& playerToControl, Target& targetToUse)
+    : juce::Thread("Control server"), player(playerToControl), target(targetToUse)
+{
+}
+
+ControlServer::~ControlServer()
+{
+    signalThreadShouldExit();
+    listener.close();
+    stopThread(2000);
+    {
+        const juce::ScopedLock sl(connectionLock);
+        connections.clear();
+    }
+
+    oscReceiver.removeListener(this);
+    oscReceiver.disconnect();
+    stopTimer();
+    cancelPendingUpdate();
+}
+
+bool ControlServer::start(int tcp, int osc)
+{
+    if(tcp >= 0)
+    {
+        if(!listener.createListener(tcp, "127.0.0.1")) return false;
+        tcpPort = listener.getBoundPort();
+        startThread();
+    }
+
+    if(osc >= 0)
+    {
+        if(!oscSocket.bindToPort(osc, "127.0.0.1")) return false;
+        oscPort = oscSocket.getBoundPort();
+        if(!oscReceiver.connectToSocket(oscSocket)) return false;
+        oscReceiver.addListener(this);
+    }
+
+    startTimer(20);
+    return true;
+}
+
+void ControlServer::run()
+{
+    while(!threadShouldExit())
+    {
+        if(listener.waitUntilReady(true, 100) != 1) continue;
+        auto* socket = listener.waitForNextConnection();
+        if(socket == nullptr) continue;
+
+        const juce::ScopedLock sl(connectionLock);
+        for(int i = connections.size(); --i >= 0;)
+            if(connections[i]->isFinished()) connections.remove(i);
+        connections.add(new Connection(*this, socket, nextConnectionId++));
+        connectionsMetric.set(connections.size());
+    }
+}
+
+// ------------------- Network threads -------------------
+juce::var ControlServer::handleLine(const juce::String& line, Connection& connection, double receivedMs)
+{
+    const auto word = line.upToFirstOccurrenceOf(" ", false, false).toLowerCase();
+    if(word == "subscribe" || word == "unsubscribe" || word == "state")
+    {
+        if(word != "state") connection.setSubscribed(word == "subscribe");
+        const juce::ScopedLock sl(stateLock);
+        return makeObject({ { "ok", true }, { "state", latestState.toVar() } });
+    }
+    if(word == "stats")
+    {
+        auto stats = getLatencyStats();
+        return makeObject({ { "ok", true }, { "stats", makeObject({ { "count", stats.count }, { "p50Ms", stats.p50Ms },
+                                                                    { "p99Ms", stats.p99Ms }, { "maxMs", stats.maxMs } }) } });
+    }
+
+    Command command;
+    juce::String error;
+    if(!parse(line, command, error))
+    {
+        rejectedMetric.add(1.0);
+        return makeError(error);
+    }
+    command.connection = connection.getId();
+    command.receivedMs = receivedMs;
+    return accept(command);
+}
+
+// Arguments become the rest of a text command, so both transports share parse()
+void ControlServer::oscMessageReceived(const juce::OSCMessage& message)
+{
+    const double receivedMs = juce::Time::getMillisecondCounterHiRes();
+    const auto address = message.getAddressPattern().toString();
+    if(!address.startsWith("/player/"))
+    {
+        rejectedMetric.add(1.0);
+        return;
+    }
+
+    juce::String line = address.fromFirstOccurrenceOf("/player/", false, false);
+    for(auto& argument : message)
+    {
+        if(argument.isFloat32()) line << " " << argument.getFloat32();
+        else if(argument.isInt32()) line << " " << argument.getInt32();
+        else if(argument.isString()) line << " " << argument.getString();
+    }
+
+    if(line.startsWith("subscribe ") || line.startsWith("unsubscribe "))
+    {
+        const int port = line.fromFirstOccurrenceOf(" ", false, false).getIntValue();
+        const juce::ScopedLock sl(connectionLock);
+        const auto existing = std::find(oscSubscriberPorts.begin(), oscSubscriberPorts.end(), port);
+        if(existing != oscSubscriberPorts.end())
+        {
+            oscSubscribers.erase(oscSubscribers.begin() + (existing - oscSubscriberPorts.begin()));
+            oscSubscriberPorts.erase(existing);
+        }
+        if(line.startsWith("subscribe ") && port > 0)
+        {
+            auto sender = std::make_unique<juce::OSCSender>();
+            if(sender->connect("127.0.0.1", port))
+            {
+                oscSubscribers.push_back(std::move(sender));
+                oscSubscriberPorts.push_back(port);
+            }
+        }
+        republish.store(true); // the new subscriber gets the whole state on the next update
+        return;
+    }
+
+    Command command;
+    juce::String error;
+    if(!parse(line, command, error))
+    {
+        rejectedMetric.add(1.0);
+        return;
+    }
+    command.receivedMs = receivedMs;
+    accept(command);
+}
+
+// The engine command is posted under pendingLock: update() takes acknowledgements before it
+// takes pending commands, so a command is always in awaiting before its acknowledgement is read
+juce::var ControlServer::accept(Command command)
+{
+    command.id = nextId++;
+    {
+        const juce::ScopedLock sl(pendingLock);
+        if(command.isEngineCommand())
+        {
+            PlayerAudio::EngineCommand engine;
+            engine.type = command.type == Command::gain ? PlayerAudio::EngineCommand::setGain
+                                                        : PlayerAudio::EngineCommand::setMuted;
+            engine.value = command.value;
+            engine.id = command.id;
+            engine.receivedMs = command.receivedMs;
+            if(!player.postCommand(engine))
+            {
+                rejectedMetric.add(1.0);
+                return makeError("engine queue full");
+            }
+        }
+        pending.push_back(command);
+    }
+
+    commandsMetric.add(1.0);
+    triggerAsyncUpdate();
+    return makeObject({ { "ok", true }, { "id", (int)command.id }, { "command", Command::getName(command.type) } });
+}
+
+// ------------------- Message thread -------------------
+void ControlServer::update()
+{
+    const int numAcknowledged = player.takeAcknowledgements(acknowledgements.data(), (int)acknowledgements.size());
+
+    std::vector<Command> commands;
+    {
+        const juce::ScopedLock sl(pendingLock);
+        commands.swap(pending);
+    }
+
+    for(auto& command : commands)
+    {
+        const bool done = target.handleControlCommand(command);
+        const juce::String name = Command::getName(command.type);
+        if(!done)
+        {
+            publishApplied(command, makeObject({ { "event", "failed" }, { "id", (int)command.id }, { "command", name } }));
+            continue;
+        }
+
+        bool measured = command.isEngineCommand();
+        if(!measured && command.type != Command::load && command.type != Command::queue)
+        {
+            PlayerAudio::EngineCommand measure;
+            measure.id = command.id;
+            measure.receivedMs = command.receivedMs;
+            measured = player.postCommand(measure);
+        }
+
+        if(measured) awaiting[command.id] = command;
+        else publishApplied(command, makeObject({ { "event", "applied" }, { "id", (int)command.id }, { "command", name } }));
+    }
+
+    for(int i = 0; i < numAcknowledged; ++i)
+    {
+        const auto& acknowledgement = acknowledgements[(size_t)i];
+        auto it = awaiting.find(acknowledgement.id);
+        if(it == awaiting.end()) continue;
+
+        recordLatency(acknowledgement.latencyMs);
+        publishApplied(it->second, makeObject({ { "event", "applied" }, { "id", (int)acknowledgement.id },
+                                                { "command", Command::getName(it->second.type) },
+                                                { "latencyMs", acknowledgement.latencyMs } }));
+        awaiting.erase(it);
+    }
+
+    const double now = juce::Time::getMillisecondCounterHiRes();
+    for(auto it = awaiting.begin(); it != awaiting.end();)
+    {
+        // The device is stopped, or the acknowledgement was dropped because its FIFO was full
+        if(now - it->second.receivedMs <= acknowledgementTimeoutMs) { ++it; continue; }
+
+        publishApplied(it->second, makeObject({ { "event", "failed" }, { "id", (int)it->second.id },
+                                                { "command", Command::getName(it->second.type) }, { "reason", "timeout" } }));
+        it = awaiting.erase(it);
+    }
+
+    // State: on any change, on a jump in position, and every second while playing
+    const auto state = target.getControlState();
+    {
+        const juce::ScopedLock sl(stateLock);
+        latestState = state;
+    }
+
+    const double expected = published.position + (published.playing ? (now - publishedMs) / 1000.0 : 0.0);
+    if(republish.exchange(false) || !hasPublished || !state.sameExceptPosition(published) || std::abs(state.position - expected) > positionJumpSeconds
+       || (state.playing && now - publishedMs >= positionIntervalMs))
+    {
+        publishState(state);
+        published = state;
+        publishedMs = now;
+        hasPublished = true;
+    }
+}
+
+void ControlServer::recordLatency(double ms)
+{
+    latencyMetric.set(ms);
+    const juce::ScopedLock sl(statsLock);
+    latencies[(size_t)nextLatency] = ms;
+    nextLatency = (nextLatency + 1) % latencyHistory;
+    numLatencies = juce::jmin(numLatencies + 1, latencyHistory);
+}
+
+ControlServer::LatencyStats ControlServer::getLatencyStats() const
+{
+    std::vector<double> sorted;
+    {
+        const juce::ScopedLock sl(statsLock);
+        sorted.assign(latencies.begin(), latencies.begin() + numLatencies);
+    }
+
+    LatencyStats stats;
+    stats.count = (int)sorted.size();
+    if(sorted.empty()) return stats;
+    std::sort(sorted.begin(), sorted.end());
+    stats.p50Ms = sorted[sorted.size() / 2];
+    stats.p99Ms = sorted[juce::jmin(sorted.size() - 1, sorted.size() * 99 / 100)];
+    stats.maxMs = sorted.back();
+    return stats;
+}
+
+void ControlServer::sendTo(int connection, const juce::var& message)
+{
+    const juce::ScopedLock sl(connectionLock);
+    for(auto* c : connections)
+        if(c->getId() == connection) c->send(message);
+}
+
+void ControlServer::publishState(const State& state)
+{
+    auto event = state.toVar();
+    event.getDynamicObject()->setProperty("event", "state");
+
+    const juce::ScopedLock sl(connectionLock);
+    for(auto* c : connections)
+        if(c->isSubscribed()) c->send(event);
+
+    for(auto& sender : oscSubscribers)
+        sender->send("/player/state", (juce::int32)state.playing, (float)state.position, (float)state.length, state.gain,
+                     (juce::int32)state.muted, (juce::int32)state.looping, state.track, (juce::int32)state.queued);
+}
+
+// TCP commands are answered on their own connection; OSC ones go to every OSC subscriber
+void ControlServer::publishApplied(const Command& command, const juce::var& message)
+{
+    if(command.connection >= 0)
+    {
+        sendTo(command.connection, message);
+        return;
+    }
+
+    const juce::ScopedLock sl(connectionLock);
+    for(auto& sender : oscSubscribers)
+        sender->send("/player/" + message["event"].toString(), (juce::int32)command.id, juce::String(Command::getName(command.type)),
+                     (float)(double)message.getProperty("latencyMs", -1.0));
+}
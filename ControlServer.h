@@ -0,0 +1,155 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PlayerAudio.h"
+#include "Metrics.h"
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Lets automation on this machine drive the player.
+// - TCP on 127.0.0.1: one command per line ("seek 12.5"). Every line is answered with one
+//   JSON object per line. After "subscribe", the connection also receives every state change.
+// - OSC over UDP on 127.0.0.1: /player/<command> with the same arguments.
+//   "/player/subscribe <port>" sends /player/state and /player/applied to 127.0.0.1:<port>.
+// Commands: play, pause, toggle, stop, seek <seconds into the file>, gain <0..1>,
+// mute <on|off>, loop <on|off>, load <path|URL>, queue <path|URL>, state, stats,
+// subscribe, unsubscribe.
+// Gain and mute go straight from the network thread to the audio thread through
+// PlayerAudio::postCommand(). The other commands need the message thread, because they
+// touch the playlist, because the transport's stop() waits for the audio thread, or, for a
+// seek, because the read-ahead buffer locks and wakes its thread when it is repositioned.
+// There they go to the Target, and a measuring command follows them to the audio thread.
+// For both paths, the time from a command's arrival to the end of the first block that
+// plays its result is sent back as an "applied" event. It is also kept for "stats" and
+// exported as metrics. Load and queue are acknowledged once the playlist has taken them;
+// the new track shows up in the state feed when it starts. A command the audio thread has
+// not acknowledged within 5 s gets a "failed" event with reason "timeout" instead.
+class ControlServer : private juce::Thread,
+                      private juce::OSCReceiver::Listener<juce::OSCReceiver::RealtimeCallback>,
+                      private juce::AsyncUpdater,
+                      private juce::Timer
+{
+public:
+    struct Command
+    {
+        enum Type { play, pause, toggle, stop, seek, gain, mute, loop, load, queue, numTypes };
+        Type type = play;
+        double value = 0.0;
+        juce::String text; // path or URL for load and queue
+        juce::uint32 id = 0;
+        double receivedMs = 0.0;
+        int connection = -1; // TCP connection it came from, -1 for OSC
+
+        // Applied by the audio thread without going through the Target first
+        bool isEngineCommand() const { return type == gain || type == mute; }
+        static const char* getName(Type type);
+    };
+
+    struct State
+    {
+        bool playing = false, muted = false, looping = false;
+        double position = 0.0, length = 0.0; // seconds into the open file
+        float gain = 1.0f;
+        juce::String track;
+        int queued = 0; // playlist entries after the current one
+
+        bool sameExceptPosition(const State& other) const;
+        juce::var toVar() const;
+    };
+
+    // Whoever owns the playlist; called on the message thread only
+    class Target
+    {
+    public:
+        virtual ~Target() = default;
+        // Gain and mute have already reached the audio engine, so for those only the
+        // controls showing them need to follow. False if the command could not be carried out.
+        virtual bool handleControlCommand(const Command& command) = 0;
+        virtual State getControlState() = 0;
+    };
+
+    struct LatencyStats
+    {
+        int count = 0; // commands measured, at most the last latencyHistory
+        double p50Ms = 0.0, p99Ms = 0.0, maxMs = 0.0;
+    };
+
+    static constexpr int latencyHistory = 1024;
+
+    ControlServer(PlayerAudio& player, Target& target);
+    ~ControlServer() override;
+
+    // 0 picks a free port and -1 leaves that transport off; false if a port can't be opened
+    bool start(int tcpPort, int oscPort = -1);
+    int getTcpPort() const { return tcpPort; }
+    int getOscPort() const { return oscPort; }
+
+    LatencyStats getLatencyStats() const;
+
+    // Message thread: hands queued commands to the Target, reports acknowledgements and sends
+    // state changes. The async updater and a timer call it; tests may call it directly.
+    void update();
+
+    // One text command. Returns false, with a reason in error, if the line is not a command.
+    static bool parse(const juce::String& line, Command& command, juce::String& error);
+
+private:
+    class Connection;
+
+    PlayerAudio& player;
+    Target& target;
+    int tcpPort = -1, oscPort = -1;
+    juce::StreamingSocket listener;
+    juce::DatagramSocket oscSocket { false };
+    juce::OSCReceiver oscReceiver { "OSC control" };
+    std::atomic<juce::uint32> nextId { 1 };
+    std::atomic<int> nextConnectionId { 1 };
+
+    juce::CriticalSection connectionLock;
+    juce::OwnedArray<Connection> connections;
+    std::vector<std::unique_ptr<juce::OSCSender>> oscSubscribers;
+    std::vector<int> oscSubscriberPorts;
+
+    // Commands waiting for the message thread
+    juce::CriticalSection pendingLock;
+    std::vector<Command> pending;
+
+    // Message thread: commands waiting for their acknowledgement
+    std::map<juce::uint32, Command> awaiting;
+    std::array<PlayerAudio::Acknowledgement, 64> acknowledgements;
+    State published;
+    double publishedMs = 0.0;
+    bool hasPublished = false;
+    std::atomic<bool> republish { false }; // set when an OSC subscriber joins
+
+    // What "state" answers from a network thread
+    juce::CriticalSection stateLock;
+    State latestState;
+
+    mutable juce::CriticalSection statsLock;
+    std::array<double, latencyHistory> latencies {};
+    int numLatencies = 0, nextLatency = 0;
+
+    juce::SharedResourcePointer<Metrics> metrics;
+    Metrics::Value& commandsMetric = metrics->getCounter("player_control_commands_total", "Commands accepted by the control server");
+    Metrics::Value& rejectedMetric = metrics->getCounter("player_control_rejected_total", "Control lines that were not a command, or found the engine queue full");
+    Metrics::Value& latencyMetric = metrics->getGauge("player_control_latency_ms", "Arrival to first rendered block of the last control command");
+    Metrics::Value& connectionsMetric = metrics->getGauge("player_control_connections", "Open TCP control connections");
+
+    void run() override;
+    void oscMessageReceived(const juce::OSCMessage& message) override;
+    void handleAsyncUpdate() override { update(); }
+    void timerCallback() override { update(); }
+
+    // Network threads: returns the reply for the sender
+    juce::var accept(Command command);
+    juce::var handleLine(const juce::String& line, Connection& connection, double receivedMs);
+    void recordLatency(double ms);
+    void sendTo(int connection, const juce::var& message);
+    void publishState(const State& state);
+    void publishApplied(const Command& command, const juce::var& message);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ControlServer)
+};
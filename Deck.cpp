@@ -0,0 +1,284 @@
+#include "Deck.h"
+#include "Tracer.h"
+#include "RealtimeChecker.h"
+#include <cmath>
+
+namespace
+{
+    // Reads happen on the read-ahead thread; each refill of the transport's buffer is one
+    // trace span and adds to the decode throughput metrics
+    struct InstrumentedReaderSource : juce::AudioFormatReaderSource
+    {
+        InstrumentedReaderSource(juce::AudioFormatReader* reader, Metrics::Value& bytes, Metrics::Value& seconds)
+            : juce::AudioFormatReaderSource(reader, true), decodedBytes(bytes), decodeSeconds(seconds) {}
+
+        void getNextAudioBlock(const juce::AudioSourceChannelInfo& info) override
+        {
+            const Tracer::Span span("readerRead", "decode");
+            auto start = juce::Time::getHighResolutionTicks();
+            juce::AudioFormatReaderSource::getNextAudioBlock(info);
+            decodeSeconds.add(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start));
+            decodedBytes.add((double)info.numSamples * info.buffer->getNumChannels() * (double)sizeof(float));
+        }
+
+        Metrics::Value& decodedBytes;
+        Metrics::Value& decodeSeconds;
+    };
+}
+
+Deck::Deck(juce::TimeSliceThread* readAheadThreadToUse)
+    : readAheadThread(readAheadThreadToUse),
+      decodedBytes(metrics->getCounter("player_decoded_bytes_total", "Bytes of float PCM produced by the decoders")),
+      decodeSeconds(metrics->getCounter("player_decode_seconds_total", "Time spent decoding on the read-ahead thread"))
+{
+    prepare(512, 44100.0);
+}
+
+Deck::~Deck()
+{
+    transportSource.setSource(nullptr);
+}
+
+void Deck::prepare(int maximumBlockSize, double sampleRate, int numChannels)
+{
+    numChannels = juce::jmax(1, numChannels);
+    if(resampleSource == nullptr || scratch.getNumChannels() != numChannels)
+    {
+        resampleSource = std::make_unique<juce::ResamplingAudioSource>(&transportSource, false, numChannels);
+        resampleSource->setResamplingRatio(speed.load());
+    }
+
+    outputSampleRate = sampleRate;
+    transportSource.prepareToPlay(maximumBlockSize, sampleRate);
+    resampleSource->prepareToPlay(maximumBlockSize, sampleRate);
+    gainStage.prepare(maximumBlockSize, sampleRate);
+
+    capacity = juce::jmax(1, maximumBlockSize);
+    scratch.setSize(numChannels, capacity);
+    rampIndex.allocate((size_t)capacity, false);
+    fadeGains.allocate((size_t)capacity, false);
+    for(int i = 0; i < capacity; ++i)
+        rampIndex[i] = (float)(i + 1);
+}
+
+void Deck::release()
+{
+    resampleSource->releaseResources();
+    transportSource.releaseResources();
+}
+
+// ------------------- Loading -------------------
+bool Deck::load(std::unique_ptr<juce::AudioFormatReader> reader, const juce::File& sourceFile, bool fromNetwork)
+{
+    unload();
+    if(reader == nullptr) return false;
+
+    auto* thread = readAheadThread;
+    if(thread != nullptr && fromNetwork)
+    {
+        if(streamReadAheadThread == nullptr)
+        {
+            streamReadAheadThread = std::make_unique<juce::TimeSliceThread>("Stream read-ahead");
+            streamReadAheadThread->startThread(juce::Thread::Priority::high);
+        }
+        thread = streamReadAheadThread.get();
+    }
+
+    sourceSampleRate = reader->sampleRate;
+    readerSource.reset(new InstrumentedReaderSource(reader.release(), decodedBytes, decodeSeconds));
+    readerSource->setLooping(looping);
+    transportSource.setSource(readerSource.get(), thread != nullptr ? readAheadSamples : 0, thread, sourceSampleRate);
+    loadedFile = sourceFile;
+    return true;
+}
+
+double Deck::getReadAheadFill() const
+{
+    if(readerSource == nullptr || readAheadThread == nullptr || sourceSampleRate <= 0.0) return 0.0;
+    auto playing = transportSource.getCurrentPosition() * sourceSampleRate;
+    auto buffered = (double)readerSource->getNextReadPosition() - playing;
+    return juce::jlimit(0.0, 1.0, buffered / readAheadSamples);
+}
+
+int Deck::getReadAheadBytes() const
+{
+    if(readerSource == nullptr || readAheadThread == nullptr) return 0;
+    return readAheadSamples * (int)readerSource->getAudioFormatReader()->numChannels * (int)sizeof(float);
+}
+
+void Deck::unload()
+{
+    transportSource.stop();
+    transportSource.setSource(nullptr);
+    readerSource.reset();
+    loadedFile = juce::File();
+    sourceSampleRate = 0.0;
+}
+
+void Deck::start()
+{
+    transportSource.start();
+    ++startRequests; // after start(), so the audio thread can't miss it
+}
+
+void Deck::setPlaybackSpeed(float ratio)
+{
+    resampleSource->setResamplingRatio(ratio);
+    speed.store(ratio);
+}
+
+void Deck::setLooping(bool shouldLoop)
+{
+    looping = shouldLoop;
+    if(readerSource != nullptr) readerSource->setLooping(shouldLoop);
+}
+
+void Deck::setLoopRange(double startSeconds, double endSeconds)
+{
+    loopRangeEnd.store(0.0); // never leave a half-updated range where the audio thread can see it
+    loopRangeStart.store(startSeconds);
+    loopRangeEnd.store(endSeconds);
+}
+
+// Seek within the open reader; used to switch between virtual tracks of one file
+void Deck::setPositionInSamples(juce::int64 sourceSample)
+{
+    if(readerSource == nullptr || sourceSampleRate <= 0.0) return;
+    transportSource.setNextReadPosition(sourceToOutputSample(sourceSample, sourceSampleRate, outputSampleRate));
+}
+
+juce::int64 Deck::getPositionInSamples() const
+{
+    if(readerSource == nullptr || sourceSampleRate <= 0.0) return 0;
+    auto rate = outputSampleRate > 0.0 ? outputSampleRate : sourceSampleRate;
+    return outputToSourceSample(juce::roundToInt64(transportSource.getCurrentPosition() * rate), sourceSampleRate, outputSampleRate);
+}
+
+// The transport seeks its reader to (int64)(output * sourceRate / outputRate). Start from the
+// floor and step to the first output sample that lands on the cue, never the sample before it.
+juce::int64 Deck::sourceToOutputSample(juce::int64 sourceSample, double sourceRate, double outputRate)
+{
+    if(sourceRate <= 0.0 || outputRate <= 0.0 || sourceRate == outputRate) return sourceSample;
+
+    auto toSource = [=](juce::int64 output) { return (juce::int64)((double)output * sourceRate / outputRate); };
+    auto output = (juce::int64)std::floor((double)sourceSample * outputRate / sourceRate);
+    while(toSource(output) < sourceSample) ++output;
+    while(output > 0 && toSource(output - 1) >= sourceSample) --output;
+    return output;
+}
+
+// The transport reports its reader's position as (int64)(source * outputRate / sourceRate),
+// which rounds down; the first source sample reported at or after outputSample undoes that
+juce::int64 Deck::outputToSourceSample(juce::int64 outputSample, double sourceRate, double outputRate)
+{
+    if(sourceRate <= 0.0 || outputRate <= 0.0 || sourceRate == outputRate) return outputSample;
+
+    const double ratio = outputRate / sourceRate;
+    auto toOutput = [=](juce::int64 source) { return (juce::int64)((double)source * ratio); };
+    auto source = (juce::int64)std::floor((double)outputSample / ratio);
+    while(toOutput(source) < outputSample) ++source;
+    while(source > 0 && toOutput(source - 1) >= outputSample) --source;
+    return source;
+}
+
+// ------------------- Fades -------------------
+void Deck::requestFade(FadeRequest request, double seconds)
+{
+    pendingFadeSeconds.store(seconds);
+    pendingFade.store(request);
+    if(request == fadeInRequest) audible.store(true);
+}
+
+void Deck::applyPendingFade()
+{
+    auto request = pendingFade.exchange(noFadeRequest);
+    if(request == noFadeRequest) return;
+
+    // Reversing mid-fade carries on from the current gain: the two curves mirror each other
+    bool in = request == fadeInRequest;
+    if(in != fadingIn) fadeProgress = 1.0 - fadeProgress;
+    fadingIn = in;
+
+    double seconds = pendingFadeSeconds.load();
+    fadeStep = seconds > 0.0 ? 1.0 / (seconds * outputSampleRate) : 1.0;
+    if(seconds <= 0.0) fadeProgress = 1.0;
+    if(!fadingIn && fadeProgress >= 1.0) audible.store(false);
+}
+
+float Deck::fadeGainAt(double progress) const
+{
+    double angle = juce::MathConstants<double>::halfPi * juce::jlimit(0.0, 1.0, progress);
+    return (float)(fadingIn ? std::sin(angle) : std::cos(angle));
+}
+
+// ------------------- Rendering -------------------
+void Deck::renderAdding(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    applyPendingFade();
+
+    // Idle unless it was playing last block or start() was called since; the transport
+    // still gets the block after a stop, which is what lets stop() return
+    const auto starts = startRequests.load();
+    if(!wasPlaying && starts == handledStartRequests) return;
+    handledStartRequests = starts;
+    wasPlaying = transportSource.isPlaying();
+
+    for(int done = 0; done < bufferToFill.numSamples; done += capacity)
+        mixChunk(bufferToFill, done, juce::jmin(capacity, bufferToFill.numSamples - done));
+    applyLoopRange();
+}
+
+void Deck::applyLoopRange()
+{
+    const double end = loopRangeEnd.load();
+    const double start = loopRangeStart.load();
+    if(end > start && transportSource.getCurrentPosition() >= end)
+    {
+        const RealtimeChecker::ScopedKnownLock knownLock(RealtimeChecker::transportSeek);
+        transportSource.setPosition(start);
+    }
+}
+
+void Deck::mixChunk(const juce::AudioSourceChannelInfo& bufferToFill, int offset, int numSamples)
+{
+    juce::AudioSourceChannelInfo info(&scratch, 0, numSamples);
+    const bool shouldResample = speed.load() != 1.0f;
+    if(shouldResample && !resampling) resampleSource->flushBuffers(); // don't replay samples from before the bypass
+    resampling = shouldResample;
+
+    {
+        // The transport and its read-ahead buffer lock their own state for each block
+        const RealtimeChecker::ScopedKnownLock knownLock(RealtimeChecker::transportBlock);
+        if(resampling) resampleSource->getNextAudioBlock(info);
+        else transportSource.getNextAudioBlock(info);
+    }
+    if(!audible.load()) return; // faded out: the transport still runs so stop() is acknowledged
+
+    gainStage.process(info);
+
+    const int numChannels = juce::jmin(bufferToFill.buffer->getNumChannels(), scratch.getNumChannels());
+    const int start = bufferToFill.startSample + offset;
+    const float startGain = fadeGainAt(fadeProgress);
+
+    if(fadeProgress < 1.0)
+    {
+        // Equal-power curve, linear within the chunk: one multiply-add per channel
+        double endProgress = juce::jmin(1.0, fadeProgress + fadeStep * numSamples);
+        float endGain = fadeGainAt(endProgress);
+        juce::FloatVectorOperations::copyWithMultiply(fadeGains.get(), rampIndex.get(), (endGain - startGain) / (float)numSamples, numSamples);
+        juce::FloatVectorOperations::add(fadeGains.get(), startGain, numSamples);
+
+        for(int ch = 0; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::addWithMultiply(bufferToFill.buffer->getWritePointer(ch, start), scratch.getReadPointer(ch), fadeGains.get(), numSamples);
+
+        fadeProgress = endProgress;
+        if(!fadingIn && fadeProgress >= 1.0) audible.store(false);
+        return;
+    }
+
+    for(int ch = 0; ch < numChannels; ++ch)
+    {
+        if(startGain == 1.0f) juce::FloatVectorOperations::add(bufferToFill.buffer->getWritePointer(ch, start), scratch.getReadPointer(ch), numSamples);
+        else if(startGain != 0.0f) juce::FloatVectorOperations::addWithMultiply(bufferToFill.buffer->getWritePointer(ch, start), scratch.getReadPointer(ch), startGain, numSamples);
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <JuceHeader.h>
+#include "GainStage.h"
+#include "Metrics.h"
+#include <atomic>
+#include <memory>
+
+// One playing source: reader -> transport (with read-ahead) -> resampler -> gain -> fade.
+// The transport decodes on the shared read-ahead thread, so a deck that is loaded and
+// positioned before it starts has its first seconds decoded by the time it is heard.
+// Fades use equal-power curves, so a deck fading out and one fading in over the same
+// time keep the summed power constant.
+// A deck that is stopped or empty returns from renderAdding() after two atomic loads,
+// and the resampler is bypassed while the speed is 1.
+class Deck
+{
+public:
+    // Without a read-ahead thread the deck decodes on the thread that renders it, which
+    // makes offline renders deterministic
+    explicit Deck(juce::TimeSliceThread* readAheadThreadToUse);
+    ~Deck();
+
+    // numChannels is the output's: the deck renders that many, so nothing is folded away
+    void prepare(int maximumBlockSize, double sampleRate, int numChannels = 2);
+    void release();
+
+    // Message thread. A network stream's reads can block for seconds, so it is read ahead on
+    // a thread of this deck's own: a stalled download never starves the other decks.
+    bool load(std::unique_ptr<juce::AudioFormatReader> reader, const juce::File& sourceFile, bool fromNetwork = false);
+    void unload();
+    juce::File getLoadedFile() const { return loadedFile; }
+    bool isLoaded() const { return readerSource != nullptr; }
+    double getSourceSampleRate() const { return sourceSampleRate; }
+    // Share of the read-ahead buffer already decoded, 0..1
+    double getReadAheadFill() const;
+    int getReadAheadBytes() const;
+
+    void start();
+    void stop() { transportSource.stop(); }
+    bool isPlaying() const { return transportSource.isPlaying(); }
+    void setPosition(double seconds) { transportSource.setPosition(seconds); }
+    // In the source's samples. A cue lands exactly on its sample, never the one before it, and
+    // reads back unchanged when the source is upsampled (44.1 kHz on a 48 kHz device).
+    void setPositionInSamples(juce::int64 sourceSample);
+    juce::int64 getPositionInSamples() const;
+    // The conversions behind them, matched to the transport's own, which truncates both ways
+    static juce::int64 sourceToOutputSample(juce::int64 sourceSample, double sourceRate, double outputRate);
+    static juce::int64 outputToSourceSample(juce::int64 outputSample, double sourceRate, double outputRate);
+    double getCurrentPosition() const { return transportSource.getCurrentPosition(); }
+    double getLengthInSeconds() const { return transportSource.getLengthInSeconds(); }
+    void setPlaybackSpeed(float ratio);
+    void setGain(float gain) { gainStage.setGain(gain); }
+    void setNormalisationGain(float gain) { gainStage.setNormalisationGain(gain); }
+
+    // Whole-file looping happens in the reader and is sample-accurate; the A-B range is
+    // checked once per block on the audio thread
+    void setLooping(bool shouldLoop);
+    bool isLooping() const { return looping; }
+    void setLoopRange(double startSeconds, double endSeconds);
+    void clearLoopRange() { setLoopRange(0.0, 0.0); }
+
+    // A zero-length fade switches at the start of the next block
+    void fadeIn(double seconds) { requestFade(fadeInRequest, seconds); }
+    void fadeOut(double seconds) { requestFade(fadeOutRequest, seconds); }
+    // False once a fade-out has reached silence; the deck then costs nothing to render
+    bool isAudible() const { return audible.load(); }
+
+    // Audio thread: adds this deck's output on top of what is already in the buffer
+    void renderAdding(const juce::AudioSourceChannelInfo& bufferToFill);
+
+private:
+    enum FadeRequest { noFadeRequest, fadeInRequest, fadeOutRequest };
+
+    juce::TimeSliceThread* readAheadThread;
+    std::unique_ptr<juce::TimeSliceThread> streamReadAheadThread; // created by the first stream loaded
+    juce::SharedResourcePointer<Metrics> metrics;
+    Metrics::Value& decodedBytes;
+    Metrics::Value& decodeSeconds;
+    std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
+    juce::AudioTransportSource transportSource;
+    std::unique_ptr<juce::ResamplingAudioSource> resampleSource; // its channel count is fixed, so prepare() replaces it
+    GainStage gainStage;
+    juce::File loadedFile;
+    double sourceSampleRate = 0.0;
+    double outputSampleRate = 0.0;
+
+    std::atomic<int> pendingFade { noFadeRequest };
+    std::atomic<double> pendingFadeSeconds { 0.0 };
+    std::atomic<bool> audible { true };
+    std::atomic<float> speed { 1.0f };
+    std::atomic<double> loopRangeStart { 0.0 }, loopRangeEnd { 0.0 };
+    std::atomic<unsigned int> startRequests { 0 };
+    bool looping = false;
+
+    // Audio thread state; progress runs 0 -> 1 along the current fade
+    bool fadingIn = true;
+    double fadeProgress = 1.0;
+    double fadeStep = 0.0;
+    bool wasPlaying = false;
+    unsigned int handledStartRequests = 0;
+    bool resampling = false;
+
+    juce::AudioBuffer<float> scratch;
+    juce::HeapBlock<float> rampIndex, fadeGains;
+    int capacity = 0;
+
+    static constexpr int readAheadSamples = 65536;
+
+    void requestFade(FadeRequest request, double seconds);
+    void applyPendingFade();
+    float fadeGainAt(double progress) const;
+    void mixChunk(const juce::AudioSourceChannelInfo& bufferToFill, int offset, int numSamples);
+    void applyLoopRange();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Deck)
+};
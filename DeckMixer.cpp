@@ -0,0 +1,101 @@
+#include "DeckMixer.h"
+
+DeckMixer::DeckMixer(int numDecks, bool readAhead)
+{
+    for(int i = 0; i < juce::jmax(1, numDecks); ++i)
+        decks.add(new Deck(readAhead ? &readAheadThread : nullptr));
+    if(readAhead)
+        readAheadThread.startThread(juce::Thread::Priority::high);
+}
+
+DeckMixer::~DeckMixer()
+{
+    for(auto* deck : decks)
+        deck->unload();
+    readAheadThread.stopThread(2000);
+}
+
+void DeckMixer::prepare(int maximumBlockSize, double sampleRate, int numChannels)
+{
+    for(auto* deck : decks)
+        deck->prepare(maximumBlockSize, sampleRate, numChannels);
+}
+
+void DeckMixer::release()
+{
+    for(auto* deck : decks)
+        deck->release();
+}
+
+void DeckMixer::render(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    bufferToFill.clearActiveBufferRegion();
+    for(auto* deck : decks)
+        deck->renderAdding(bufferToFill);
+}
+
+int DeckMixer::findFreeDeck(int excluding) const
+{
+    for(int i = 0; i < decks.size(); ++i)
+        if(i != excluding && !decks[i]->isLoaded())
+            return i;
+    return -1;
+}
+
+// ------------------- Benchmark -------------------
+juce::String DeckMixer::runBenchmark()
+{
+    constexpr double rate = 48000.0;
+    constexpr int blockSize = 512;
+    constexpr double seconds = 10.0;
+    const int numBlocks = (int)(rate * seconds / blockSize);
+
+    // One second of noise as a WAV in memory; every deck gets its own reader over it
+    juce::MemoryBlock wav;
+    {
+        juce::AudioBuffer<float> noise(2, (int)rate);
+        juce::Random random(1);
+        for(int ch = 0; ch < 2; ++ch)
+            for(int i = 0; i < noise.getNumSamples(); ++i)
+                noise.setSample(ch, i, random.nextFloat() * 0.2f - 0.1f);
+
+        juce::WavAudioFormat format;
+        std::unique_ptr<juce::AudioFormatWriter> writer(format.createWriterFor(new juce::MemoryOutputStream(wav, false), rate, 2, 16, {}, 0));
+        writer->writeFromAudioSampleBuffer(noise, 0, noise.getNumSamples());
+    }
+
+    juce::String report;
+    report << "DeckMixer: stereo " << rate / 1000.0 << " kHz, " << blockSize << "-sample blocks, decoding 16-bit WAV in the callback\n";
+
+    juce::AudioBuffer<float> bus(2, blockSize);
+    juce::AudioSourceChannelInfo info(&bus, 0, blockSize);
+    double baseline = 0.0;
+    for(int active = 0; active <= defaultNumDecks; active = active == 0 ? 1 : active * 2)
+    {
+        DeckMixer mixer(defaultNumDecks, false);
+        mixer.prepare(blockSize, rate, 2);
+        juce::WavAudioFormat format;
+        for(int d = 0; d < active; ++d)
+        {
+            auto& deck = mixer.getDeck(d);
+            deck.load(std::unique_ptr<juce::AudioFormatReader>(format.createReaderFor(new juce::MemoryInputStream(wav, false), true)), {});
+            deck.setLooping(true);
+            deck.setPosition(d * 0.05); // decks at different points, as in a real mix
+            deck.start();
+        }
+
+        for(int i = 0; i < 20; ++i) mixer.render(info);
+
+        auto start = juce::Time::getHighResolutionTicks();
+        for(int i = 0; i < numBlocks; ++i)
+            mixer.render(info);
+        double elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        if(active == 0) baseline = elapsed;
+
+        report << juce::String(active).paddedLeft(' ', 2) << " decks: " << juce::String(100.0 * elapsed / seconds, 3) << "% of one core";
+        if(active > 0)
+            report << ", " << juce::String(1.0e6 * (elapsed - baseline) / (active * (double)numBlocks), 2) << " us per deck per block";
+        report << "\n";
+    }
+    return report;
+}
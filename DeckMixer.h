@@ -0,0 +1,40 @@
+#pragma once
+#include <JuceHeader.h>
+#include "Deck.h"
+
+// Hosts a fixed set of decks and sums them into the output. All decks are created up
+// front, so loading one never allocates on the audio thread. Each active deck adds its
+// block onto the bus with one vectorised multiply-add per channel; idle decks are
+// skipped, so the cost of a block grows with the number of decks actually playing.
+class DeckMixer
+{
+public:
+    static constexpr int defaultNumDecks = 16;
+
+    // readAhead false decodes on the rendering thread; see Deck
+    explicit DeckMixer(int numDecks = defaultNumDecks, bool readAhead = true);
+    ~DeckMixer();
+
+    void prepare(int maximumBlockSize, double sampleRate, int numChannels = 2);
+    void release();
+
+    // Audio thread: replaces the buffer's contents with the mix of all decks
+    void render(const juce::AudioSourceChannelInfo& bufferToFill);
+
+    int getNumDecks() const { return decks.size(); }
+    Deck& getDeck(int index) const { return *decks[index]; }
+
+    // First deck with nothing loaded, skipping one in use elsewhere; -1 if all are taken
+    int findFreeDeck(int excluding = -1) const;
+
+    // Renders 1..defaultNumDecks decks playing in-memory 16-bit stereo WAV at 48 kHz into a
+    // stereo bus, decoding on the rendering thread, and reports the share of one core each
+    // count needs and the cost per deck, which should stay flat as decks are added
+    static juce::String runBenchmark();
+
+private:
+    juce::TimeSliceThread readAheadThread { "Deck read-ahead" };
+    juce::OwnedArray<Deck> decks;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckMixer)
+};
@@ -0,0 +1,232 @@
+#include "FormatRegistry.h"
+#include <algorithm>
+#include <cstring>
+
+FormatRegistry::FormatRegistry()
+{
+    formatManager.registerBasicFormats();
+
+    // The registry is first created while the GUI is being built; the file is parsed off that
+    // thread, ahead of the reader opens that benefit from it
+    scheduler->submit(JobScheduler::currentTrack, cacheJobs, [this](const JobScheduler::Group&) { loadCache(); });
+}
+
+FormatRegistry::~FormatRegistry()
+{
+    cacheJobs->cancelAndWait();
+    saveCache();
+}
+
+// ------------------- Opening -------------------
+std::unique_ptr<juce::AudioFormatReader> FormatRegistry::createReaderFor(const juce::File& file)
+{
+    if(auto* cached = lookupCached(file))
+        if(auto reader = openWith(cached, file))
+            return reader;
+
+    auto stream = file.createInputStream();
+    if(stream == nullptr) return nullptr;
+
+    // Magic bytes first, reusing the stream that was sniffed
+    auto sniffed = sniffExtension(*stream);
+    auto* sniffedFormat = sniffed.isNotEmpty() ? formatManager.findFormatForFileExtension(sniffed) : nullptr;
+    if(sniffedFormat != nullptr)
+        if(auto* reader = sniffedFormat->createReaderFor(stream.release(), true))
+        {
+            remember(file, *sniffedFormat);
+            return std::unique_ptr<juce::AudioFormatReader>(reader);
+        }
+
+    // Then the name's own extension
+    auto* named = formatManager.findFormatForFileExtension(file.getFileExtension());
+    if(named != nullptr && named != sniffedFormat)
+        if(auto reader = openWith(named, file))
+        {
+            remember(file, *named);
+            return reader;
+        }
+
+    // Unknown header and extension: let every remaining format try
+    for(auto* format : formatManager)
+        if(format != sniffedFormat && format != named)
+            if(auto reader = openWith(format, file))
+            {
+                remember(file, *format);
+                return reader;
+            }
+    return nullptr;
+}
+
+// Same order as for files, but every format gets the one stream, rewound, and only keeps it on success
+std::unique_ptr<juce::AudioFormatReader> FormatRegistry::createReaderFor(std::unique_ptr<juce::InputStream> stream, const juce::String& fileName)
+{
+    if(stream == nullptr) return nullptr;
+    const auto start = stream->getPosition();
+
+    juce::Array<juce::AudioFormat*> candidates;
+    auto sniffed = sniffExtension(*stream);
+    if(sniffed.isNotEmpty()) candidates.addIfNotAlreadyThere(formatManager.findFormatForFileExtension(sniffed));
+    candidates.addIfNotAlreadyThere(formatManager.findFormatForFileExtension(fileName.fromLastOccurrenceOf(".", true, false)));
+    for(auto* format : formatManager) candidates.addIfNotAlreadyThere(format);
+
+    for(auto* format : candidates)
+    {
+        if(format == nullptr) continue;
+        stream->setPosition(start);
+        if(auto* reader = format->createReaderFor(stream.get(), false))
+        {
+            stream.release(); // the reader owns it now
+            return std::unique_ptr<juce::AudioFormatReader>(reader);
+        }
+    }
+    return nullptr;
+}
+
+std::unique_ptr<juce::AudioFormatReader> FormatRegistry::openWith(juce::AudioFormat* format, const juce::File& file)
+{
+    if(format == nullptr) return nullptr;
+    auto stream = file.createInputStream();
+    if(stream == nullptr) return nullptr;
+    return std::unique_ptr<juce::AudioFormatReader>(format->createReaderFor(stream.release(), true));
+}
+
+juce::String FormatRegistry::sniffExtension(juce::InputStream& stream)
+{
+    auto start = stream.getPosition();
+    juce::uint8 header[40] = {};
+    auto bytesRead = stream.read(header, (int)sizeof(header));
+    auto matches = [&](int offset, const char* magic)
+    {
+        auto length = (int)std::strlen(magic);
+        return bytesRead >= offset + length && std::memcmp(header + offset, magic, (size_t)length) == 0;
+    };
+
+    juce::String result;
+    if((matches(0, "RIFF") || matches(0, "RF64") || matches(0, "BW64")) && matches(8, "WAVE")) result = ".wav";
+    else if(matches(0, "FORM") && (matches(8, "AIFF") || matches(8, "AIFC"))) result = ".aiff";
+    else if(matches(0, "fLaC")) result = ".flac";
+    else if(matches(0, "OggS") && matches(29, "vorbis")) result = ".ogg";
+    else if(matches(4, "ftyp")) result = ".m4a";
+    else if(matches(0, "ID3") && bytesRead >= 10)
+    {
+        // ID3v2 can sit in front of MP3 and (rarely) FLAC; look at what follows the tag
+        auto tagSize = ((header[6] & 0x7f) << 21) | ((header[7] & 0x7f) << 14) | ((header[8] & 0x7f) << 7) | (header[9] & 0x7f);
+        juce::uint8 next[4] = {};
+        stream.setPosition(start + 10 + tagSize + ((header[5] & 0x10) != 0 ? 10 : 0));
+        auto n = stream.read(next, 4);
+        result = (n == 4 && std::memcmp(next, "fLaC", 4) == 0) ? ".flac" : ".mp3";
+    }
+    else if(bytesRead >= 2 && header[0] == 0xff && (header[1] & 0xe0) == 0xe0) result = ".mp3";
+
+    stream.setPosition(start);
+    return result;
+}
+
+// ------------------- Per-file cache -------------------
+juce::AudioFormat* FormatRegistry::findFormatByName(const juce::String& name) const
+{
+    for(auto* format : formatManager)
+        if(format->getFormatName() == name)
+            return format;
+    return nullptr;
+}
+
+juce::AudioFormat* FormatRegistry::lookupCached(const juce::File& file)
+{
+    const juce::ScopedLock sl(lock);
+    auto it = cache.find(file.getFullPathName());
+    if(it == cache.end())
+    {
+        cacheMisses.add(1.0);
+        return nullptr;
+    }
+
+    if(it->second.size != file.getSize() || it->second.modified != file.getLastModificationTime().toMilliseconds())
+    {
+        cache.erase(it);
+        cacheChanged = true;
+        cacheMisses.add(1.0);
+        return nullptr;
+    }
+    cacheHits.add(1.0);
+    it->second.lastUsed = juce::Time::currentTimeMillis();
+    cacheChanged = true; // saved along with the next new entry, or on exit
+    return findFormatByName(it->second.formatName);
+}
+
+void FormatRegistry::remember(const juce::File& file, const juce::AudioFormat& format)
+{
+    const juce::ScopedLock sl(lock);
+    const auto path = file.getFullPathName();
+    if((int)cache.size() >= maxCacheEntries && cache.find(path) == cache.end())
+        cache.erase(std::min_element(cache.begin(), cache.end(), [](const auto& a, const auto& b)
+                                     { return a.second.lastUsed < b.second.lastUsed; }));
+
+    cache[path] = { file.getSize(), file.getLastModificationTime().toMilliseconds(), format.getFormatName(), juce::Time::currentTimeMillis() };
+    cacheChanged = true;
+    queueSave();
+}
+
+// New entries opened together (a folder added, a playlist scanned) share one save, written
+// once the scheduler has nothing more urgent, so a crash loses at most the latest batch
+void FormatRegistry::queueSave()
+{
+    if(saveQueued) return;
+    saveQueued = true;
+    scheduler->submit(JobScheduler::background, cacheJobs, [this](const JobScheduler::Group&) { saveCache(); });
+}
+
+// Scheduler thread. Files opened while it parsed are already in the map and newer, so they win.
+void FormatRegistry::loadCache()
+{
+    std::map<juce::String, CacheEntry> loaded;
+    auto parsed = juce::JSON::parse(cacheFile);
+    if(auto* list = parsed.getArray())
+        for(auto& item : *list)
+        {
+            auto path = item.getProperty("file", {}).toString();
+            if(path.isEmpty()) continue;
+            loaded[path] = { (juce::int64)item.getProperty("size", 0), (juce::int64)item.getProperty("modified", 0),
+                             item.getProperty("format", {}).toString(), (juce::int64)item.getProperty("used", 0) };
+        }
+
+    const juce::ScopedLock sl(lock);
+    for(auto& [path, entry] : loaded)
+        if((int)cache.size() < maxCacheEntries)
+            cache.emplace(path, entry);
+    cacheLoaded = true;
+    if(cacheChanged) queueSave(); // a save asked for while loading was skipped
+}
+
+void FormatRegistry::saveCache()
+{
+    juce::String json;
+    {
+        const juce::ScopedLock sl(lock);
+        saveQueued = false;
+        if(!cacheChanged || !cacheLoaded) return;
+        json = toJson();
+        cacheChanged = false;
+    }
+
+    // Written outside the lock so opening files never waits on the disk
+    const juce::ScopedLock sl(saveLock);
+    cacheFile.getParentDirectory().createDirectory();
+    cacheFile.replaceWithText(json);
+}
+
+juce::String FormatRegistry::toJson() const
+{
+    juce::Array<juce::var> list;
+    for(auto& [path, entry] : cache)
+    {
+        auto* obj = new juce::DynamicObject();
+        obj->setProperty("file", path);
+        obj->setProperty("size", entry.size);
+        obj->setProperty("modified", entry.modified);
+        obj->setProperty("format", entry.formatName);
+        obj->setProperty("used", entry.lastUsed);
+        list.add(juce::var(obj));
+    }
+    return juce::JSON::toString(list);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <JuceHeader.h>
+#include "JobScheduler.h"
+#include "Metrics.h"
+#include <map>
+
+// One AudioFormatManager for the whole player, shared through juce::SharedResourcePointer.
+// Opening a file picks the format from, in order: the per-file cache, the file's magic
+// bytes, its extension; only if all of those fail are the formats probed one by one.
+// What worked is remembered on disk, so reopening a file costs a single header parse. The
+// cache keeps the most recently used files and is saved in the background after new entries.
+class FormatRegistry
+{
+public:
+    FormatRegistry();
+    ~FormatRegistry();
+
+    juce::AudioFormatManager& getFormatManager() { return formatManager; }
+
+    // Thread-safe
+    std::unique_ptr<juce::AudioFormatReader> createReaderFor(const juce::File& file);
+    // For streams that can't be reopened (HTTP); fileName only hints at the format
+    std::unique_ptr<juce::AudioFormatReader> createReaderFor(std::unique_ptr<juce::InputStream> stream, const juce::String& fileName);
+
+    // Extension (".wav", ".flac", ...) whose format matches the header, or empty if unknown
+    static juce::String sniffExtension(juce::InputStream& stream);
+
+private:
+    struct CacheEntry
+    {
+        juce::int64 size = 0;
+        juce::int64 modified = 0;
+        juce::String formatName;
+        juce::int64 lastUsed = 0; // ms since the epoch; the least recent entry is evicted first
+    };
+
+    static constexpr int maxCacheEntries = 4096;
+
+    juce::AudioFormatManager formatManager;
+    juce::File cacheFile = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+                               .getChildFile("SimpleAudioPlayer").getChildFile("format-cache.json");
+    juce::CriticalSection lock, saveLock;
+    std::map<juce::String, CacheEntry> cache;
+    bool cacheChanged = false;
+    bool saveQueued = false;
+    bool cacheLoaded = false; // until then lookups miss and nothing is saved over the file
+    juce::SharedResourcePointer<JobScheduler> scheduler;
+    JobScheduler::GroupPtr cacheJobs = JobScheduler::createGroup();
+
+    juce::SharedResourcePointer<Metrics> metrics;
+    Metrics::Value& cacheHits = metrics->getCounter("player_cache_lookups_total", "Cache lookups by cache and result", "cache=\"format\",result=\"hit\"");
+    Metrics::Value& cacheMisses = metrics->getCounter("player_cache_lookups_total", "Cache lookups by cache and result", "cache=\"format\",result=\"miss\"");
+
+    juce::AudioFormat* findFormatByName(const juce::String& name) const;
+    juce::AudioFormat* lookupCached(const juce::File& file);
+    void remember(const juce::File& file, const juce::AudioFormat& format);
+    static std::unique_ptr<juce::AudioFormatReader> openWith(juce::AudioFormat* format, const juce::File& file);
+
+    void loadCache();
+    void saveCache();
+    juce::String toJson() const; // call with lock held
+    void queueSave(); // call with lock held
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FormatRegistry)
+};
@@ -0,0 +1,67 @@
+#include "GainStage.h"
+
+GainStage::GainStage()
+{
+    prepare(512, 44100.0);
+}
+
+void GainStage::prepare(int maximumBlockSize, double sampleRate)
+{
+    capacity = juce::jmax(1, maximumBlockSize);
+    rampIndex.allocate((size_t)capacity, false);
+    rampGains.allocate((size_t)capacity, false);
+    for(int i = 0; i < capacity; ++i)
+        rampIndex[i] = (float)(i + 1);
+
+    rampLength = juce::jmax(1, juce::roundToInt(sampleRate * rampTimeSeconds));
+    currentGain = rampTarget = muted.load() ? 0.0f : userGain.load() * normalisationGain.load();
+    rampRemaining = 0;
+}
+
+void GainStage::process(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    auto* buffer = bufferToFill.buffer;
+    if(buffer == nullptr || bufferToFill.numSamples <= 0) return;
+
+    float target = muted.load() ? 0.0f : userGain.load() * normalisationGain.load();
+    if(target != rampTarget)
+    {
+        // A new target restarts the ramp from wherever the gain is now
+        rampTarget = target;
+        rampRemaining = rampLength;
+        rampStep = (rampTarget - currentGain) / (float)rampLength;
+    }
+
+    // Chunks keep us inside the scratch buffers if the device sends a larger block than announced
+    auto* channels = buffer->getArrayOfWritePointers();
+    for(int done = 0; done < bufferToFill.numSamples; done += capacity)
+        processChunk(channels, buffer->getNumChannels(), bufferToFill.startSample + done,
+                     juce::jmin(capacity, bufferToFill.numSamples - done));
+}
+
+void GainStage::processChunk(float* const* channels, int numChannels, int startSample, int numSamples)
+{
+    if(rampRemaining == 0)
+    {
+        if(currentGain == 1.0f) return;
+        for(int ch = 0; ch < numChannels; ++ch)
+        {
+            if(currentGain == 0.0f) juce::FloatVectorOperations::clear(channels[ch] + startSample, numSamples);
+            else juce::FloatVectorOperations::multiply(channels[ch] + startSample, currentGain, numSamples);
+        }
+        return;
+    }
+
+    // gains[i] = current + step * (i + 1) for the ramp part, then the target for the rest
+    int rampSamples = juce::jmin(rampRemaining, numSamples);
+    juce::FloatVectorOperations::copyWithMultiply(rampGains.get(), rampIndex.get(), rampStep, rampSamples);
+    juce::FloatVectorOperations::add(rampGains.get(), currentGain, rampSamples);
+    if(rampSamples < numSamples)
+        juce::FloatVectorOperations::fill(rampGains.get() + rampSamples, rampTarget, numSamples - rampSamples);
+
+    rampRemaining -= rampSamples;
+    currentGain = rampRemaining == 0 ? rampTarget : rampGains[rampSamples - 1];
+
+    for(int ch = 0; ch < numChannels; ++ch)
+        juce::FloatVectorOperations::multiply(channels[ch] + startSample, rampGains.get(), numSamples);
+}
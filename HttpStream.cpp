@@ -0,0 +1,412 @@
+#include "HttpStream.h"
+#include <cstring>
+
+HttpStream::HttpStream(const juce::URL& urlToOpen, Options optionsToUse)
+    : juce::Thread("HTTP stream"),
+      url(urlToOpen),
+      options(optionsToUse),
+      capacity(juce::jmax(4 * chunkBytes, optionsToUse.bufferBytes)),
+      rebufferBytes(optionsToUse.rebufferBytes)
+{
+    ring.malloc((size_t)capacity);
+    head.malloc((size_t)juce::jmax(1, options.headBytes));
+    raiseLowWatermark((juce::int64)(options.lowWatermark * capacity));
+    rateStartMs = juce::Time::getMillisecondCounter();
+    startThread();
+}
+
+HttpStream::~HttpStream()
+{
+    signalThreadShouldExit();
+    {
+        const juce::ScopedLock sl(lock);
+        if(connection != nullptr) connection->cancel();
+    }
+    wakeDownloader.signal();
+    stopThread(options.connectTimeoutMs + 1000);
+}
+
+HttpStream::Health HttpStream::getHealth() const
+{
+    const juce::ScopedLock sl(lock);
+    Health health;
+    health.bufferedBytes = juce::jmax((juce::int64)0, windowEnd - readPosition);
+    health.fill = (double)health.bufferedBytes / capacity;
+    health.bytesPerSecond = bytesPerSecond;
+    health.underruns = underruns;
+    health.reconnects = reconnects;
+    health.rangeRequests = rangeRequests;
+    health.finished = finished;
+    health.failed = failed;
+    return health;
+}
+
+bool HttpStream::waitUntilConnected(int timeoutMs)
+{
+    connectedEvent.wait(timeoutMs);
+    const juce::ScopedLock sl(lock);
+    return connected && !failed;
+}
+
+// ------------------- InputStream -------------------
+juce::int64 HttpStream::getTotalLength()
+{
+    waitUntilConnected(options.connectTimeoutMs);
+    const juce::ScopedLock sl(lock);
+    return totalLength;
+}
+
+bool HttpStream::isExhausted()
+{
+    const juce::ScopedLock sl(lock);
+    if(totalLength >= 0 && readPosition >= totalLength) return true;
+    return (failed || finished) && readPosition >= windowEnd;
+}
+
+juce::int64 HttpStream::getPosition()
+{
+    const juce::ScopedLock sl(lock);
+    return readPosition;
+}
+
+bool HttpStream::setPosition(juce::int64 newPosition)
+{
+    const juce::ScopedLock sl(lock);
+    readPosition = juce::jmax((juce::int64)0, newPosition);
+    if(totalLength >= 0) readPosition = juce::jmin(readPosition, totalLength);
+
+    // Start fetching the new place straight away rather than on the next read
+    if(needsRestart()) requestRestart(readPosition);
+    wakeDownloader.signal();
+    return true;
+}
+
+int HttpStream::read(void* destBuffer, int maxBytesToRead)
+{
+    auto* dest = static_cast<char*>(destBuffer);
+    int done = 0;
+    bool waiting = false;
+    const auto deadline = juce::Time::getMillisecondCounter() + (juce::uint32)options.readTimeoutMs;
+
+    while(done < maxBytesToRead)
+    {
+        {
+            const juce::ScopedLock sl(lock);
+
+            // After an underrun, wait until there is a margin again instead of trickling along
+            const auto wanted = totalLength >= 0 ? juce::jmin(rebufferBytes, totalLength - readPosition) : rebufferBytes;
+            if(!waiting || windowEnd - readPosition >= wanted || finished || failed)
+            {
+                const int n = copyAvailable(dest + done, maxBytesToRead - done);
+                done += n;
+                if(n > 0)
+                {
+                    deliveredSinceRestart = true;
+                    continue;
+                }
+            }
+
+            if(done == maxBytesToRead || (totalLength >= 0 && readPosition >= totalLength)) break;
+            if((finished || failed) && !needsRestart()) break;
+            if(needsRestart() && restartAt != readPosition) requestRestart(readPosition);
+
+            if(!waiting && deliveredSinceRestart && restartAt < 0)
+            {
+                // Playback caught up with the download: keep more in hand from now on
+                ++underruns;
+                underrunMetric.add(1.0);
+                rebufferBytes = juce::jmin(rebufferBytes * 2, (juce::int64)capacity / 2);
+                raiseLowWatermark(lowWatermarkBytes);
+            }
+            waiting = true;
+        }
+
+        wakeDownloader.signal();
+        if(juce::Time::getMillisecondCounter() >= deadline) break;
+        dataArrived.wait(20);
+    }
+
+    publishHealth();
+    return done;
+}
+
+// Called with the lock held
+int HttpStream::copyAvailable(char* dest, int numBytes)
+{
+    const bool inWindow = readPosition >= windowStart && readPosition < windowEnd;
+    if(!inWindow && readPosition < headFilled)
+    {
+        const int n = (int)juce::jmin((juce::int64)numBytes, headFilled - readPosition);
+        std::memcpy(dest, head + readPosition, (size_t)n);
+        readPosition += n;
+        return n;
+    }
+    if(!inWindow) return 0;
+
+    // Up to two pieces, around the end of the ring
+    const int n = (int)juce::jmin((juce::int64)numBytes, windowEnd - readPosition);
+    const int offset = (int)(readPosition % capacity);
+    const int first = juce::jmin(n, capacity - offset);
+    std::memcpy(dest, ring + offset, (size_t)first);
+    std::memcpy(dest + first, ring.get(), (size_t)(n - first));
+    readPosition += n;
+
+    if(windowEnd - readPosition <= lowWatermarkBytes) wakeDownloader.signal();
+    return n;
+}
+
+// Called with the lock held. The downloader must resume before the reader's rebuffer margin
+// runs out, or a paused download and a waiting reader would stall each other.
+void HttpStream::raiseLowWatermark(juce::int64 bytes)
+{
+    lowWatermarkBytes = juce::jmin(juce::jmax(bytes, rebufferBytes * 2), getHighWatermarkBytes() - chunkBytes);
+}
+
+// Called with the lock held. True if the download will never reach readPosition on its own.
+bool HttpStream::needsRestart() const
+{
+    if(readPosition >= windowStart && readPosition <= windowEnd + seekGapBytes) return false;
+    if(readPosition < headFilled) return false;
+    return totalLength < 0 || readPosition < totalLength;
+}
+
+// Called with the lock held
+void HttpStream::requestRestart(juce::int64 offset)
+{
+    restartAt = offset;
+    deliveredSinceRestart = false;
+    if(connection != nullptr) connection->cancel();
+    wakeDownloader.signal();
+}
+
+void HttpStream::publishHealth()
+{
+    auto health = getHealth();
+    bufferedMetric.set((double)health.bufferedBytes);
+    fillMetric.set(health.fill);
+    rateMetric.set(health.bytesPerSecond);
+}
+
+// ------------------- Download thread -------------------
+void HttpStream::run()
+{
+    int retries = 0;
+    while(!threadShouldExit())
+    {
+        juce::int64 offset;
+        {
+            const juce::ScopedLock sl(lock);
+            if(restartAt >= 0)
+            {
+                offset = restartAt;
+                restartAt = -1;
+                finished = failed = false;
+                // The ring only ever holds one contiguous range
+                windowStart = windowEnd = offset;
+                retries = 0;
+            }
+            else if(finished || failed)
+            {
+                offset = -1;
+            }
+            else
+            {
+                offset = windowEnd; // resume after a dropped connection
+            }
+        }
+
+        if(offset < 0)
+        {
+            wakeDownloader.wait(100); // idle until a seek needs more
+            continue;
+        }
+
+        if(download(offset))
+        {
+            retries = 0;
+            continue;
+        }
+
+        if(threadShouldExit()) break;
+        {
+            const juce::ScopedLock sl(lock);
+            if(restartAt >= 0) continue;
+        }
+        if(++retries > options.maxRetries)
+        {
+            markFailed();
+            continue;
+        }
+
+        {
+            const juce::ScopedLock sl(lock);
+            ++reconnects;
+        }
+        reconnectMetric.add(1.0);
+        wakeDownloader.wait(250 * retries);
+    }
+}
+
+// Streams from offset until the body ends, a restart is requested or the thread stops.
+// False if the connection could not be made or broke off before the end.
+bool HttpStream::download(juce::int64 offset)
+{
+    auto web = std::make_unique<juce::WebInputStream>(url, false);
+    web->withExtraHeaders("Range: bytes=" + juce::String(offset) + "-")
+        .withConnectionTimeout(options.connectTimeoutMs);
+    {
+        const juce::ScopedLock sl(lock);
+        if(restartAt >= 0 || threadShouldExit()) return true;
+        connection = web.get();
+    }
+
+    auto disconnect = [&]
+    {
+        const juce::ScopedLock sl(lock);
+        connection = nullptr;
+    };
+
+    const bool opened = web->connect(nullptr);
+    const int status = web->getStatusCode();
+    if(!opened || (status != 200 && status != 206))
+    {
+        disconnect();
+        return false;
+    }
+
+    // A server that ignores Range sends the whole body; skip to where we wanted to be
+    juce::int64 skip = 0;
+    {
+        const juce::ScopedLock sl(lock);
+        rangeRequests = status == 206;
+        if(status == 206)
+        {
+            auto contentRange = web->getResponseHeaders().getValue("Content-Range", {});
+            auto total = contentRange.fromLastOccurrenceOf("/", false, false).trim();
+            totalLength = total.containsOnly("0123456789") && total.isNotEmpty() ? total.getLargeIntValue() : -1;
+        }
+        else
+        {
+            totalLength = web->getTotalLength();
+            skip = offset;
+        }
+        connected = true;
+    }
+    connectedEvent.signal();
+
+    juce::HeapBlock<char> chunk(chunkBytes);
+    bool paused = false;
+    bool complete = false;
+
+    while(!threadShouldExit())
+    {
+        {
+            const juce::ScopedLock sl(lock);
+            if(restartAt >= 0) break;
+
+            // Hysteresis between the watermarks; one more chunk must always fit behind the reader
+            const auto ahead = windowEnd - readPosition;
+            paused = paused ? ahead > lowWatermarkBytes : ahead >= getHighWatermarkBytes();
+        }
+        if(paused)
+        {
+            wakeDownloader.wait(50);
+            continue;
+        }
+
+        const int n = web->read(chunk, chunkBytes);
+        if(n <= 0)
+        {
+            complete = web->isExhausted();
+            break;
+        }
+
+        const int skipped = (int)juce::jmin(skip, (juce::int64)n);
+        skip -= skipped;
+        if(skipped < n) append(chunk + skipped, n - skipped);
+    }
+
+    disconnect();
+    {
+        const juce::ScopedLock sl(lock);
+        if(restartAt >= 0 || threadShouldExit()) return true;
+        // An idle connection closed by the server can look exhausted too; trust the length first
+        if(totalLength >= 0 ? windowEnd < totalLength : !complete) return false;
+
+        finished = true;
+        if(totalLength < 0) totalLength = windowEnd;
+    }
+    dataArrived.signal();
+    return true;
+}
+
+void HttpStream::append(const char* data, int numBytes)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        if(restartAt >= 0) return; // these bytes belong to the range being abandoned
+
+        if(windowEnd <= headFilled && windowEnd + numBytes > headFilled && headFilled < options.headBytes)
+        {
+            const auto from = headFilled - windowEnd;
+            const auto n = juce::jmin((juce::int64)numBytes - from, (juce::int64)options.headBytes - headFilled);
+            std::memcpy(head + headFilled, data + from, (size_t)n);
+            headFilled += n;
+        }
+
+        const int offset = (int)(windowEnd % capacity);
+        const int first = juce::jmin(numBytes, capacity - offset);
+        std::memcpy(ring + offset, data, (size_t)first);
+        std::memcpy(ring.get(), data + first, (size_t)(numBytes - first));
+        windowEnd += numBytes;
+        windowStart = juce::jmax(windowStart, windowEnd - capacity);
+
+        rateBytes += numBytes;
+        const auto now = juce::Time::getMillisecondCounter();
+        if(now - rateStartMs >= 1000)
+        {
+            bytesPerSecond = rateBytes * 1000.0 / (now - rateStartMs);
+            rateBytes = 0;
+            rateStartMs = now;
+        }
+    }
+    dataArrived.signal();
+}
+
+void HttpStream::markFailed()
+{
+    {
+        const juce::ScopedLock sl(lock);
+        failed = true;
+    }
+    connectedEvent.signal();
+    dataArrived.signal();
+}
+
+// ------------------- Pool -------------------
+void HttpStreamPool::prefetch(const juce::URL& url)
+{
+    const juce::ScopedLock sl(lock);
+    for(auto& stream : prefetched)
+        if(stream->getURL().toString(true) == url.toString(true))
+            return;
+
+    if((int)prefetched.size() >= maxPrefetched)
+        prefetched.erase(prefetched.begin());
+    prefetched.push_back(std::make_unique<HttpStream>(url));
+}
+
+std::unique_ptr<HttpStream> HttpStreamPool::open(const juce::URL& url)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        for(auto it = prefetched.begin(); it != prefetched.end(); ++it)
+            if((*it)->getURL().toString(true) == url.toString(true))
+            {
+                auto stream = std::move(*it);
+                prefetched.erase(it);
+                return stream;
+            }
+    }
+    return std::make_unique<HttpStream>(url);
+}
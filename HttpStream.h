@@ -0,0 +1,128 @@
+#pragma once
+#include <JuceHeader.h>
+#include "Metrics.h"
+#include <memory>
+#include <vector>
+
+// A seekable InputStream over an HTTP resource, so an AudioFormatReader can play it while it
+// downloads.
+// - A background thread downloads into a ring buffer. It pauses once highWatermark of the
+//   ring is ahead of the reader and resumes when that falls below lowWatermark, so an idle
+//   stream does not keep the connection busy and a playing one is topped up in large bursts.
+// - Seeking outside what is buffered reconnects with a Range request. Servers that ignore
+//   Range are read from the start again and the bytes before the target skipped.
+// - The first headBytes are kept for good: decoders go back to their headers, and those
+//   reads must not cost a reconnect.
+// - A read that has to wait for the network is an underrun. Each one raises the amount the
+//   reader waits for before it continues, and the low watermark with it, so a slow
+//   connection settles on rebuffering rarely rather than often.
+// read() blocks for at most readTimeoutMs; it is meant for decoder and read-ahead threads,
+// never the audio thread. A deck playing a stream reads it ahead on a thread of its own.
+class HttpStream : public juce::InputStream,
+                   private juce::Thread
+{
+public:
+    struct Options
+    {
+        int bufferBytes = 4 << 20;
+        double highWatermark = 0.9;
+        double lowWatermark = 0.5;
+        int rebufferBytes = 64 << 10; // initial; doubles on every underrun up to half the ring
+        int headBytes = 64 << 10;
+        int connectTimeoutMs = 5000;
+        int readTimeoutMs = 2000;
+        int maxRetries = 3;
+    };
+
+    struct Health
+    {
+        juce::int64 bufferedBytes = 0; // downloaded and ahead of the reader
+        double fill = 0.0;             // bufferedBytes as a share of the ring
+        double bytesPerSecond = 0.0;   // download rate over the last second
+        int underruns = 0;
+        int reconnects = 0;
+        bool rangeRequests = false;    // the server answered a Range request with 206
+        bool finished = false;         // downloaded to the end
+        bool failed = false;           // gave up after maxRetries
+    };
+
+    explicit HttpStream(const juce::URL& url, Options options = {});
+    ~HttpStream() override;
+
+    const juce::URL& getURL() const { return url; }
+    Health getHealth() const;
+    // Waits for the response headers; false if the connection failed or timed out
+    bool waitUntilConnected(int timeoutMs);
+
+    juce::int64 getTotalLength() override;
+    bool isExhausted() override;
+    int read(void* destBuffer, int maxBytesToRead) override;
+    juce::int64 getPosition() override;
+    bool setPosition(juce::int64 newPosition) override;
+
+private:
+    static constexpr int chunkBytes = 32768;
+    static constexpr juce::int64 seekGapBytes = 256 << 10; // a seek this close ahead waits instead of reconnecting
+
+    const juce::URL url;
+    const Options options;
+
+    juce::CriticalSection lock;
+    juce::HeapBlock<char> ring;
+    const int capacity;
+    juce::int64 windowStart = 0, windowEnd = 0; // absolute byte range held in the ring
+    juce::int64 readPosition = 0;
+    juce::HeapBlock<char> head;
+    juce::int64 headFilled = 0;
+    juce::int64 totalLength = -1;
+    juce::int64 restartAt = 0; // where the downloader (re)connects next, or -1
+    juce::WebInputStream* connection = nullptr;
+    bool connected = false, finished = false, failed = false, rangeRequests = false;
+    bool deliveredSinceRestart = false;
+    juce::int64 rebufferBytes;
+    juce::int64 lowWatermarkBytes;
+    int underruns = 0, reconnects = 0;
+    juce::int64 rateBytes = 0;
+    juce::uint32 rateStartMs = 0;
+    double bytesPerSecond = 0.0;
+
+    juce::WaitableEvent dataArrived, wakeDownloader, connectedEvent { true };
+
+    juce::SharedResourcePointer<Metrics> metrics;
+    Metrics::Value& bufferedMetric = metrics->getGauge("player_stream_buffered_bytes", "Bytes downloaded ahead of the playing stream's reader");
+    Metrics::Value& fillMetric = metrics->getGauge("player_stream_buffer_fill_ratio", "Share of the playing stream's ring buffer ahead of its reader");
+    Metrics::Value& rateMetric = metrics->getGauge("player_stream_download_bytes_per_second", "Download rate of the playing stream");
+    Metrics::Value& underrunMetric = metrics->getCounter("player_stream_underruns_total", "Stream reads that had to wait for the network");
+    Metrics::Value& reconnectMetric = metrics->getCounter("player_stream_reconnects_total", "Stream connections retried after an error or a dropped connection");
+
+    void run() override;
+    bool download(juce::int64 offset);
+    void append(const char* data, int numBytes);
+    void requestRestart(juce::int64 offset);
+    void markFailed();
+    int copyAvailable(char* dest, int numBytes);
+    void raiseLowWatermark(juce::int64 bytes);
+    // One more chunk must always fit behind the reader
+    juce::int64 getHighWatermarkBytes() const { return juce::jmin((juce::int64)(options.highWatermark * capacity), (juce::int64)(capacity - chunkBytes)); }
+    bool needsRestart() const;
+    void publishHealth();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HttpStream)
+};
+
+// Streams opened ahead of time, so the next playlist entry is already downloading when it is
+// needed. Shared through juce::SharedResourcePointer; thread-safe.
+class HttpStreamPool
+{
+public:
+    static constexpr int maxPrefetched = 2;
+
+    // Starts downloading url unless it already is; the oldest prefetch makes room
+    void prefetch(const juce::URL& url);
+    // The prefetched stream for url if there is one, otherwise a new one
+    std::unique_ptr<HttpStream> open(const juce::URL& url);
+
+private:
+    juce::CriticalSection lock;
+    std::vector<std::unique_ptr<HttpStream>> prefetched;
+};
@@ -0,0 +1,153 @@
+#include "JobScheduler.h"
+
+void JobScheduler::Group::cancelAndWait()
+{
+    cancel();
+    while(pending.load() > 0)
+        juce::Thread::sleep(1);
+}
+
+// ------------------- Scheduler -------------------
+JobScheduler::JobScheduler()
+{
+    // One core is left for the audio and message threads
+    const int numWorkers = juce::jmax(2, juce::SystemStats::getNumCpus() - 1);
+    caps[currentTrack] = numWorkers;
+    caps[nextTrack] = juce::jmax(1, numWorkers / 2);
+    caps[visibleRows] = juce::jmax(1, numWorkers / 2);
+    caps[background] = juce::jmax(1, numWorkers / 4);
+
+    for(int i = 0; i < numWorkers; ++i)
+        workers.add(new Worker(*this, i));
+    for(auto* w : workers)
+        w->startThread(juce::Thread::Priority::low);
+}
+
+JobScheduler::~JobScheduler()
+{
+    for(auto* w : workers)
+        w->signalThreadShouldExit();
+    wakeWorkers();
+
+    for(auto* w : workers)
+        w->stopThread(5000);
+
+    // Whatever never ran is released so cancelAndWait() callers don't hang
+    for(auto* w : workers)
+        for(auto& queue : w->queues)
+            for(auto& queued : queue)
+                --queued.group->pending;
+}
+
+void JobScheduler::submit(Priority priority, const GroupPtr& group, Job job)
+{
+    jassert(group != nullptr);
+    if(group->isCancelled()) return;
+
+    ++group->pending;
+    auto* target = workers[(int)(nextWorker++ % (unsigned int)workers.size())];
+    {
+        std::lock_guard<std::mutex> sl(target->queueLock);
+        target->queues[(size_t)priority].push_back({ group, std::move(job) });
+    }
+    wakeWorkers();
+}
+
+juce::uint64 JobScheduler::getWakeGeneration()
+{
+    std::lock_guard<std::mutex> sl(wakeLock);
+    return wakeGeneration;
+}
+
+void JobScheduler::wakeWorkers()
+{
+    {
+        std::lock_guard<std::mutex> sl(wakeLock);
+        ++wakeGeneration;
+    }
+    wakeUp.notify_all();
+}
+
+// ------------------- Workers -------------------
+JobScheduler::Worker::Worker(JobScheduler& ownerToUse, int indexToUse)
+    : juce::Thread("Player job worker " + juce::String(indexToUse)), owner(ownerToUse), index(indexToUse)
+{
+}
+
+void JobScheduler::Worker::run()
+{
+    while(!threadShouldExit())
+    {
+        // Read before looking, so anything queued after the look changes it
+        const auto seen = owner.getWakeGeneration();
+
+        QueuedJob job;
+        Priority priority;
+        if(owner.tryTake(index, job, priority))
+        {
+            owner.runJob(job, priority);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> sl(owner.wakeLock);
+        owner.wakeUp.wait(sl, [&] { return owner.wakeGeneration != seen || threadShouldExit(); });
+    }
+}
+
+// Highest priority first; own queue from the front, other workers' queues from the back
+bool JobScheduler::tryTake(int workerIndex, QueuedJob& job, Priority& priority)
+{
+    for(int p = 0; p < numPriorities; ++p)
+    {
+        auto candidate = (Priority)p;
+        if(!tryAcquireSlot(candidate)) continue;
+
+        for(int i = 0; i < workers.size(); ++i)
+        {
+            auto* victim = workers[(workerIndex + i) % workers.size()];
+            std::lock_guard<std::mutex> sl(victim->queueLock);
+            auto& queue = victim->queues[(size_t)p];
+
+            while(!queue.empty())
+            {
+                bool own = i == 0;
+                QueuedJob taken = std::move(own ? queue.front() : queue.back());
+                if(own) queue.pop_front(); else queue.pop_back();
+
+                if(taken.group->isCancelled())
+                {
+                    --taken.group->pending;
+                    continue;
+                }
+
+                job = std::move(taken);
+                priority = candidate;
+                return true;
+            }
+        }
+
+        --running[(size_t)p];
+    }
+    return false;
+}
+
+bool JobScheduler::tryAcquireSlot(Priority priority)
+{
+    auto& count = running[(size_t)priority];
+    int current = count.load();
+    while(current < caps[(size_t)priority])
+        if(count.compare_exchange_weak(current, current + 1))
+            return true;
+    return false;
+}
+
+void JobScheduler::runJob(QueuedJob& queued, Priority priority)
+{
+    if(!queued.group->isCancelled())
+        queued.job(*queued.group);
+
+    queued.job = nullptr; // release captures before the group is reported idle
+    --queued.group->pending;
+    --running[(size_t)priority];
+    wakeWorkers(); // a capped class may have a slot again
+}
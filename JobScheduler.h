@@ -0,0 +1,96 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+// Shared pool for the player's background work (reader opening, tags, thumbnails,
+// session I/O, loudness analysis). Get it through juce::SharedResourcePointer<JobScheduler>.
+//
+// - Jobs run in priority order: current track > next track > visible playlist rows > background.
+// - Each class has a cap on how many workers it may occupy, so background work always
+//   leaves room for the current track.
+// - Every worker has its own queues; idle workers steal from the others.
+// - Workers run at low priority so the audio and message threads are never starved.
+class JobScheduler
+{
+public:
+    enum Priority { currentTrack, nextTrack, visibleRows, background, numPriorities };
+
+    // Jobs submitted with one group are cancelled together, e.g. everything for the
+    // track the user just skipped. Jobs poll isCancelled(); queued ones are dropped.
+    class Group
+    {
+    public:
+        void cancel() { cancelled.store(true); }
+        bool isCancelled() const { return cancelled.load(); }
+        // No job of this group is queued or running any more
+        bool isIdle() const { return pending.load() == 0; }
+
+        // Cancels, then blocks until no job of this group is queued or running
+        void cancelAndWait();
+
+    private:
+        std::atomic<bool> cancelled { false };
+        std::atomic<int> pending { 0 };
+        friend class JobScheduler;
+    };
+
+    using GroupPtr = std::shared_ptr<Group>;
+    using Job = std::function<void(const Group&)>;
+
+    JobScheduler();
+    ~JobScheduler();
+
+    static GroupPtr createGroup() { return std::make_shared<Group>(); }
+
+    void submit(Priority priority, const GroupPtr& group, Job job);
+
+    int getNumWorkers() const { return workers.size(); }
+    int getThreadCap(Priority priority) const { return caps[(size_t)priority]; }
+
+private:
+    struct QueuedJob
+    {
+        GroupPtr group;
+        Job job;
+    };
+
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker(JobScheduler& ownerToUse, int indexToUse);
+        void run() override;
+
+        std::mutex queueLock;
+        std::array<std::deque<QueuedJob>, numPriorities> queues;
+
+    private:
+        JobScheduler& owner;
+        const int index;
+    };
+
+    juce::OwnedArray<Worker> workers;
+    std::array<int, numPriorities> caps {};
+    std::array<std::atomic<int>, numPriorities> running {};
+    std::atomic<unsigned int> nextWorker { 0 };
+
+    // Bumped under wakeLock whenever a worker may find something new to take: a job queued,
+    // a capped slot freed, or shutdown. A worker sleeps only while it is unchanged since it
+    // last looked, so no wake-up falls between its failed look and its wait.
+    std::mutex wakeLock;
+    std::condition_variable wakeUp;
+    juce::uint64 wakeGeneration = 0;
+
+    juce::uint64 getWakeGeneration();
+    void wakeWorkers();
+    bool tryTake(int workerIndex, QueuedJob& job, Priority& priority);
+    bool tryAcquireSlot(Priority priority);
+    void runJob(QueuedJob& job, Priority priority);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(JobScheduler)
+};
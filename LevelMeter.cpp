@@ -0,0 +1,87 @@
+#include "LevelMeter.h"
+#include <cmath>
+
+LevelMeter::LevelMeter()
+{
+    prepare(44100.0);
+}
+
+void LevelMeter::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    for(auto& state : states)
+    {
+        state.meanSquare = 0.0f;
+        state.truePeak.reset();
+    }
+}
+
+LevelMeter::Levels LevelMeter::read(int channel)
+{
+    Levels levels;
+    if(channel < 0 || channel >= maxChannels) return levels;
+    auto& s = shared[(size_t)channel];
+    levels.peak = s.peak.exchange(0.0f);
+    levels.truePeak = s.truePeak.exchange(0.0f);
+    levels.rms = std::sqrt(s.meanSquare.load());
+    return levels;
+}
+
+void LevelMeter::storeMax(std::atomic<float>& target, float value)
+{
+    float current = target.load(std::memory_order_relaxed);
+    while(value > current && !target.compare_exchange_weak(current, value)) {}
+}
+
+// ------------------- Audio thread -------------------
+void LevelMeter::process(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if(bufferToFill.buffer == nullptr || bufferToFill.numSamples <= 0) return;
+    const int channels = juce::jmin(maxChannels, bufferToFill.buffer->getNumChannels());
+    const int n = bufferToFill.numSamples;
+    numChannels.store(channels);
+
+    // One-pole average per block, so the time constant is independent of the block size
+    const float keep = (float)std::exp(-n / (rmsTimeSeconds * sampleRate));
+
+    for(int ch = 0; ch < channels; ++ch)
+    {
+        const float* data = bufferToFill.buffer->getReadPointer(ch, bufferToFill.startSample);
+        auto& state = states[(size_t)ch];
+        auto& s = shared[(size_t)ch];
+
+        auto range = juce::FloatVectorOperations::findMinAndMax(data, n);
+        const float peak = juce::jmax(-range.getStart(), range.getEnd());
+        storeMax(s.peak, peak);
+
+        const float blockMeanSquare = sumOfSquares(data, n) / (float)n;
+        state.meanSquare = keep * state.meanSquare + (1.0f - keep) * blockMeanSquare;
+        s.meanSquare.store(state.meanSquare);
+
+        storeMax(s.truePeak, state.truePeak.process(data, n));
+    }
+}
+
+float LevelMeter::sumOfSquares(const float* data, int numSamples)
+{
+    using Vec = juce::dsp::SIMDRegister<float>;
+    const int lanes = (int)Vec::size();
+    float sum = 0.0f;
+    int i = 0;
+
+    // Scalar up to the first aligned sample, whole registers, then the scalar tail
+    for(; i < numSamples && !Vec::isSIMDAligned(data + i); ++i)
+        sum += data[i] * data[i];
+
+    Vec acc = Vec::expand(0.0f);
+    for(; i + lanes <= numSamples; i += lanes)
+    {
+        const Vec x = Vec::fromRawArray(data + i);
+        acc += x * x;
+    }
+    sum += acc.sum();
+
+    for(; i < numSamples; ++i)
+        sum += data[i] * data[i];
+    return sum;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <JuceHeader.h>
+#include "TruePeak.h"
+#include <array>
+#include <atomic>
+
+// Peak, RMS and true-peak levels of the player's output, per channel.
+// - Sample peak comes from FloatVectorOperations::findMinAndMax and the sum of squares from
+//   a SIMDRegister loop; RMS is that averaged with a 300 ms time constant.
+// - True peak comes from TruePeak, the same 4x interpolator the loudness analyser uses.
+// - Results are published through atomics. Peaks hold their maximum until the GUI takes
+//   them, so a short transient between two reads is never lost.
+// process() runs on the audio thread; read() may be called from any other thread.
+class LevelMeter
+{
+public:
+    static constexpr int maxChannels = 8;
+    static constexpr double rmsTimeSeconds = 0.3;
+
+    struct Levels
+    {
+        float peak = 0.0f, rms = 0.0f, truePeak = 0.0f; // linear gain
+    };
+
+    LevelMeter();
+
+    void prepare(double sampleRate);
+    void process(const juce::AudioSourceChannelInfo& bufferToFill);
+
+    int getNumChannels() const { return numChannels.load(); }
+    // Peaks since the previous read of this channel, current RMS
+    Levels read(int channel);
+
+private:
+    struct SharedLevels
+    {
+        std::atomic<float> peak { 0.0f }, truePeak { 0.0f }, meanSquare { 0.0f };
+    };
+
+    struct ChannelState
+    {
+        float meanSquare = 0.0f;
+        TruePeak truePeak;
+    };
+
+    std::array<SharedLevels, maxChannels> shared;
+    std::atomic<int> numChannels { 0 };
+
+    // Audio thread state
+    std::array<ChannelState, maxChannels> states;
+    double sampleRate = 44100.0;
+
+    static float sumOfSquares(const float* data, int numSamples);
+    static void storeMax(std::atomic<float>& target, float value);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LevelMeter)
+};
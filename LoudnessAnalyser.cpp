@@ -0,0 +1,214 @@
+#include "LoudnessAnalyser.h"
+#include "TruePeak.h"
+#include <cmath>
+#include <map>
+
+namespace
+{
+    struct Biquad
+    {
+        double b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+        double z1 = 0, z2 = 0;
+
+        double process(double x)
+        {
+            double y = b0 * x + z1;
+            z1 = b1 * x - a1 * y + z2;
+            z2 = b2 * x - a2 * y;
+            return y;
+        }
+    };
+
+    // K-weighting: high-shelf "head" stage followed by the RLB high-pass (BS.1770-4, any sample rate)
+    void makeKWeighting(double sampleRate, Biquad& shelf, Biquad& highPass)
+    {
+        double f0 = 1681.974450955533, gainDb = 3.999843853973347, q = 0.7071752369554196;
+        double k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+        double vh = std::pow(10.0, gainDb / 20.0);
+        double vb = std::pow(vh, 0.4996667741545416);
+        double a0 = 1.0 + k / q + k * k;
+        shelf.b0 = (vh + vb * k / q + k * k) / a0;
+        shelf.b1 = 2.0 * (k * k - vh) / a0;
+        shelf.b2 = (vh - vb * k / q + k * k) / a0;
+        shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+        shelf.a2 = (1.0 - k / q + k * k) / a0;
+
+        f0 = 38.13547087602444; q = 0.5003270373238773;
+        k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+        a0 = 1.0 + k / q + k * k;
+        highPass.b0 = 1.0; highPass.b1 = -2.0; highPass.b2 = 1.0;
+        highPass.a1 = 2.0 * (k * k - 1.0) / a0;
+        highPass.a2 = (1.0 - k / q + k * k) / a0;
+    }
+
+    // BS.1770 weights: surround channels count +1.5 dB, the LFE not at all, everything else 1.0
+    double channelWeight(juce::AudioChannelSet::ChannelType type)
+    {
+        switch(type)
+        {
+            case juce::AudioChannelSet::LFE:
+            case juce::AudioChannelSet::LFE2:
+                return 0.0;
+            case juce::AudioChannelSet::leftSurround:
+            case juce::AudioChannelSet::rightSurround:
+            case juce::AudioChannelSet::leftSurroundSide:
+            case juce::AudioChannelSet::rightSurroundSide:
+            case juce::AudioChannelSet::leftSurroundRear:
+            case juce::AudioChannelSet::rightSurroundRear:
+                return 1.41;
+            default:
+                return 1.0;
+        }
+    }
+}
+
+// ------------------- Analysis -------------------
+LoudnessResult LoudnessAnalyser::analyse(juce::AudioFormatReader& reader, const std::function<bool()>& shouldStop)
+{
+    LoudnessResult result;
+    const int numChannels = (int)reader.numChannels;
+    const double sampleRate = reader.sampleRate;
+    if(numChannels <= 0 || sampleRate <= 0.0 || reader.lengthInSamples <= 0)
+        return result;
+
+    std::vector<Biquad> shelves((size_t)numChannels), highPasses((size_t)numChannels);
+    std::vector<TruePeak> peaks((size_t)numChannels);
+    float peak = 0.0f;
+    // Readers that don't know their layout report the canonical one for their channel count,
+    // e.g. L R C LFE Ls Rs for six channels
+    const auto layout = reader.getChannelLayout();
+    std::vector<double> weights((size_t)numChannels);
+    for(int ch = 0; ch < numChannels; ++ch)
+    {
+        makeKWeighting(sampleRate, shelves[(size_t)ch], highPasses[(size_t)ch]);
+        weights[(size_t)ch] = channelWeight(layout.getTypeOfChannel(ch));
+    }
+
+    // Mean squares of 100 ms sub-blocks; four of them make one 400 ms gating block (75% overlap)
+    const juce::int64 subBlockLength = juce::jmax((juce::int64)1, (juce::int64)std::llround(sampleRate * 0.1));
+    std::vector<double> subBlockPower;
+    subBlockPower.reserve((size_t)(reader.lengthInSamples / subBlockLength + 1));
+    double subBlockSum = 0.0;
+    juce::int64 subBlockFill = 0;
+
+    juce::AudioBuffer<float> buffer(numChannels, 65536);
+    for(juce::int64 pos = 0; pos < reader.lengthInSamples; pos += buffer.getNumSamples())
+    {
+        if(shouldStop && shouldStop()) return {};
+
+        int n = (int)std::min((juce::int64)buffer.getNumSamples(), reader.lengthInSamples - pos);
+        if(!reader.read(&buffer, 0, n, pos, true, numChannels > 1)) return {};
+
+        for(int ch = 0; ch < numChannels; ++ch)
+            peak = std::max(peak, peaks[(size_t)ch].process(buffer.getReadPointer(ch), n));
+
+        for(int i = 0; i < n; ++i)
+        {
+            for(int ch = 0; ch < numChannels; ++ch)
+            {
+                float x = buffer.getSample(ch, i);
+                double y = highPasses[(size_t)ch].process(shelves[(size_t)ch].process(x));
+                subBlockSum += weights[(size_t)ch] * y * y;
+            }
+
+            if(++subBlockFill == subBlockLength)
+            {
+                subBlockPower.push_back(subBlockSum / (double)subBlockLength);
+                subBlockSum = 0.0;
+                subBlockFill = 0;
+            }
+        }
+    }
+
+    std::vector<double> blockPower;
+    for(size_t i = 3; i < subBlockPower.size(); ++i)
+        blockPower.push_back((subBlockPower[i - 3] + subBlockPower[i - 2] + subBlockPower[i - 1] + subBlockPower[i]) / 4.0);
+
+    // Absolute gate at -70 LUFS, then relative gate 10 LU under the absolutely gated mean
+    const double absoluteGate = lufsToPower(absoluteGateLufs);
+    double sum = 0.0; juce::int64 count = 0;
+    std::map<int, LoudnessResult::GatedBin> bins;
+    for(auto p : blockPower)
+        if(p > absoluteGate)
+        {
+            sum += p;
+            ++count;
+            auto& bin = bins[binIndex(p)];
+            bin.power += p;
+            ++bin.blocks;
+        }
+    for(auto& [index, bin] : bins)
+    {
+        bin.index = index;
+        result.gatedBins.push_back(bin);
+    }
+
+    result.truePeakDb = juce::Decibels::gainToDecibels(peak, -100.0f);
+    result.valid = true;
+    if(count == 0) return result; // silence
+
+    const double relativeGate = (sum / (double)count) * std::pow(10.0, relativeGateLu / 10.0);
+    sum = 0.0; count = 0;
+    for(auto p : blockPower) if(p > absoluteGate && p > relativeGate) { sum += p; ++count; }
+
+    result.gatedPower = sum / (double)count;
+    result.gatedBlocks = count;
+    result.integratedLufs = powerToLufs(result.gatedPower);
+    return result;
+}
+
+int LoudnessAnalyser::binIndex(double power)
+{
+    return juce::jmax(0, (int)std::floor((powerToLufs(power) - absoluteGateLufs) / binWidthLu));
+}
+
+// The tracks' absolutely gated blocks are pooled and gated again relative to the album's own
+// mean, so a quiet track's blocks count only if they are loud enough next to the whole album
+LoudnessResult LoudnessAnalyser::combine(const std::vector<LoudnessResult>& tracks)
+{
+    LoudnessResult album;
+    std::map<int, LoudnessResult::GatedBin> pooled;
+    double sum = 0.0; juce::int64 count = 0;
+    for(auto& t : tracks)
+    {
+        if(!t.valid) continue;
+        album.valid = true;
+        album.truePeakDb = std::max(album.truePeakDb, t.truePeakDb);
+        for(auto& bin : t.gatedBins)
+        {
+            auto& p = pooled[bin.index];
+            p.index = bin.index;
+            p.power += bin.power;
+            p.blocks += bin.blocks;
+            sum += bin.power;
+            count += bin.blocks;
+        }
+    }
+    for(auto& [index, bin] : pooled)
+        album.gatedBins.push_back(bin);
+    if(count == 0) return album;
+
+    // A bin is 0.1 LU wide, so only blocks within that of the gate can land on the wrong side
+    const double relativeGate = (sum / (double)count) * std::pow(10.0, relativeGateLu / 10.0);
+    sum = 0.0; count = 0;
+    for(auto& bin : album.gatedBins)
+        if(bin.power / (double)bin.blocks > relativeGate)
+        {
+            sum += bin.power;
+            count += bin.blocks;
+        }
+
+    album.gatedPower = sum / (double)count;
+    album.gatedBlocks = count;
+    album.integratedLufs = powerToLufs(album.gatedPower);
+    return album;
+}
+
+float LoudnessAnalyser::getNormalisationGain(const LoudnessResult& result)
+{
+    if(!result.valid || result.gatedBlocks == 0) return 1.0f;
+
+    double gainDb = targetLufs - result.integratedLufs;
+    gainDb = std::min(gainDb, peakCeilingDb - result.truePeakDb);
+    return juce::Decibels::decibelsToGain((float)gainDb);
+}
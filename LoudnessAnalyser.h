@@ -0,0 +1,53 @@
+#pragma once
+#include <JuceHeader.h>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+struct LoudnessResult
+{
+    bool valid = false;
+    double integratedLufs = -70.0;
+    double truePeakDb = -100.0;
+
+    // Mean power and count of the gated 400 ms blocks
+    double gatedPower = 0.0;
+    juce::int64 gatedBlocks = 0;
+
+    // The blocks past the absolute gate, binned by loudness (LoudnessAnalyser::binWidthLu wide,
+    // from -70 LUFS up). Only non-empty bins are kept. Album loudness re-gates the pooled bins
+    // of its tracks without decoding them again.
+    struct GatedBin
+    {
+        int index = 0;
+        double power = 0.0; // summed, not averaged
+        juce::int64 blocks = 0;
+    };
+    std::vector<GatedBin> gatedBins;
+};
+
+// EBU R128 / ITU-R BS.1770-4 measurement: K-weighted integrated loudness with
+// absolute and relative gating, plus 4x oversampled true peak.
+class LoudnessAnalyser
+{
+public:
+    // ReplayGain 2.0 reference level
+    static constexpr double targetLufs = -18.0;
+    static constexpr double peakCeilingDb = -1.0;
+    static constexpr double absoluteGateLufs = -70.0;
+    static constexpr double relativeGateLu = -10.0;
+    static constexpr double binWidthLu = 0.1;
+
+    // Decodes the whole reader; returns an invalid result if shouldStop() turns true
+    static LoudnessResult analyse(juce::AudioFormatReader& reader, const std::function<bool()>& shouldStop);
+
+    // The tracks measured as one programme: their gated blocks pooled and gated again
+    static LoudnessResult combine(const std::vector<LoudnessResult>& tracks);
+
+    // Linear gain that brings the programme to targetLufs without pushing its true peak over the ceiling
+    static float getNormalisationGain(const LoudnessResult& result);
+
+    static double powerToLufs(double power) { return -0.691 + 10.0 * std::log10(power); }
+    static double lufsToPower(double lufs) { return std::pow(10.0, (lufs + 0.691) / 10.0); }
+    static int binIndex(double power);
+};
@@ -0,0 +1,169 @@
+#include "LoudnessScanner.h"
+
+LoudnessScanner::LoudnessScanner()
+{
+    // Creates the weak reference master here, before any worker copies it
+    self = this;
+
+    // Parsed on the scheduler: the scanner is created while the GUI is being built
+    scheduler->submit(JobScheduler::visibleRows, jobs, [this](const JobScheduler::Group&) { loadCache(); });
+}
+
+LoudnessScanner::~LoudnessScanner()
+{
+    jobs->cancelAndWait();
+    saveCache();
+}
+
+// ------------------- Queue -------------------
+void LoudnessScanner::scan(const juce::Array<juce::File>& files)
+{
+    {
+        // Without the cache every file would look new; these wait for it
+        const juce::ScopedLock sl(lock);
+        if(!cacheLoaded)
+        {
+            deferredScans.addArray(files);
+            return;
+        }
+    }
+
+    for(auto& file : files)
+    {
+        auto path = file.getFullPathName();
+        {
+            const juce::ScopedLock sl(lock);
+            auto it = cache.find(path);
+            if(queued.contains(path)) continue;
+            if(it != cache.end() && isUpToDate(it->second, file))
+            {
+                cacheHits.add(1.0);
+                continue;
+            }
+            cacheMisses.add(1.0);
+            queued.add(path);
+        }
+
+        ++pendingJobs;
+        scheduler->submit(JobScheduler::background, jobs, [this, file](const JobScheduler::Group& group){ analyseFile(file, group); });
+    }
+}
+
+bool LoudnessScanner::getResult(const juce::File& file, LoudnessResult& result) const
+{
+    const juce::ScopedLock sl(lock);
+    auto it = cache.find(file.getFullPathName());
+    if(it == cache.end() || !isUpToDate(it->second, file)) return false;
+    result = it->second.result;
+    return true;
+}
+
+// ------------------- Worker -------------------
+void LoudnessScanner::analyseFile(const juce::File& file, const JobScheduler::Group& group)
+{
+    CacheEntry entry;
+    entry.size = file.getSize();
+    entry.modified = file.getLastModificationTime().toMilliseconds();
+
+    auto reader = formats->createReaderFor(file);
+    if(reader != nullptr)
+        entry.result = LoudnessAnalyser::analyse(*reader, [&group]{ return group.isCancelled(); });
+
+    bool lastJob = --pendingJobs == 0;
+    {
+        const juce::ScopedLock sl(lock);
+        queued.removeString(file.getFullPathName());
+        if(entry.result.valid) cache[file.getFullPathName()] = entry;
+    }
+    if(group.isCancelled() || !entry.result.valid) return;
+
+    if(lastJob) saveCache();
+
+    juce::MessageManager::callAsync([weakThis = self, file]
+    {
+        if(weakThis != nullptr && weakThis->onResult) weakThis->onResult(file);
+    });
+}
+
+bool LoudnessScanner::isUpToDate(const CacheEntry& entry, const juce::File& file)
+{
+    return entry.size == file.getSize() && entry.modified == file.getLastModificationTime().toMilliseconds();
+}
+
+// ------------------- Disk cache -------------------
+// Scheduler thread; then queues the scans that arrived while it ran
+void LoudnessScanner::loadCache()
+{
+    std::map<juce::String, CacheEntry> loaded;
+    auto parsed = juce::JSON::parse(cacheFile);
+    if(auto* list = parsed.getArray())
+        for(auto& item : *list)
+        {
+            CacheEntry entry;
+            entry.size = (juce::int64)item.getProperty("size", 0);
+            entry.modified = (juce::int64)item.getProperty("modified", 0);
+            entry.result.valid = true;
+            entry.result.integratedLufs = item.getProperty("lufs", -70.0);
+            entry.result.truePeakDb = item.getProperty("truePeak", -100.0);
+            entry.result.gatedPower = item.getProperty("gatedPower", 0.0);
+            entry.result.gatedBlocks = (juce::int64)item.getProperty("gatedBlocks", 0);
+            if(auto* bins = item.getProperty("gatedBins", {}).getArray())
+                for(auto& bin : *bins)
+                    if(bin.size() == 3)
+                        entry.result.gatedBins.push_back({ (int)bin[0], (double)bin[1], (juce::int64)bin[2] });
+
+            // Entries written before the bins were kept can't be combined into an album; they are measured again
+            auto path = item.getProperty("file", {}).toString();
+            if(path.isNotEmpty() && (entry.result.gatedBlocks == 0 || !entry.result.gatedBins.empty()))
+                loaded[path] = entry;
+        }
+
+    juce::Array<juce::File> waiting;
+    {
+        const juce::ScopedLock sl(lock);
+        for(auto& [path, entry] : loaded)
+            cache.emplace(path, entry);
+        cacheLoaded = true;
+        waiting.swapWith(deferredScans);
+    }
+    if(waiting.isEmpty()) return;
+    scan(waiting);
+
+    // Files the cache already covered won't be analysed, so their results are announced here
+    juce::MessageManager::callAsync([weakThis = self, waiting]
+    {
+        if(weakThis == nullptr || !weakThis->onResult) return;
+        LoudnessResult result;
+        for(auto& file : waiting)
+            if(weakThis->getResult(file, result)) weakThis->onResult(file);
+    });
+}
+
+void LoudnessScanner::saveCache() const
+{
+    // Held across the write too, so a worker and the destructor never write the file at once
+    const juce::ScopedLock sl(lock);
+    if(!cacheLoaded) return; // would replace the file with what little is known so far
+    juce::Array<juce::var> list;
+    {
+        for(auto& [path, entry] : cache)
+        {
+            auto* obj = new juce::DynamicObject();
+            obj->setProperty("file", path);
+            obj->setProperty("size", entry.size);
+            obj->setProperty("modified", entry.modified);
+            obj->setProperty("lufs", entry.result.integratedLufs);
+            obj->setProperty("truePeak", entry.result.truePeakDb);
+            obj->setProperty("gatedPower", entry.result.gatedPower);
+            obj->setProperty("gatedBlocks", entry.result.gatedBlocks);
+            juce::Array<juce::var> bins;
+            for(auto& bin : entry.result.gatedBins)
+                bins.add(juce::Array<juce::var> { bin.index, bin.power, bin.blocks });
+            obj->setProperty("gatedBins", bins);
+            list.add(juce::var(obj));
+        }
+    }
+
+    cacheFile.getParentDirectory().createDirectory();
+    cacheFile.replaceWithText(juce::JSON::toString(list));
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <JuceHeader.h>
+#include "LoudnessAnalyser.h"
+#include "JobScheduler.h"
+#include "FormatRegistry.h"
+#include "Metrics.h"
+#include <atomic>
+#include <map>
+
+// Measures playlist files in the background and keeps the results in an
+// on-disk cache, so each file is decoded for analysis only once.
+class LoudnessScanner
+{
+public:
+    LoudnessScanner();
+    ~LoudnessScanner();
+
+    // Queues every file that has no up-to-date cache entry
+    void scan(const juce::Array<juce::File>& files);
+    bool getResult(const juce::File& file, LoudnessResult& result) const;
+
+    // Called on the message thread when a file has been measured
+    std::function<void(const juce::File&)> onResult;
+
+private:
+    struct CacheEntry
+    {
+        juce::int64 size = 0;
+        juce::int64 modified = 0;
+        LoudnessResult result;
+    };
+
+    juce::SharedResourcePointer<FormatRegistry> formats;
+    juce::File cacheFile = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+                               .getChildFile("SimpleAudioPlayer").getChildFile("loudness-cache.json");
+
+    mutable juce::CriticalSection lock;
+    std::map<juce::String, CacheEntry> cache;
+    juce::StringArray queued;
+    bool cacheLoaded = false;
+    juce::Array<juce::File> deferredScans; // scan() calls made before the cache was loaded
+    std::atomic<int> pendingJobs { 0 };
+    // Workers copy this one; making a WeakReference from this on several threads at once races
+    juce::WeakReference<LoudnessScanner> self;
+
+    juce::SharedResourcePointer<Metrics> metrics;
+    Metrics::Value& cacheHits = metrics->getCounter("player_cache_lookups_total", "Cache lookups by cache and result", "cache=\"loudness\",result=\"hit\"");
+    Metrics::Value& cacheMisses = metrics->getCounter("player_cache_lookups_total", "Cache lookups by cache and result", "cache=\"loudness\",result=\"miss\"");
+
+    // Analysis runs in the scheduler's background class, behind anything the user is waiting for
+    juce::SharedResourcePointer<JobScheduler> scheduler;
+    JobScheduler::GroupPtr jobs = JobScheduler::createGroup();
+
+    void analyseFile(const juce::File& file, const JobScheduler::Group& group);
+    static bool isUpToDate(const CacheEntry& entry, const juce::File& file);
+    void loadCache();
+    void saveCache() const;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(LoudnessScanner)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoudnessScanner)
+};
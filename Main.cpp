@@ -1,5 +1,10 @@
 #include <JuceHeader.h>
 #include "MainComponent.h"
+#include "StartupProfiler.h"
+#include "ParametricEq.h"
+#include "DeckMixer.h"
+#include "Metrics.h"
+#include <iostream>
 
 // Our application class
 class SimpleAudioPlayer : public juce::JUCEApplication
@@ -8,15 +13,43 @@ public:
     const juce::String getApplicationName() override { return "Simple Audio Player"; }
     const juce::String getApplicationVersion() override { return "1.0"; }
 
-    void initialise(const juce::String&) override
+    void initialise(const juce::String& commandLine) override
     {
+        // Benchmarks run without a window and quit when done
+        if(commandLine.contains("--bench-eq"))
+        {
+            std::cout << ParametricEq::runBenchmark().toStdString() << std::flush;
+            quit();
+            return;
+        }
+        if(commandLine.contains("--bench-decks"))
+        {
+            std::cout << DeckMixer::runBenchmark().toStdString() << std::flush;
+            quit();
+            return;
+        }
+
+        StartupProfiler::begin();
+
+        // --metrics-file=<path> [--metrics-interval=<seconds>]: .json for JSON, anything else Prometheus text
+        auto args = juce::StringArray::fromTokens(commandLine, true);
+        for(auto& arg : args)
+            if(arg.startsWith("--metrics-file="))
+            {
+                auto file = juce::File::getCurrentWorkingDirectory().getChildFile(arg.fromFirstOccurrenceOf("=", false, false).unquoted());
+                auto interval = commandLine.fromFirstOccurrenceOf("--metrics-interval=", false, false).getDoubleValue();
+                metricsExporter = std::make_unique<MetricsExporter>(file, interval > 0.0 ? interval : 10.0);
+            }
+
         // Create and show the main window
         mainWindow = std::make_unique<MainWindow>(getApplicationName());
+        StartupProfiler::mark("main window shown");
     }
 
     void shutdown() override
     {
         mainWindow = nullptr; // Clean up
+        metricsExporter = nullptr;
     }
 
 private:
@@ -42,6 +75,7 @@ private:
     };
 
     std::unique_ptr<MainWindow> mainWindow;
+    std::unique_ptr<MetricsExporter> metricsExporter;
 };
 
 // This macro starts the app
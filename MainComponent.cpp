@@ -1,17 +1,48 @@
 #include "MainComponent.h"
+#include "RealtimeChecker.h"
 
 MainComponent::MainComponent()
 {
     addAndMakeVisible(playerGUI);
-    setSize(900, 600);
+    setSize(900, 700);
 
     // --- Enable audio output ---
     setAudioChannels(0, 2); // 0 inputs, 2 outputs
+    startTimer(1000);
+
+    // --control-port=<port> [--osc-port=<port>]: remote control from this machine (0 picks a free port)
+    // --extra-output=<device name>, repeatable: play the same output on that device too
+    int controlPort = -1, oscPort = -1;
+    for(auto& arg : juce::JUCEApplicationBase::getCommandLineParameterArray())
+    {
+        if(arg.startsWith("--control-port=")) controlPort = arg.fromFirstOccurrenceOf("=", false, false).getIntValue();
+        if(arg.startsWith("--osc-port=")) oscPort = arg.fromFirstOccurrenceOf("=", false, false).getIntValue();
+        if(arg.startsWith("--extra-output="))
+        {
+            auto deviceName = arg.fromFirstOccurrenceOf("=", false, false).unquoted();
+            auto error = extraOutputs.addOutput(deviceName);
+            juce::Logger::writeToLog("[output] " + deviceName + ": " + (error.isEmpty() ? juce::String("playing") : error));
+        }
+    }
+    if(controlPort >= 0 || oscPort >= 0)
+        playerGUI.startControlServer(controlPort, oscPort);
 }
 
 MainComponent::~MainComponent()
 {
     shutdownAudio();
+    extraOutputs.removeAllOutputs();
+}
+
+// Device statistics for the metrics exporter; the device only updates them once per callback.
+// Counters only ever grow, so they take what is new since the last tick.
+void MainComponent::timerCallback()
+{
+    const int xruns = deviceManager.getXRunCount();
+    xrunsMetric.add(xruns >= lastXRunCount ? xruns - lastXRunCount : xruns);
+    lastXRunCount = xruns;
+    cpuMetric.set(deviceManager.getCpuUsage());
+    extraOutputs.updateMetrics();
 }
 
 void MainComponent::resized()
@@ -22,12 +53,22 @@ void MainComponent::resized()
 // --- Audio callbacks ---
 void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-    playerGUI.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    auto* device = deviceManager.getCurrentAudioDevice();
+    const int numOutputChannels = device != nullptr ? device->getActiveOutputChannels().countNumberOfSetBits() : 2;
+    playerGUI.prepareToPlay(samplesPerBlockExpected, sampleRate, juce::jmax(1, numOutputChannels));
+
+    // The extra outputs report their latency against the moment this device plays a sample
+    double mainLatency = 0.0;
+    if(device != nullptr)
+        mainLatency = (device->getOutputLatencyInSamples() + device->getCurrentBufferSizeSamples()) / sampleRate;
+    extraOutputs.prepare(sampleRate, mainLatency);
 }
 
 void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
+    const RealtimeChecker::ScopedAudioCallback realtimeScope;
     playerGUI.getNextAudioBlock(bufferToFill);
+    extraOutputs.push(bufferToFill);
 }
 
 void MainComponent::releaseResources()
@@ -1,8 +1,11 @@
 #pragma once
 #include <JuceHeader.h>
 #include "PlayerGUI.h"
+#include "Metrics.h"
+#include "MultiDeviceOutput.h"
 
-class MainComponent : public juce::AudioAppComponent
+class MainComponent : public juce::AudioAppComponent,
+                      private juce::Timer
 {
 public:
     MainComponent();
@@ -17,6 +20,14 @@ public:
 
 private:
     PlayerGUI playerGUI;
+    MultiDeviceOutput extraOutputs;
+
+    juce::SharedResourcePointer<Metrics> metrics;
+    Metrics::Value& xrunsMetric = metrics->getCounter("player_audio_xruns_total", "Buffer under- and overruns reported by the audio device");
+    int lastXRunCount = 0; // the device's own count, which starts again at 0 when it is reopened
+    Metrics::Value& cpuMetric = metrics->getGauge("player_audio_cpu_ratio", "Share of the callback period spent rendering");
+
+    void timerCallback() override;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 };
@@ -0,0 +1,92 @@
+#include "MarkerStore.h"
+#include <algorithm>
+#include <cmath>
+
+int MarkerStore::add(const Marker& marker)
+{
+    auto it = std::upper_bound(markers.begin(), markers.end(), marker, isBefore);
+    return (int)std::distance(markers.begin(), markers.insert(it, marker));
+}
+
+void MarkerStore::remove(int index)
+{
+    if(index >= 0 && index < size())
+        markers.erase(markers.begin() + index);
+}
+
+void MarkerStore::removeChapters()
+{
+    markers.erase(std::remove_if(markers.begin(), markers.end(), [](const Marker& m){ return m.isChapter; }),
+                  markers.end());
+}
+
+void MarkerStore::clear()
+{
+    markers.clear();
+}
+
+void MarkerStore::addBatch(const std::vector<Marker>& newMarkers)
+{
+    auto oldSize = (std::ptrdiff_t)markers.size();
+    markers.insert(markers.end(), newMarkers.begin(), newMarkers.end());
+    std::stable_sort(markers.begin() + oldSize, markers.end(), isBefore);
+    std::inplace_merge(markers.begin(), markers.begin() + oldSize, markers.end(), isBefore);
+}
+
+// ------------------- Lookups -------------------
+int MarkerStore::findNext(double position, double tolerance) const
+{
+    Marker key; key.position = position + tolerance;
+    auto it = std::upper_bound(markers.begin(), markers.end(), key, isBefore);
+    return it == markers.end() ? -1 : (int)std::distance(markers.begin(), it);
+}
+
+int MarkerStore::findPrevious(double position, double tolerance) const
+{
+    Marker key; key.position = position - tolerance;
+    auto it = std::lower_bound(markers.begin(), markers.end(), key, isBefore);
+    return it == markers.begin() ? -1 : (int)std::distance(markers.begin(), it) - 1;
+}
+
+juce::Range<int> MarkerStore::findInRange(double start, double end) const
+{
+    Marker from; from.position = start;
+    Marker to; to.position = end;
+    auto first = std::lower_bound(markers.begin(), markers.end(), from, isBefore);
+    auto last = std::lower_bound(first, markers.end(), to, isBefore);
+    return { (int)std::distance(markers.begin(), first), (int)std::distance(markers.begin(), last) };
+}
+
+// ------------------- Persistence -------------------
+juce::var MarkerStore::toVar() const
+{
+    juce::Array<juce::var> list;
+    for(auto& m : markers)
+    {
+        if(m.isChapter) continue;
+        auto* obj = new juce::DynamicObject();
+        obj->setProperty("name", m.name);
+        obj->setProperty("position", m.position);
+        list.add(juce::var(obj));
+    }
+    return list;
+}
+
+void MarkerStore::fromVar(const juce::var& data)
+{
+    std::vector<Marker> loaded;
+    if(auto* list = data.getArray())
+    {
+        loaded.reserve((size_t)list->size());
+        for(auto& item : *list)
+        {
+            Marker m;
+            m.name = item.getProperty("name", {}).toString();
+            m.position = (double)item.getProperty("position", 0.0);
+            if(std::isfinite(m.position) && m.position >= 0.0)
+                loaded.push_back(m);
+        }
+    }
+    clear();
+    addBatch(loaded);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+// Markers of one track, kept sorted by position.
+// Lookups are binary searches, so next/previous jumps and the markers inside a
+// visible time range stay cheap with thousands of entries.
+class MarkerStore
+{
+public:
+    struct Marker
+    {
+        juce::String name;
+        double position = 0.0;
+        bool isChapter = false; // generated from cue/chapter data, not saved with the session
+    };
+
+    int size() const { return (int)markers.size(); }
+    bool isEmpty() const { return markers.empty(); }
+    const Marker& operator[](int index) const { return markers[(size_t)index]; }
+
+    int add(const Marker& marker);
+    void remove(int index);
+    void removeChapters();
+    void clear();
+
+    // Adds many markers with one sort instead of one insertion each
+    void addBatch(const std::vector<Marker>& newMarkers);
+
+    // Index of the first marker after / last marker before position, or -1.
+    // Markers closer than tolerance count as "here" and are skipped.
+    int findNext(double position, double tolerance = 0.05) const;
+    int findPrevious(double position, double tolerance = 0.05) const;
+
+    // Half-open index range [first, last) of markers with start <= position < end
+    juce::Range<int> findInRange(double start, double end) const;
+
+    juce::var toVar() const;
+    void fromVar(const juce::var& data);
+
+private:
+    std::vector<Marker> markers;
+
+    static bool isBefore(const Marker& a, const Marker& b) { return a.position < b.position; }
+};
@@ -0,0 +1,72 @@
+#include "MeterDisplay.h"
+#include <cmath>
+
+MeterDisplay::MeterDisplay(LevelMeter& meterToShow)
+    : meter(meterToShow)
+{
+    setOpaque(true);
+    lastTick = juce::Time::getMillisecondCounterHiRes();
+    startTimerHz(30);
+}
+
+void MeterDisplay::timerCallback()
+{
+    const double now = juce::Time::getMillisecondCounterHiRes();
+    const float fall = peakFallDbPerSecond * (float)((now - lastTick) / 1000.0);
+    lastTick = now;
+
+    bool changed = meter.getNumChannels() != numChannels;
+    numChannels = meter.getNumChannels();
+
+    for(int ch = 0; ch < numChannels; ++ch)
+    {
+        auto levels = meter.read(ch);
+        auto& display = channels[(size_t)ch];
+        const auto previous = display;
+
+        display.rmsDb = juce::Decibels::gainToDecibels(levels.rms, minDb);
+        display.peakDb = juce::jmax(juce::Decibels::gainToDecibels(levels.peak, minDb), display.peakDb - fall);
+
+        float truePeakDb = juce::Decibels::gainToDecibels(levels.truePeak, minDb);
+        if(truePeakDb >= display.truePeakDb || now - display.truePeakHeldAt > truePeakHoldSeconds * 1000.0)
+        {
+            display.truePeakDb = truePeakDb;
+            display.truePeakHeldAt = now;
+        }
+
+        // Sub-0.1 dB movements are invisible at this size
+        changed = changed || std::abs(display.rmsDb - previous.rmsDb) > 0.1f
+                          || std::abs(display.peakDb - previous.peakDb) > 0.1f
+                          || display.truePeakDb != previous.truePeakDb;
+    }
+
+    if(changed) repaint();
+}
+
+float MeterDisplay::dbToY(float db, juce::Rectangle<float> area) const
+{
+    return juce::jmap(juce::jlimit(minDb, 0.0f, db), minDb, 0.0f, area.getBottom(), area.getY());
+}
+
+void MeterDisplay::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colour(20,20,20));
+    if(numChannels == 0) return;
+
+    auto bounds = getLocalBounds().toFloat().reduced(2.0f);
+    const float barWidth = bounds.getWidth() / (float)numChannels;
+    for(int ch = 0; ch < numChannels; ++ch)
+    {
+        auto& display = channels[(size_t)ch];
+        auto bar = bounds.withX(bounds.getX() + barWidth * (float)ch).withWidth(barWidth).reduced(1.0f, 0.0f);
+
+        g.setColour(juce::Colours::green);
+        g.fillRect(bar.withTop(dbToY(display.rmsDb, bar)));
+
+        g.setColour(juce::Colours::orange);
+        g.drawHorizontalLine((int)dbToY(display.peakDb, bar), bar.getX(), bar.getRight());
+
+        g.setColour(display.truePeakDb > -1.0f ? juce::Colours::red : juce::Colours::white);
+        g.fillRect(bar.withTop(dbToY(display.truePeakDb, bar)).withHeight(2.0f));
+    }
+}
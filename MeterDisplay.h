@@ -0,0 +1,37 @@
+#pragma once
+#include <JuceHeader.h>
+#include "LevelMeter.h"
+#include <array>
+
+// Vertical bars for a LevelMeter: RMS filled, sample peak as a line that falls back
+// slowly, and a held true-peak marker that turns red above -1 dBTP.
+// Polls the meter on its own timer and repaints only itself, and only when a bar moved.
+class MeterDisplay : public juce::Component,
+                     private juce::Timer
+{
+public:
+    explicit MeterDisplay(LevelMeter& meterToShow);
+
+    void paint(juce::Graphics& g) override;
+
+    static constexpr float minDb = -60.0f;
+    static constexpr float peakFallDbPerSecond = 20.0f;
+    static constexpr double truePeakHoldSeconds = 2.0;
+
+private:
+    struct ChannelDisplay
+    {
+        float rmsDb = minDb, peakDb = minDb, truePeakDb = minDb;
+        double truePeakHeldAt = 0.0;
+    };
+
+    LevelMeter& meter;
+    std::array<ChannelDisplay, LevelMeter::maxChannels> channels;
+    int numChannels = 0;
+    double lastTick = 0.0;
+
+    void timerCallback() override;
+    float dbToY(float db, juce::Rectangle<float> area) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MeterDisplay)
+};
@@ -0,0 +1,119 @@
+#include "Metrics.h"
+
+// ------------------- Registry -------------------
+Metrics::Value& Metrics::getCounter(const juce::String& name, const juce::String& help, const juce::String& labels)
+{
+    return getOrAdd(counter, name, help, labels);
+}
+
+Metrics::Value& Metrics::getGauge(const juce::String& name, const juce::String& help, const juce::String& labels)
+{
+    return getOrAdd(gauge, name, help, labels);
+}
+
+Metrics::Value& Metrics::getOrAdd(Type type, const juce::String& name, const juce::String& help, const juce::String& labels)
+{
+    const juce::ScopedLock sl(lock);
+    for(auto& s : series)
+        if(s.name == name && s.labels == labels)
+            return s.value;
+
+    auto& s = series.emplace_back();
+    s.name = name;
+    s.help = help;
+    s.labels = labels;
+    s.type = type;
+    return s.value;
+}
+
+void Metrics::addComputedGauge(const juce::String& name, const juce::String& help, std::function<double()> compute)
+{
+    const juce::ScopedLock sl(lock);
+    for(auto& s : series)
+        if(s.name == name)
+        {
+            s.compute = std::move(compute);
+            return;
+        }
+
+    auto& s = series.emplace_back();
+    s.name = name;
+    s.help = help;
+    s.type = gauge;
+    s.compute = std::move(compute);
+}
+
+// ------------------- Formats -------------------
+juce::String Metrics::toPrometheusText() const
+{
+    const juce::ScopedLock sl(lock);
+    juce::String text;
+    juce::StringArray described;
+    for(auto& s : series)
+    {
+        // HELP and TYPE once per family, before its first sample
+        if(!described.contains(s.name))
+        {
+            described.add(s.name);
+            text << "# HELP " << s.name << " " << s.help << "\n"
+                 << "# TYPE " << s.name << (s.type == counter ? " counter\n" : " gauge\n");
+        }
+        text << s.name;
+        if(s.labels.isNotEmpty()) text << "{" << s.labels << "}";
+        text << " " << juce::String(s.read(), 6) << "\n";
+    }
+    return text;
+}
+
+juce::String Metrics::toJson() const
+{
+    const juce::ScopedLock sl(lock);
+    auto* root = new juce::DynamicObject();
+    juce::var rootVar(root);
+    root->setProperty("timestamp", juce::Time::getCurrentTime().toISO8601(true));
+
+    juce::Array<juce::var> samples;
+    for(auto& s : series)
+    {
+        auto* sample = new juce::DynamicObject();
+        sample->setProperty("name", s.name);
+        sample->setProperty("type", s.type == counter ? "counter" : "gauge");
+        if(s.labels.isNotEmpty()) sample->setProperty("labels", s.labels);
+        sample->setProperty("value", s.read());
+        samples.add(juce::var(sample));
+    }
+    root->setProperty("metrics", samples);
+    return juce::JSON::toString(rootVar, true);
+}
+
+// ------------------- Exporter -------------------
+MetricsExporter::MetricsExporter(const juce::File& targetFile, double intervalSeconds)
+    : juce::Thread("Metrics exporter"), target(targetFile),
+      intervalMs(juce::jmax(100, juce::roundToInt(intervalSeconds * 1000.0)))
+{
+    startThread(juce::Thread::Priority::background);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    stopThread(2000);
+    writeNow(); // final values on a clean exit
+}
+
+bool MetricsExporter::writeNow()
+{
+    auto text = target.hasFileExtension("json") ? metrics->toJson() : metrics->toPrometheusText();
+    target.getParentDirectory().createDirectory();
+    juce::TemporaryFile temp(target);
+    return temp.getFile().replaceWithText(text) && temp.overwriteTargetFileWithTemporary();
+}
+
+void MetricsExporter::run()
+{
+    while(!threadShouldExit())
+    {
+        if(!writeNow())
+            juce::Logger::writeToLog("[metrics] could not write " + target.getFullPathName());
+        wait(intervalMs);
+    }
+}
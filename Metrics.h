@@ -0,0 +1,77 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+
+// Counters and gauges for monitoring, shared through juce::SharedResourcePointer.
+// - Components look their Values up once (that takes a lock) and keep the references;
+//   updating a Value is then a single atomic operation, safe on the audio thread.
+// - Computed gauges are evaluated when the metrics are written, so they must only read atomics.
+// - toPrometheusText() and toJson() snapshot every value without blocking the updaters.
+class Metrics
+{
+public:
+    enum Type { counter, gauge };
+
+    class Value
+    {
+    public:
+        void set(double newValue) { value.store(newValue, std::memory_order_relaxed); }
+        void add(double delta)
+        {
+            double current = value.load(std::memory_order_relaxed);
+            while(!value.compare_exchange_weak(current, current + delta, std::memory_order_relaxed)) {}
+        }
+        double get() const { return value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<double> value { 0.0 };
+    };
+
+    // Names follow Prometheus conventions; labels are written as in the exposition format,
+    // e.g. cache="format",result="hit"
+    Value& getCounter(const juce::String& name, const juce::String& help, const juce::String& labels = {});
+    Value& getGauge(const juce::String& name, const juce::String& help, const juce::String& labels = {});
+    void addComputedGauge(const juce::String& name, const juce::String& help, std::function<double()> compute);
+
+    juce::String toPrometheusText() const;
+    juce::String toJson() const;
+
+private:
+    struct Series
+    {
+        juce::String name, help, labels;
+        Type type = counter;
+        Value value;
+        std::function<double()> compute;
+
+        double read() const { return compute != nullptr ? compute() : value.get(); }
+    };
+
+    juce::CriticalSection lock;
+    std::deque<Series> series; // deque: references handed out stay valid as it grows
+
+    Value& getOrAdd(Type type, const juce::String& name, const juce::String& help, const juce::String& labels);
+};
+
+// Writes the registry to a file every few seconds from its own thread. A ".json" file gets
+// JSON, anything else the Prometheus text format (e.g. for node_exporter's textfile collector).
+// Each write goes to a temporary file that is then renamed, so readers never see half a file.
+class MetricsExporter : private juce::Thread
+{
+public:
+    MetricsExporter(const juce::File& targetFile, double intervalSeconds);
+    ~MetricsExporter() override;
+
+    bool writeNow();
+
+private:
+    juce::SharedResourcePointer<Metrics> metrics;
+    juce::File target;
+    int intervalMs;
+
+    void run() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MetricsExporter)
+};
@@ -0,0 +1,165 @@
+#include "MultiDeviceOutput.h"
+#include "RealtimeChecker.h"
+
+// ------------------- Output -------------------
+// One extra device: its own device manager, with the bridge's reader as its callback
+class MultiDeviceOutput::Output : public juce::AudioIODeviceCallback
+{
+public:
+    explicit Output(const juce::String& name)
+        : deviceName(name),
+          labels("output=\"" + name.replaceCharacter('"', '\'') + "\"")
+    {
+    }
+
+    ~Output() override
+    {
+        deviceManager.removeAudioCallback(this);
+        deviceManager.closeAudioDevice();
+    }
+
+    juce::String open()
+    {
+        juce::AudioDeviceManager::AudioDeviceSetup setup;
+        setup.outputDeviceName = deviceName;
+        auto error = deviceManager.initialise(0, ClockBridge::numChannels, nullptr, false, deviceName, &setup);
+        auto* device = deviceManager.getCurrentAudioDevice();
+        if(error.isEmpty() && (device == nullptr || device->getName() != deviceName))
+            error = "No output device called \"" + deviceName + "\"";
+        if(error.isNotEmpty()) return error;
+
+        deviceManager.addAudioCallback(this);
+        return {};
+    }
+
+    void audioDeviceAboutToStart(juce::AudioIODevice* device) override
+    {
+        const double rate = device->getCurrentSampleRate();
+        const int blockSize = device->getCurrentBufferSizeSamples();
+        // Some drivers hand over larger blocks than they announce
+        bridge.prepareOutput(rate, blockSize * 2);
+        deviceLatency.store((device->getOutputLatencyInSamples() + blockSize) / rate);
+        sampleRate.store(rate);
+        running.store(true);
+    }
+
+    void audioDeviceStopped() override
+    {
+        running.store(false);
+    }
+
+    void audioDeviceIOCallbackWithContext(const float* const*, int, float* const* outputChannelData, int numOutputChannels,
+                                          int numSamples, const juce::AudioIODeviceCallbackContext&) override
+    {
+        const RealtimeChecker::ScopedAudioCallback realtimeScope;
+        bridge.read(outputChannelData, numOutputChannels, numSamples);
+    }
+
+    const juce::String deviceName;
+    ClockBridge bridge { targetLatencySeconds };
+    std::atomic<bool> running { false };
+    std::atomic<double> sampleRate { 0.0 }, deviceLatency { 0.0 };
+
+    const juce::String labels;
+    juce::SharedResourcePointer<Metrics> metrics;
+    Metrics::Value& driftMetric = metrics->getGauge("player_output_drift_ppm", "Clock drift of an extra output against the main device", labels);
+    Metrics::Value& latencyMetric = metrics->getGauge("player_output_latency_ms", "How far an extra output plays behind the main device", labels);
+    Metrics::Value& bufferedMetric = metrics->getGauge("player_output_buffered_ms", "Audio waiting for an extra output", labels);
+    Metrics::Value& underrunsMetric = metrics->getCounter("player_output_underruns_total", "Times an extra output ran out of audio and played silence", labels);
+    Metrics::Value& overrunsMetric = metrics->getCounter("player_output_overruns_total", "Blocks dropped because an extra output fell behind", labels);
+
+private:
+    juce::AudioDeviceManager deviceManager;
+};
+
+// ------------------- MultiDeviceOutput -------------------
+MultiDeviceOutput::~MultiDeviceOutput()
+{
+    removeAllOutputs();
+}
+
+juce::String MultiDeviceOutput::addOutput(const juce::String& deviceName)
+{
+    const int index = numActive.load();
+    if(index == maxOutputs) return "At most " + juce::String(maxOutputs) + " extra outputs";
+
+    auto output = std::make_unique<Output>(deviceName);
+    output->bridge.setInputRate(inputRate.load());
+    auto error = output->open();
+    if(error.isNotEmpty()) return error;
+
+    // push() only looks at the slots below numActive
+    outputs[(size_t)index] = std::move(output);
+    numActive.store(index + 1);
+    return {};
+}
+
+void MultiDeviceOutput::removeAllOutputs()
+{
+    const int count = numActive.exchange(0);
+    while(pushesInFlight.load() > 0) juce::Thread::yield();
+    for(int i = 0; i < count; ++i)
+        outputs[(size_t)i].reset();
+}
+
+void MultiDeviceOutput::prepare(double sampleRate, double mainLatencySeconds)
+{
+    inputRate.store(sampleRate);
+    mainLatency.store(mainLatencySeconds);
+    const int count = numActive.load();
+    for(int i = 0; i < count; ++i)
+        outputs[(size_t)i]->bridge.setInputRate(sampleRate);
+}
+
+// ------------------- Main audio thread -------------------
+void MultiDeviceOutput::push(const juce::AudioSourceChannelInfo& info)
+{
+    pushesInFlight.fetch_add(1);
+    const int count = numActive.load();
+    for(int i = 0; i < count; ++i)
+    {
+        // A stopped device would only fill its ring with overruns; it starts afresh anyway
+        auto& output = *outputs[(size_t)i];
+        if(output.running.load())
+            output.bridge.write(info);
+    }
+    pushesInFlight.fetch_sub(1);
+}
+
+// ------------------- Stats -------------------
+std::vector<MultiDeviceOutput::OutputStats> MultiDeviceOutput::getStats() const
+{
+    std::vector<OutputStats> result;
+    const int count = numActive.load();
+    for(int i = 0; i < count; ++i)
+    {
+        const auto& output = *outputs[(size_t)i];
+        const auto bridgeStats = output.bridge.getStats();
+
+        OutputStats stats;
+        stats.deviceName = output.deviceName;
+        stats.sampleRate = output.sampleRate.load();
+        stats.driftPpm = bridgeStats.driftPpm;
+        stats.bufferedMs = bridgeStats.bufferedMs;
+        // The controller holds the ring at its target, so that is the bridge's share of the delay
+        stats.latencyMs = (output.bridge.getTargetLatencySeconds() + output.deviceLatency.load() - mainLatency.load()) * 1000.0;
+        stats.underruns = bridgeStats.underruns;
+        stats.overruns = bridgeStats.overruns;
+        result.push_back(stats);
+    }
+    return result;
+}
+
+void MultiDeviceOutput::updateMetrics()
+{
+    const auto stats = getStats();
+    for(size_t i = 0; i < stats.size(); ++i)
+    {
+        auto& output = *outputs[i];
+        output.driftMetric.set(stats[i].driftPpm);
+        output.latencyMetric.set(stats[i].latencyMs);
+        output.bufferedMetric.set(stats[i].bufferedMs);
+        output.underrunsMetric.set(stats[i].underruns);
+        output.overrunsMetric.set(stats[i].overruns);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <JuceHeader.h>
+#include "ClockBridge.h"
+#include "Metrics.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Plays what the main device renders on further output devices as well, e.g. the PA and a
+// monitor. The player is rendered once, on the main device's callback.
+// - push() copies each block into one ClockBridge per extra device. Each device's own
+//   callback pulls from its bridge and resamples onto its own clock, so a slow or stopped
+//   device never holds up the main one.
+// - The main device is the clock master. The extra outputs play targetLatencySeconds plus
+//   their own device latency behind it; getStats() reports that offset and each clock's drift.
+// addOutput() and removeAllOutputs() are for the message thread.
+class MultiDeviceOutput
+{
+public:
+    static constexpr int maxOutputs = 4;
+    static constexpr double targetLatencySeconds = 0.04;
+
+    struct OutputStats
+    {
+        juce::String deviceName;
+        double sampleRate = 0.0;
+        double driftPpm = 0.0;   // positive when the device's clock runs slow against the main one
+        double bufferedMs = 0.0;
+        double latencyMs = 0.0;  // how far it plays behind the main device
+        int underruns = 0, overruns = 0;
+    };
+
+    MultiDeviceOutput() = default;
+    ~MultiDeviceOutput();
+
+    // Opens the named output device of the default device type; returns an error, or an empty string
+    juce::String addOutput(const juce::String& deviceName);
+    void removeAllOutputs();
+    int getNumOutputs() const { return numActive.load(); }
+
+    // From the main device's prepareToPlay; mainLatencySeconds is that device's output latency
+    void prepare(double sampleRate, double mainLatencySeconds);
+    // Main audio thread, after the player has rendered into the block
+    void push(const juce::AudioSourceChannelInfo& info);
+
+    std::vector<OutputStats> getStats() const;
+    // Message thread: copies the stats into the player_output_* metrics
+    void updateMetrics();
+
+private:
+    class Output;
+
+    std::array<std::unique_ptr<Output>, maxOutputs> outputs;
+    std::atomic<int> numActive { 0 };
+    std::atomic<int> pushesInFlight { 0 }; // removeAllOutputs() waits for these before closing devices
+    std::atomic<double> inputRate { 0.0 }, mainLatency { 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MultiDeviceOutput)
+};
@@ -0,0 +1,109 @@
+#include "OutputRecorder.h"
+
+OutputRecorder::OutputRecorder()
+{
+    writerThread.startThread();
+}
+
+OutputRecorder::~OutputRecorder()
+{
+    stop();
+    writerThread.stopThread(2000);
+}
+
+void OutputRecorder::prepare(double newSampleRate)
+{
+    if(newSampleRate == sampleRate) return;
+    stop();
+    sampleRate = newSampleRate;
+}
+
+bool OutputRecorder::start(const juce::File& file)
+{
+    stop();
+
+    std::unique_ptr<juce::AudioFormat> format;
+    if(file.hasFileExtension("flac")) format = std::make_unique<juce::FlacAudioFormat>();
+    else format = std::make_unique<juce::WavAudioFormat>();
+
+    file.deleteFile();
+    auto stream = std::make_unique<juce::FileOutputStream>(file, (size_t)streamBufferBytes);
+    if(stream->failedToOpen()) return false;
+
+    writer.reset(format->createWriterFor(stream.get(), sampleRate, numChannels, bitsPerSample, {}, 0));
+    if(writer == nullptr) return false;
+    stream.release(); // the writer owns it now
+
+    const int fifoSize = juce::roundToInt(sampleRate * fifoSeconds);
+    fifoBuffer.setSize(numChannels, fifoSize);
+    fifo.setTotalSize(fifoSize);
+    fifo.reset();
+
+    recordingFile = file;
+    recordedSamples.store(0);
+    droppedBlocks.store(0);
+    active.store(true);
+    writerThread.addTimeSliceClient(this);
+    return true;
+}
+
+void OutputRecorder::stop()
+{
+    if(writer == nullptr) return;
+
+    // Once no push() is still writing and the thread has let go, whatever is left is flushed here
+    active.store(false);
+    while(pushesInFlight.load() > 0) juce::Thread::yield();
+    writerThread.removeTimeSliceClient(this);
+    drain();
+    writer.reset();
+}
+
+// ------------------- Writer thread -------------------
+int OutputRecorder::useTimeSlice()
+{
+    drain();
+    return pollIntervalMs;
+}
+
+void OutputRecorder::drain()
+{
+    const auto scope = fifo.read(fifo.getNumReady());
+    auto writeRange = [this](int start, int size)
+    {
+        if(size == 0) return;
+        const float* channels[numChannels];
+        for(int ch = 0; ch < numChannels; ++ch) channels[ch] = fifoBuffer.getReadPointer(ch, start);
+        writer->writeFromFloatArrays(channels, numChannels, size);
+    };
+    writeRange(scope.startIndex1, scope.blockSize1);
+    writeRange(scope.startIndex2, scope.blockSize2);
+}
+
+// ------------------- Audio thread -------------------
+void OutputRecorder::push(const juce::AudioSourceChannelInfo& info)
+{
+    pushesInFlight.fetch_add(1);
+    const int available = info.buffer->getNumChannels();
+    if(active.load() && available > 0)
+    {
+        if(fifo.getFreeSpace() >= info.numSamples)
+        {
+            // A mono buffer is written to both channels
+            const auto scope = fifo.write(info.numSamples);
+            for(int ch = 0; ch < numChannels; ++ch)
+            {
+                const int source = juce::jmin(ch, available - 1);
+                if(scope.blockSize1 > 0) fifoBuffer.copyFrom(ch, scope.startIndex1, *info.buffer, source, info.startSample, scope.blockSize1);
+                if(scope.blockSize2 > 0) fifoBuffer.copyFrom(ch, scope.startIndex2, *info.buffer, source, info.startSample + scope.blockSize1, scope.blockSize2);
+            }
+            recordedSamples.fetch_add(info.numSamples);
+        }
+        else
+        {
+            droppedBlocks.fetch_add(1);
+            droppedBlocksMetric.add(1.0);
+        }
+    }
+    pushesInFlight.fetch_sub(1);
+}
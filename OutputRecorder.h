@@ -0,0 +1,61 @@
+#pragma once
+#include <JuceHeader.h>
+#include "Metrics.h"
+#include <atomic>
+#include <memory>
+
+// Writes what the player renders (speed, loops, EQ and gain included) to a WAV or FLAC file.
+// - push() runs on the audio thread and only copies the block into a lock-free FIFO; it never
+//   wakes the writer thread, which polls the FIFO, encodes and writes through a large file buffer.
+// - The FIFO holds fifoSeconds of audio. If the disk falls that far behind, whole blocks are
+//   dropped and counted instead of waiting, so recording can never cause an xrun.
+// start() and stop() are for the message thread.
+class OutputRecorder : private juce::TimeSliceClient
+{
+public:
+    static constexpr int numChannels = 2;
+    static constexpr int bitsPerSample = 24;
+    static constexpr double fifoSeconds = 4.0;
+    static constexpr int streamBufferBytes = 1 << 20;
+    static constexpr int pollIntervalMs = 20;
+
+    OutputRecorder();
+    ~OutputRecorder() override;
+
+    // A device restart at the same rate carries on recording. A new rate stops it, since
+    // the rate is fixed for the life of a file; isRecording() then turns false.
+    void prepare(double sampleRate);
+
+    // FLAC for a .flac file, WAV otherwise; an existing file is replaced
+    bool start(const juce::File& file);
+    // Waits for the FIFO to drain and closes the file
+    void stop();
+    bool isRecording() const { return active.load(); }
+    juce::File getFile() const { return recordingFile; }
+
+    void push(const juce::AudioSourceChannelInfo& info);
+
+    double getRecordedSeconds() const { return (double)recordedSamples.load() / sampleRate; }
+    int getDroppedBlocks() const { return droppedBlocks.load(); }
+
+private:
+    int useTimeSlice() override;
+    void drain();
+
+    juce::TimeSliceThread writerThread { "Output recorder" };
+    std::unique_ptr<juce::AudioFormatWriter> writer; // only the writer thread touches it while active
+    juce::AbstractFifo fifo { 1 };
+    juce::AudioBuffer<float> fifoBuffer;
+    std::atomic<bool> active { false };
+    std::atomic<int> pushesInFlight { 0 }; // stop() waits for these before draining the FIFO
+    juce::File recordingFile;
+    double sampleRate = 44100.0;
+
+    std::atomic<juce::int64> recordedSamples { 0 };
+    std::atomic<int> droppedBlocks { 0 };
+
+    juce::SharedResourcePointer<Metrics> metrics;
+    Metrics::Value& droppedBlocksMetric = metrics->getCounter("player_recorder_dropped_blocks_total", "Output blocks the recorder dropped because its FIFO was full");
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OutputRecorder)
+};
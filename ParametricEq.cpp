@@ -0,0 +1,321 @@
+#include "ParametricEq.h"
+#include <algorithm>
+#include <cmath>
+
+ParametricEq::ParametricEq()
+{
+    prepare(512, 44100.0);
+}
+
+void ParametricEq::prepare(int maximumBlockSize, double newSampleRate)
+{
+    juce::ignoreUnused(maximumBlockSize);
+    sampleRate = newSampleRate;
+
+    // Sized for maxChannels so a change in the device's channel count never allocates
+    const int lanes = (int)Vec::size();
+    numGroups = (maxChannels + lanes - 1) / lanes;
+    interleaved.assign((size_t)subBlockSize, Vec::expand(0.0f));
+
+    for(auto& state : states)
+    {
+        state.z1.assign((size_t)numGroups, Vec::expand(0.0f));
+        state.z2.assign((size_t)numGroups, Vec::expand(0.0f));
+        state.frequency.reset(sampleRate, smoothingSeconds);
+        state.q.reset(sampleRate, smoothingSeconds);
+        state.gainDb.reset(sampleRate, smoothingSeconds);
+    }
+
+    {
+        // Not called while process() runs, so the front slot can be brought up to date directly
+        const juce::ScopedLock sl(writerLock);
+        slots[(size_t)front] = latest;
+    }
+    pullSettings(true);
+}
+
+void ParametricEq::reset()
+{
+    for(auto& state : states)
+    {
+        std::fill(state.z1.begin(), state.z1.end(), Vec::expand(0.0f));
+        std::fill(state.z2.begin(), state.z2.end(), Vec::expand(0.0f));
+    }
+}
+
+// ------------------- Settings -------------------
+void ParametricEq::setBand(int index, const Band& band)
+{
+    if(index < 0 || index >= maxBands) return;
+    const juce::ScopedLock sl(writerLock);
+    auto& b = latest.bands[(size_t)index];
+    b = band;
+    b.frequency = juce::jmax(10.0f, band.frequency);
+    b.q = juce::jmax(0.05f, band.q);
+    publish();
+}
+
+ParametricEq::Band ParametricEq::getBand(int index) const
+{
+    if(index < 0 || index >= maxBands) return {};
+    const juce::ScopedLock sl(writerLock);
+    return latest.bands[(size_t)index];
+}
+
+int ParametricEq::getNumBands() const
+{
+    const juce::ScopedLock sl(writerLock);
+    return latest.numBands;
+}
+
+void ParametricEq::setNumBands(int newNumBands)
+{
+    const juce::ScopedLock sl(writerLock);
+    latest.numBands = juce::jlimit(0, maxBands, newNumBands);
+    publish();
+}
+
+void ParametricEq::publish()
+{
+    slots[(size_t)back] = latest;
+    back = middle.exchange(back | newSnapshot) & slotMask;
+}
+
+std::vector<ParametricEq::Band> ParametricEq::makeOctaveBands()
+{
+    std::vector<Band> bands;
+    for(int i = 0; i < 10; ++i)
+    {
+        Band band;
+        band.frequency = 31.25f * (float)(1 << i);
+        band.type = i == 0 ? lowShelf : (i == 9 ? highShelf : peak);
+        band.q = i == 0 || i == 9 ? 0.7071f : 1.41f; // one octave wide
+        bands.push_back(band);
+    }
+    return bands;
+}
+
+// Takes over the front snapshot; a changed filter type restarts that band cleanly
+void ParametricEq::pullSettings(bool jump)
+{
+    for(int i = 0; i < maxBands; ++i)
+    {
+        const auto& s = slots[(size_t)front].bands[(size_t)i];
+        auto& state = states[(size_t)i];
+        bool restart = jump || s.type != state.type;
+
+        state.type = s.type;
+        state.enabled = s.enabled;
+        if(restart)
+        {
+            state.frequency.setCurrentAndTargetValue(s.frequency);
+            state.q.setCurrentAndTargetValue(s.q);
+            state.gainDb.setCurrentAndTargetValue(s.gainDb);
+            std::fill(state.z1.begin(), state.z1.end(), Vec::expand(0.0f));
+            std::fill(state.z2.begin(), state.z2.end(), Vec::expand(0.0f));
+        }
+        else
+        {
+            state.frequency.setTargetValue(s.frequency);
+            state.q.setTargetValue(s.q);
+            state.gainDb.setTargetValue(s.gainDb);
+        }
+        state.coefficients = makeCoefficients(state.type, sampleRate, state.frequency.getCurrentValue(),
+                                              state.gainDb.getCurrentValue(), state.q.getCurrentValue());
+    }
+}
+
+// RBJ audio EQ cookbook, normalised so a0 = 1
+ParametricEq::Coefficients ParametricEq::makeCoefficients(BandType type, double sampleRate, float frequency, float gainDb, float q)
+{
+    const double w0 = juce::MathConstants<double>::twoPi * juce::jmin((double)frequency, sampleRate * 0.49) / sampleRate;
+    const double cosW = std::cos(w0);
+    const double alpha = std::sin(w0) / (2.0 * q);
+    const double a = std::pow(10.0, gainDb / 40.0);
+    const double shelf = 2.0 * std::sqrt(a) * alpha;
+
+    double b0 = 1, b1 = 0, b2 = 0, a0 = 1, a1 = 0, a2 = 0;
+    switch(type)
+    {
+        case peak:
+            b0 = 1 + alpha * a; b1 = -2 * cosW; b2 = 1 - alpha * a;
+            a0 = 1 + alpha / a; a1 = -2 * cosW; a2 = 1 - alpha / a;
+            break;
+        case lowShelf:
+            b0 = a * ((a + 1) - (a - 1) * cosW + shelf); b1 = 2 * a * ((a - 1) - (a + 1) * cosW); b2 = a * ((a + 1) - (a - 1) * cosW - shelf);
+            a0 = (a + 1) + (a - 1) * cosW + shelf; a1 = -2 * ((a - 1) + (a + 1) * cosW); a2 = (a + 1) + (a - 1) * cosW - shelf;
+            break;
+        case highShelf:
+            b0 = a * ((a + 1) + (a - 1) * cosW + shelf); b1 = -2 * a * ((a - 1) + (a + 1) * cosW); b2 = a * ((a + 1) + (a - 1) * cosW - shelf);
+            a0 = (a + 1) - (a - 1) * cosW + shelf; a1 = 2 * ((a - 1) - (a + 1) * cosW); a2 = (a + 1) - (a - 1) * cosW - shelf;
+            break;
+        case lowPass:
+            b0 = (1 - cosW) / 2; b1 = 1 - cosW; b2 = (1 - cosW) / 2;
+            a0 = 1 + alpha; a1 = -2 * cosW; a2 = 1 - alpha;
+            break;
+        case highPass:
+            b0 = (1 + cosW) / 2; b1 = -(1 + cosW); b2 = (1 + cosW) / 2;
+            a0 = 1 + alpha; a1 = -2 * cosW; a2 = 1 - alpha;
+            break;
+    }
+    return { (float)(b0 / a0), (float)(b1 / a0), (float)(b2 / a0), (float)(a1 / a0), (float)(a2 / a0) };
+}
+
+bool ParametricEq::isIdentity(const BandState& state)
+{
+    if(!state.enabled) return true;
+    bool gainOnly = state.type == peak || state.type == lowShelf || state.type == highShelf;
+    return gainOnly && state.gainDb.getCurrentValue() == 0.0f && !state.gainDb.isSmoothing();
+}
+
+// ------------------- Processing -------------------
+void ParametricEq::process(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if((middle.load() & newSnapshot) != 0)
+    {
+        front = middle.exchange(front) & slotMask;
+        pullSettings(false);
+    }
+
+    const int bands = slots[(size_t)front].numBands;
+    bool anyActive = false;
+    for(int b = 0; b < bands && !anyActive; ++b)
+        anyActive = !isIdentity(states[(size_t)b]);
+    if(!anyActive || bufferToFill.buffer == nullptr)
+    {
+        for(auto& state : states) state.active = false;
+        return;
+    }
+
+    juce::ScopedNoDenormals noDenormals;
+    auto* channels = bufferToFill.buffer->getArrayOfWritePointers();
+    const int numChannels = juce::jmin(maxChannels, bufferToFill.buffer->getNumChannels());
+    for(int done = 0; done < bufferToFill.numSamples; done += subBlockSize)
+        processSubBlock(channels, numChannels, bufferToFill.startSample + done, juce::jmin(subBlockSize, bufferToFill.numSamples - done));
+}
+
+void ParametricEq::processSubBlock(float* const* channels, int numChannels, int startSample, int numSamples)
+{
+    const int bands = slots[(size_t)front].numBands;
+    for(int b = 0; b < bands; ++b)
+    {
+        auto& state = states[(size_t)b];
+        if(!state.enabled)
+        {
+            state.active = false;
+            continue;
+        }
+        if(state.frequency.isSmoothing() || state.q.isSmoothing() || state.gainDb.isSmoothing())
+        {
+            state.frequency.skip(numSamples);
+            state.q.skip(numSamples);
+            state.gainDb.skip(numSamples);
+            state.coefficients = makeCoefficients(state.type, sampleRate, state.frequency.getCurrentValue(),
+                                                  state.gainDb.getCurrentValue(), state.q.getCurrentValue());
+        }
+
+        // A band returning from bypass must not replay the state it had when it was skipped
+        const bool active = !isIdentity(state);
+        if(active && !state.active)
+        {
+            std::fill(state.z1.begin(), state.z1.end(), Vec::expand(0.0f));
+            std::fill(state.z2.begin(), state.z2.end(), Vec::expand(0.0f));
+        }
+        state.active = active;
+    }
+    for(int b = bands; b < maxBands; ++b)
+        states[(size_t)b].active = false;
+
+    const int lanes = (int)Vec::size();
+    auto* raw = reinterpret_cast<float*>(interleaved.data());
+
+    for(int group = 0; group * lanes < numChannels; ++group)
+    {
+        // Channels side by side in one register per sample
+        const int first = group * lanes;
+        for(int i = 0; i < numSamples; ++i)
+            for(int lane = 0; lane < lanes; ++lane)
+                raw[i * lanes + lane] = first + lane < numChannels ? channels[first + lane][startSample + i] : 0.0f;
+
+        for(int b = 0; b < bands; ++b)
+        {
+            auto& state = states[(size_t)b];
+            if(isIdentity(state)) continue;
+
+            // Transposed direct form II, one band at a time over the whole sub-block
+            const auto& c = state.coefficients;
+            const Vec b0 = Vec::expand(c.b0), b1 = Vec::expand(c.b1), b2 = Vec::expand(c.b2);
+            const Vec a1 = Vec::expand(c.a1), a2 = Vec::expand(c.a2);
+            Vec z1 = state.z1[(size_t)group], z2 = state.z2[(size_t)group];
+
+            for(int i = 0; i < numSamples; ++i)
+            {
+                const Vec x = interleaved[(size_t)i];
+                const Vec y = b0 * x + z1;
+                z1 = b1 * x - a1 * y + z2;
+                z2 = b2 * x - a2 * y;
+                interleaved[(size_t)i] = y;
+            }
+
+            state.z1[(size_t)group] = z1;
+            state.z2[(size_t)group] = z2;
+        }
+
+        for(int i = 0; i < numSamples; ++i)
+            for(int lane = 0; lane < lanes && first + lane < numChannels; ++lane)
+                channels[first + lane][startSample + i] = raw[i * lanes + lane];
+    }
+}
+
+// ------------------- Benchmark -------------------
+juce::String ParametricEq::runBenchmark()
+{
+    constexpr double rate = 96000.0;
+    constexpr int blockSize = 512;
+    constexpr double seconds = 20.0;
+    const int numBlocks = (int)(rate * seconds / blockSize);
+
+    juce::AudioBuffer<float> source(2, blockSize), buffer(2, blockSize);
+    juce::Random random(1);
+    for(int ch = 0; ch < 2; ++ch)
+        for(int i = 0; i < blockSize; ++i)
+            source.setSample(ch, i, random.nextFloat() * 0.2f - 0.1f);
+
+    juce::String report;
+    report << "ParametricEq: stereo " << rate / 1000.0 << " kHz, " << blockSize << "-sample blocks, "
+           << (int)Vec::size() << " floats per SIMD register\n";
+
+    auto octaveBands = makeOctaveBands();
+    double baseline = 0.0;
+    for(int active = 0; active <= (int)octaveBands.size(); ++active)
+    {
+        ParametricEq eq;
+        eq.prepare(blockSize, rate);
+        eq.setNumBands(active);
+        for(int b = 0; b < active; ++b)
+        {
+            auto band = octaveBands[(size_t)b];
+            band.gainDb = b % 2 == 0 ? 3.0f : -3.0f;
+            eq.setBand(b, band);
+        }
+
+        // Let the parameter smoothing settle before timing
+        juce::AudioSourceChannelInfo info(&buffer, 0, blockSize);
+        for(int i = 0; i < 100; ++i) { buffer.makeCopyOf(source, true); eq.process(info); }
+
+        auto start = juce::Time::getHighResolutionTicks();
+        for(int i = 0; i < numBlocks; ++i)
+        {
+            buffer.makeCopyOf(source, true);
+            eq.process(info);
+        }
+        double elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        if(active == 0) baseline = elapsed;
+
+        report << juce::String(active).paddedLeft(' ', 2) << " bands: " << juce::String(100.0 * elapsed / seconds, 3) << "% of one core";
+        if(active > 0)
+            report << ", " << juce::String(1.0e9 * (elapsed - baseline) / (active * (double)numBlocks * blockSize), 2) << " ns per stereo frame per band";
+        report << "\n";
+    }
+    return report;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <vector>
+
+// Master tone control: a cascade of RBJ biquads (peak, shelves, low/high pass).
+// - Channels are packed into the lanes of a juce::dsp::SIMDRegister, so stereo costs the
+//   same as mono and each band is one pass of vector multiply-adds over the block.
+// - Frequency, gain and Q glide to new values over smoothingSeconds; coefficients are
+//   recomputed every subBlockSize samples only while something is still moving.
+// - Bands at 0 dB (or disabled) are skipped; a flat EQ costs nothing. A band that comes back
+//   starts from a cleared filter state, so nothing left from before it was skipped is replayed.
+// setBand() may be called from any thread; process() runs on the audio thread. The bands are
+// handed over as one snapshot through a triple buffer, so the audio thread never sees half of
+// an update (a new type with the old Q) and never waits for the writer.
+class ParametricEq
+{
+public:
+    enum BandType { peak, lowShelf, highShelf, lowPass, highPass };
+
+    struct Band
+    {
+        BandType type = peak;
+        float frequency = 1000.0f;
+        float gainDb = 0.0f;
+        float q = 0.7071f;
+        bool enabled = true;
+    };
+
+    static constexpr int maxBands = 16;
+    static constexpr int maxChannels = 8;
+    static constexpr int subBlockSize = 32;
+    static constexpr double smoothingSeconds = 0.05;
+
+    ParametricEq();
+
+    void prepare(int maximumBlockSize, double sampleRate);
+    void process(const juce::AudioSourceChannelInfo& bufferToFill);
+    void reset();
+
+    void setBand(int index, const Band& band);
+    Band getBand(int index) const;
+    int getNumBands() const;
+    void setNumBands(int newNumBands);
+
+    // Ten peaking bands an octave apart from 31 Hz to 16 kHz, shelves at both ends
+    static std::vector<Band> makeOctaveBands();
+
+    // Runs the EQ over synthetic stereo 96 kHz audio with 1..10 active bands and reports
+    // the cost per band and the share of one core it needs to keep up with real time
+    static juce::String runBenchmark();
+
+private:
+    using Vec = juce::dsp::SIMDRegister<float>;
+
+    struct Coefficients
+    {
+        float b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    };
+
+    struct Settings
+    {
+        std::array<Band, maxBands> bands {};
+        int numBands = 0;
+    };
+
+    struct BandState
+    {
+        BandType type = peak;
+        bool enabled = true;
+        juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> frequency { 1000.0f }, q { 0.7071f };
+        juce::SmoothedValue<float> gainDb { 0.0f };
+        Coefficients coefficients;
+        std::vector<Vec> z1, z2; // one register per group of channels
+        bool active = false;     // filtered in the last block; false while skipped
+    };
+
+    // Writers edit latest under writerLock and publish a copy: into slots[back], which is then
+    // swapped with the middle slot. The audio thread swaps its front slot with the middle one
+    // whenever the newSnapshot bit says something was published since it last looked.
+    static constexpr int slotMask = 3, newSnapshot = 4;
+    juce::CriticalSection writerLock;
+    Settings latest;
+    int back = 2;
+    std::array<Settings, 3> slots;
+    std::atomic<int> middle { 1 };
+
+    // Audio thread state
+    int front = 0;
+    std::array<BandState, maxBands> states;
+    double sampleRate = 44100.0;
+    int numGroups = 0;
+    std::vector<Vec> interleaved;
+
+    static Coefficients makeCoefficients(BandType type, double sampleRate, float frequency, float gainDb, float q);
+    static bool isIdentity(const BandState& state);
+    void publish(); // call with writerLock held
+    void pullSettings(bool jump);
+    void processSubBlock(float* const* channels, int numChannels, int startSample, int numSamples);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParametricEq)
+};
@@ -1,10 +1,23 @@
 #include "PlayerAudio.h"
+#include "Tracer.h"
 
 // Constructor
-PlayerAudio::PlayerAudio() : resampleSource(&transportSource, false, 2)
+PlayerAudio::PlayerAudio(Rendering rendering)
+    : mixer(DeckMixer::defaultNumDecks, rendering == Rendering::realtime)
 {
-    formatManager.registerBasicFormats();
-    transportSource.setGain(1.0f);
+    auto bands = ParametricEq::makeOctaveBands();
+    for(int i = 0; i < (int)bands.size(); ++i)
+        equaliser.setBand(i, bands[(size_t)i]);
+    equaliser.setNumBands((int)bands.size());
+
+    auto& decodedBytes = metrics->getCounter("player_decoded_bytes_total", "Bytes of float PCM produced by the decoders");
+    auto& decodeSeconds = metrics->getCounter("player_decode_seconds_total", "Time spent decoding on the read-ahead thread");
+    metrics->addComputedGauge("player_decode_megabytes_per_second", "Decoder throughput while decoding",
+                              [&decodedBytes, &decodeSeconds]
+                              {
+                                  auto seconds = decodeSeconds.get();
+                                  return seconds > 0.0 ? decodedBytes.get() / seconds / 1.0e6 : 0.0;
+                              });
 }
 
 // Destructor
@@ -14,49 +27,311 @@ PlayerAudio::~PlayerAudio()
 }
 
 // Audio setup
-void PlayerAudio::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+void PlayerAudio::prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numOutputChannels)
 {
-    transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
-    resampleSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    mixer.prepare(samplesPerBlockExpected, sampleRate, numOutputChannels);
+    equaliser.prepare(samplesPerBlockExpected, sampleRate);
+    gainStage.prepare(samplesPerBlockExpected, sampleRate);
+    scrubber.prepare(sampleRate);
+    analyser.prepare(sampleRate);
+    levelMeter.prepare(sampleRate);
+    recorder.prepare(sampleRate);
 }
 
 void PlayerAudio::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    resampleSource.getNextAudioBlock(bufferToFill);
+    applyCommands();
+    if(scrubber.isActive()) scrubber.render(bufferToFill);
+    else mixer.render(bufferToFill);
+    equaliser.process(bufferToFill);
+    gainStage.process(bufferToFill);
+    analyser.push(bufferToFill);
+    levelMeter.process(bufferToFill);
+    recorder.push(bufferToFill);
+    acknowledgeCommands();
+
+    if(switchArmed.load() && getCurrentDeck().isPlaying())
+    {
+        lastSwitchLatencyMs.store(juce::Time::getMillisecondCounterHiRes() - switchRequestedMs.load());
+        switchLatencyMetric.set(lastSwitchLatencyMs.load());
+        switchCountMetric.add(1.0);
+        switchArmed.store(false);
+        switchRequestedMs.store(0.0);
+    }
 }
 
 void PlayerAudio::releaseResources()
 {
-    resampleSource.releaseResources();
-    transportSource.releaseResources();
+    mixer.release();
 }
 
 // Load file
 bool PlayerAudio::loadFile(const juce::File& file)
 {
-    stop();
-    transportSource.setSource(nullptr);
-    readerSource.reset();
+    const Tracer::Span span("loadFile");
+    return loadReader(createReaderFor(file), file);
+}
+
+std::unique_ptr<juce::AudioFormatReader> PlayerAudio::createReaderFor(const juce::File& file)
+{
+    return openFile(*formats, file);
+}
+
+std::unique_ptr<juce::AudioFormatReader> PlayerAudio::createReaderFor(const juce::URL& url)
+{
+    return openStream(*formats, *streams, url);
+}
+
+std::unique_ptr<juce::AudioFormatReader> PlayerAudio::openFile(FormatRegistry& registry, const juce::File& file)
+{
+    const Tracer::Span span("openReader", "decode");
+    auto reader = registry.createReaderFor(file);
+
+    // JUCE's MP3 reader finds a seek target by walking frame headers from the start of the file
+    if(reader != nullptr && reader->getFormatName() == "MP3 file")
+        if(auto* mp3 = registry.getFormatManager().findFormatForFileExtension(".mp3"))
+            return std::make_unique<IndexedMp3Reader>(file, *mp3, std::move(reader));
+    return reader;
+}
+
+std::unique_ptr<juce::AudioFormatReader> PlayerAudio::openStream(FormatRegistry& registry, HttpStreamPool& pool, const juce::URL& url)
+{
+    const Tracer::Span span("openStream", "decode");
+    return registry.createReaderFor(pool.open(url), url.getFileName());
+}
+
+bool PlayerAudio::loadURL(const juce::URL& url)
+{
+    const Tracer::Span span("loadURL");
+    return loadReader(createReaderFor(url), {});
+}
+
+void PlayerAudio::openReaderAsync(const juce::File& file, const JobScheduler::GroupPtr& group, ReaderCallback onOpened,
+                                  double primeFromSeconds)
+{
+    // The job may outlive this player, so it holds the shared registry rather than this
+    openReaderAsync([registry = formats, file] { return openFile(*registry, file); }, group, std::move(onOpened), primeFromSeconds);
+}
+
+void PlayerAudio::openReaderAsync(const juce::URL& url, const JobScheduler::GroupPtr& group, ReaderCallback onOpened,
+                                  double primeFromSeconds)
+{
+    openReaderAsync([registry = formats, pool = streams, url] { return openStream(*registry, *pool, url); },
+                    group, std::move(onOpened), primeFromSeconds);
+}
 
-    auto* reader = formatManager.createReaderFor(file);
-    if(reader != nullptr)
+void PlayerAudio::openReaderAsync(std::function<std::unique_ptr<juce::AudioFormatReader>()> open, const JobScheduler::GroupPtr& group,
+                                  ReaderCallback onOpened, double primeFromSeconds)
+{
+    scheduler->submit(JobScheduler::currentTrack, group, [open, group, onOpened, primeFromSeconds](const JobScheduler::Group&)
     {
-        readerSource.reset(new juce::AudioFormatReaderSource(reader, true));
-        transportSource.setSource(readerSource.get(), 0, nullptr, reader->sampleRate);
-        return true;
-    }
-    return false;
+        // std::function needs a copyable callback, so the reader travels in a shared holder
+        auto reader = std::make_shared<std::unique_ptr<juce::AudioFormatReader>>(open());
+        if(auto* r = reader->get())
+        {
+            const Tracer::Span span("primeReader", "decode");
+            juce::AudioBuffer<float> prime((int)r->numChannels, 4096);
+            r->read(&prime, 0, prime.getNumSamples(), juce::roundToInt64(primeFromSeconds * r->sampleRate), true, true);
+        }
+
+        juce::MessageManager::callAsync([group, reader, onOpened]
+        {
+            if(!group->isCancelled()) onOpened(std::move(*reader));
+        });
+    });
+}
+
+// A plain load cuts over: any crossfade is dropped, the new track is heard at once
+bool PlayerAudio::loadReader(std::unique_ptr<juce::AudioFormatReader> reader, const juce::File& sourceFile)
+{
+    const Tracer::Span span("loadReader");
+    cancelPreload();
+    releaseOutgoing();
+
+    auto& deck = getCurrentDeck();
+    deck.fadeIn(0.0);
+    if(!deck.load(std::move(reader), sourceFile, sourceFile == juce::File()))
+        return false;
+
+    prepareDeck(deck);
+    scrubber.setFile(sourceFile);
+    armSwitchTiming();
+    return true;
+}
+
+// ------------------- Remote control -------------------
+bool PlayerAudio::postCommand(const EngineCommand& command)
+{
+    const juce::SpinLock::ScopedLockType sl(commandWriteLock);
+    if(commandFifo.getFreeSpace() == 0) return false;
+    auto write = commandFifo.write(1);
+    commands[(size_t)(write.blockSize1 > 0 ? write.startIndex1 : write.startIndex2)] = command;
+    return true;
+}
+
+int PlayerAudio::takeAcknowledgements(Acknowledgement* destination, int maxToRead)
+{
+    auto read = acknowledgementFifo.read(juce::jmin(maxToRead, acknowledgementFifo.getNumReady()));
+    int copied = 0;
+    for(int i = 0; i < read.blockSize1; ++i) destination[copied++] = acknowledgements[(size_t)(read.startIndex1 + i)];
+    for(int i = 0; i < read.blockSize2; ++i) destination[copied++] = acknowledgements[(size_t)(read.startIndex2 + i)];
+    return copied;
+}
+
+// Audio thread. Gain and mute are atomic stores, so nothing here locks. Anything beyond
+// maxCommandsPerBlock waits for the next block.
+void PlayerAudio::applyCommands()
+{
+    auto read = commandFifo.read(juce::jmin(maxCommandsPerBlock - numInFlight, commandFifo.getNumReady()));
+    auto apply = [this](int start, int count)
+    {
+        for(int i = start; i < start + count; ++i)
+        {
+            const auto& command = commands[(size_t)i];
+            switch(command.type)
+            {
+                case EngineCommand::setGain:  gainStage.setGain((float)command.value); break;
+                case EngineCommand::setMuted: gainStage.setMuted(command.value != 0.0); break;
+                case EngineCommand::acknowledge: break;
+            }
+            inFlight[(size_t)numInFlight++] = command;
+        }
+    };
+    apply(read.startIndex1, read.blockSize1);
+    apply(read.startIndex2, read.blockSize2);
+}
+
+// Audio thread, after the block is rendered. An acknowledgement the consumer has no room
+// for is dropped; the command itself has still been applied.
+void PlayerAudio::acknowledgeCommands()
+{
+    if(numInFlight == 0) return;
+    const double now = juce::Time::getMillisecondCounterHiRes();
+    const int toWrite = juce::jmin(numInFlight, acknowledgementFifo.getFreeSpace());
+    auto write = acknowledgementFifo.write(toWrite);
+    int next = 0;
+    for(int i = 0; i < write.blockSize1; ++i, ++next)
+        acknowledgements[(size_t)(write.startIndex1 + i)] = { inFlight[(size_t)next].id, now - inFlight[(size_t)next].receivedMs };
+    for(int i = 0; i < write.blockSize2; ++i, ++next)
+        acknowledgements[(size_t)(write.startIndex2 + i)] = { inFlight[(size_t)next].id, now - inFlight[(size_t)next].receivedMs };
+    numInFlight = 0;
+}
+
+// ------------------- Crossfades -------------------
+bool PlayerAudio::preloadNext(std::unique_ptr<juce::AudioFormatReader> reader, const juce::File& sourceFile, double startSeconds)
+{
+    cancelPreload();
+    int index = mixer.findFreeDeck(currentDeck.load());
+    if(index < 0 || reader == nullptr) return false;
+
+    auto& deck = mixer.getDeck(index);
+    deck.fadeOut(0.0);
+    if(!deck.load(std::move(reader), sourceFile, sourceFile == juce::File())) return false;
+
+    prepareDeck(deck);
+    deck.setPositionInSamples(juce::roundToInt64(startSeconds * deck.getSourceSampleRate()));
+    preloadDeck = index;
+    return true;
+}
+
+void PlayerAudio::cancelPreload()
+{
+    if(preloadDeck < 0) return;
+    mixer.getDeck(preloadDeck).unload();
+    preloadDeck = -1;
+}
+
+bool PlayerAudio::crossfadeToPreloaded(double seconds)
+{
+    if(preloadDeck < 0) return false;
+    releaseOutgoing(); // a crossfade that is still running is cut short
+
+    auto& outgoing = getCurrentDeck();
+    auto& incoming = mixer.getDeck(preloadDeck);
+    incoming.start();
+    incoming.fadeIn(seconds);
+    outgoing.fadeOut(seconds);
+
+    outgoingDeck = currentDeck.load();
+    currentDeck.store(preloadDeck);
+    preloadDeck = -1;
+    scrubber.setFile(incoming.getLoadedFile());
+    return true;
+}
+
+void PlayerAudio::update()
+{
+    if(outgoingDeck >= 0 && !mixer.getDeck(outgoingDeck).isAudible())
+        releaseOutgoing();
+
+    readAheadFillMetric.set(getCurrentDeck().getReadAheadFill());
+    int readAheadBytes = 0;
+    for(int i = 0; i < mixer.getNumDecks(); ++i)
+        readAheadBytes += mixer.getDeck(i).getReadAheadBytes();
+    readAheadBytesMetric.set(readAheadBytes);
+}
+
+void PlayerAudio::releaseOutgoing()
+{
+    if(outgoingDeck < 0) return;
+    mixer.getDeck(outgoingDeck).unload();
+    outgoingDeck = -1;
+}
+
+void PlayerAudio::prepareDeck(Deck& deck)
+{
+    deck.setPlaybackSpeed(playbackSpeed);
+    deck.setLooping(looping);
+    deck.setLoopRange(loopRangeStart, loopRangeEnd);
 }
 
 // Playback controls
-void PlayerAudio::start() { transportSource.start(); }
-void PlayerAudio::stop() { transportSource.stop(); }
+void PlayerAudio::start() { getCurrentDeck().start(); }
+void PlayerAudio::stop()
+{
+    // Stopping mid-crossfade also silences the outgoing track
+    getCurrentDeck().stop();
+    releaseOutgoing();
+}
 
-void PlayerAudio::setGain(float gain) { transportSource.setGain(gain); }
-void PlayerAudio::setPosition(double pos) { transportSource.setPosition(pos); }
+void PlayerAudio::setGain(float gain) { gainStage.setGain(gain); }
+void PlayerAudio::setMuted(bool shouldBeMuted) { gainStage.setMuted(shouldBeMuted); }
+void PlayerAudio::setNormalisationGain(float gain) { getCurrentDeck().setNormalisationGain(gain); }
+void PlayerAudio::setPosition(double pos)
+{
+    const Tracer::Span span("setPosition");
+    getCurrentDeck().setPosition(pos);
+}
 
-double PlayerAudio::getPosition() const { return transportSource.getCurrentPosition(); }
-double PlayerAudio::getLength() const { return transportSource.getLengthInSeconds(); }
-bool PlayerAudio::isPlaying() const { return transportSource.isPlaying(); }
+void PlayerAudio::setPositionInSamples(juce::int64 sourceSample)
+{
+    const Tracer::Span span("setPosition");
+    getCurrentDeck().setPositionInSamples(sourceSample);
+}
+
+double PlayerAudio::getPosition() const { return getCurrentDeck().getCurrentPosition(); }
+double PlayerAudio::getLength() const { return getCurrentDeck().getLengthInSeconds(); }
+bool PlayerAudio::isPlaying() const { return getCurrentDeck().isPlaying(); }
+
+void PlayerAudio::setPlaybackSpeed(float ratio)
+{
+    playbackSpeed = ratio;
+    getCurrentDeck().setPlaybackSpeed(ratio);
+    if(preloadDeck >= 0) mixer.getDeck(preloadDeck).setPlaybackSpeed(ratio);
+    if(outgoingDeck >= 0) mixer.getDeck(outgoingDeck).setPlaybackSpeed(ratio);
+}
+
+void PlayerAudio::setLooping(bool shouldLoop)
+{
+    looping = shouldLoop;
+    getCurrentDeck().setLooping(shouldLoop);
+}
+
+void PlayerAudio::setLoopRange(double startSeconds, double endSeconds)
+{
+    loopRangeStart = startSeconds;
+    loopRangeEnd = endSeconds;
+    getCurrentDeck().setLoopRange(startSeconds, endSeconds);
+}
 
-void PlayerAudio::setPlaybackSpeed(float ratio) { resampleSource.setResamplingRatio(ratio); }
+void PlayerAudio::clearLoopRange() { setLoopRange(0.0, 0.0); }
@@ -1,37 +1,197 @@
 #pragma once
 #include <JuceHeader.h>
+#include "GainStage.h"
+#include "DeckMixer.h"
+#include "ParametricEq.h"
+#include "JobScheduler.h"
+#include "FormatRegistry.h"
+#include "HttpStream.h"
+#include "SeekIndex.h"
+#include "Scrubber.h"
+#include "SpectrumAnalyser.h"
+#include "LevelMeter.h"
+#include "OutputRecorder.h"
+#include "Metrics.h"
+#include <array>
+#include <atomic>
 #include <memory>
 
+// The player's view of the deck mixer. Transport calls go to the current deck; a second
+// deck holds the next track while it is preloaded and the outgoing one during a crossfade.
+// The remaining decks are free for anything else that wants to play through the mixer.
 class PlayerAudio
 {
 public:
-    PlayerAudio();
+    // Offline rendering decodes on the calling thread instead of reading ahead, so the same
+    // calls always produce the same output (tests, bounces)
+    enum class Rendering { realtime, offline };
+
+    explicit PlayerAudio(Rendering rendering = Rendering::realtime);
     ~PlayerAudio();
 
-    void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+    // numOutputChannels sizes each deck's own buffers; the mix and effects follow the block given
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numOutputChannels = 2);
     void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill);
     void releaseResources();
 
     bool loadFile(const juce::File& file);
+
+    // Opening a reader touches the disk, so it may be done on a background thread
+    // and the result handed to loadReader() on the message thread.
+    std::unique_ptr<juce::AudioFormatReader> createReaderFor(const juce::File& file);
+    bool loadReader(std::unique_ptr<juce::AudioFormatReader> reader, const juce::File& sourceFile);
+
+    // HTTP(S) sources play while they download; seeks become range requests. Decks hold them
+    // with an empty source file. prefetch() starts downloading one that is likely to come next.
+    bool loadURL(const juce::URL& url);
+    std::unique_ptr<juce::AudioFormatReader> createReaderFor(const juce::URL& url);
+    void prefetch(const juce::URL& url) { streams->prefetch(url); }
+
+    // Crossfades: the next track is loaded into the idle deck and positioned ahead of time,
+    // so its read-ahead buffer is full before the overlap starts
+    bool preloadNext(std::unique_ptr<juce::AudioFormatReader> reader, const juce::File& sourceFile, double startSeconds);
+    bool hasPreloaded() const { return preloadDeck >= 0; }
+    juce::File getPreloadedFile() const { return preloadDeck >= 0 ? mixer.getDeck(preloadDeck).getLoadedFile() : juce::File(); }
+    void cancelPreload();
+    // Starts the preloaded deck and makes it current; the old deck fades out and is stopped by update()
+    bool crossfadeToPreloaded(double seconds);
+    // Message thread, periodically: stops decks whose fade-out has finished
+    void update();
+
+    // Opens the reader on the shared scheduler and hands it over on the message thread,
+    // unless the group was cancelled in the meantime. The block at primeFromSeconds is
+    // decoded once first so the audio thread's first read finds warm file and decoder caches.
+    using ReaderCallback = std::function<void(std::unique_ptr<juce::AudioFormatReader>)>;
+    void openReaderAsync(const juce::File& file, const JobScheduler::GroupPtr& group, ReaderCallback onOpened,
+                         double primeFromSeconds = 0.0);
+    void openReaderAsync(const juce::URL& url, const JobScheduler::GroupPtr& group, ReaderCallback onOpened,
+                         double primeFromSeconds = 0.0);
+
+    // Click-to-sound measurement: begin at the click, arm once the new source is in place;
+    // the audio thread stops the clock on the first block it renders from it
+    void beginSwitchTiming(double clickTimeMs) { switchRequestedMs.store(clickTimeMs); }
+    void armSwitchTiming() { switchArmed.store(switchRequestedMs.load() > 0.0); }
+    // Latency of the last switch in ms, or -1 if there is no new measurement
+    double takeSwitchLatency() { return lastSwitchLatencyMs.exchange(-1.0); }
+    juce::File getLoadedFile() const { return getCurrentDeck().getLoadedFile(); }
+
     void start();
     void stop();
 
+    // Volume and mute ramp in the master gainStage; loudness correction belongs to the current deck
     void setGain(float gain);
+    void setMuted(bool shouldBeMuted);
+    void setNormalisationGain(float gain);
     void setPosition(double pos);
+    void setPositionInSamples(juce::int64 sourceSample);
+    double getSourceSampleRate() const { return getCurrentDeck().getSourceSampleRate(); }
+
+    // Scrubbing: while active the transport holds still and the scrubber is heard instead;
+    // only the position the drag ends on is actually seeked to
+    void beginScrub(double pos) { scrubber.begin(pos); }
+    void scrubTo(double pos) { scrubber.moveTo(pos); }
+    void endScrub() { setPosition(scrubber.end()); }
+    bool isScrubbing() const { return scrubber.isActive(); }
     double getPosition() const;
     double getLength() const;
     bool isPlaying() const;
 
     void setPlaybackSpeed(float ratio);
+    void setLooping(bool shouldLoop);
+    void setLoopRange(double startSeconds, double endSeconds);
+    void clearLoopRange();
+
+    // Commands from other threads (the control server) reach the audio thread through a
+    // lock-free FIFO and take effect at the start of the next block, without a trip through
+    // the message thread. Once that block is rendered the command is acknowledged with the
+    // time since it arrived. An acknowledge command only measures: the message thread posts
+    // one after acting on a command itself.
+    struct EngineCommand
+    {
+        // No seek: repositioning the transport locks its read-ahead buffer, so seeks are made
+        // on the message thread and followed by an acknowledge
+        enum Type { acknowledge, setGain, setMuted };
+        Type type = acknowledge;
+        double value = 0.0;
+        juce::uint32 id = 0;
+        double receivedMs = 0.0; // juce::Time::getMillisecondCounterHiRes() when it arrived
+    };
 
-    double getCurrentPosition() const { return transportSource.getCurrentPosition(); }
-    double getLengthInSeconds() const { return transportSource.getLengthInSeconds(); }
+    struct Acknowledgement
+    {
+        juce::uint32 id = 0;
+        double latencyMs = 0.0;
+    };
+
+    // Any thread but the audio thread; false if the queue is full
+    bool postCommand(const EngineCommand& command);
+    // A single consumer; returns the number copied to destination
+    int takeAcknowledgements(Acknowledgement* destination, int maxToRead);
+
+    DeckMixer& getMixer() { return mixer; }
+    // Master tone control between the mix and the volume stage
+    ParametricEq& getEqualiser() { return equaliser; }
+    SpectrumAnalyser& getAnalyser() { return analyser; }
+    LevelMeter& getLevelMeter() { return levelMeter; }
+    OutputRecorder& getRecorder() { return recorder; }
+
+    double getCurrentPosition() const { return getCurrentDeck().getCurrentPosition(); }
+    double getLengthInSeconds() const { return getCurrentDeck().getLengthInSeconds(); }
 
 private:
-    juce::AudioFormatManager formatManager;
-    std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
-    juce::AudioTransportSource transportSource;
-    juce::ResamplingAudioSource resampleSource { &transportSource, false, 2 };
+    // Without this, so that background jobs can open readers after the player has gone
+    static std::unique_ptr<juce::AudioFormatReader> openFile(FormatRegistry& registry, const juce::File& file);
+    static std::unique_ptr<juce::AudioFormatReader> openStream(FormatRegistry& registry, HttpStreamPool& pool, const juce::URL& url);
+
+    juce::SharedResourcePointer<FormatRegistry> formats;
+    juce::SharedResourcePointer<JobScheduler> scheduler;
+    juce::SharedResourcePointer<HttpStreamPool> streams;
+    DeckMixer mixer;
+    std::atomic<int> currentDeck { 0 };
+    int preloadDeck = -1;
+    int outgoingDeck = -1;
+
+    // Settings every track the player loads picks up
+    float playbackSpeed = 1.0f;
+    bool looping = false;
+    double loopRangeStart = 0.0, loopRangeEnd = 0.0;
+    ParametricEq equaliser;
+    GainStage gainStage;
+    Scrubber scrubber { [this](const juce::File& file) { return createReaderFor(file); } };
+    SpectrumAnalyser analyser; // these tap the final output
+    LevelMeter levelMeter;
+    OutputRecorder recorder;
+
+    // Producers serialise on commandWriteLock; the audio thread only ever reads the FIFO.
+    // Commands applied in a block wait in inFlight until it has been rendered.
+    static constexpr int commandQueueSize = 256;
+    static constexpr int maxCommandsPerBlock = 32;
+    juce::AbstractFifo commandFifo { commandQueueSize };
+    std::array<EngineCommand, commandQueueSize> commands;
+    juce::SpinLock commandWriteLock;
+    juce::AbstractFifo acknowledgementFifo { commandQueueSize };
+    std::array<Acknowledgement, commandQueueSize> acknowledgements;
+    std::array<EngineCommand, maxCommandsPerBlock> inFlight;
+    int numInFlight = 0;
+
+    std::atomic<double> switchRequestedMs { 0.0 };
+    std::atomic<double> lastSwitchLatencyMs { -1.0 };
+    std::atomic<bool> switchArmed { false };
+
+    // --- Metrics ---
+    juce::SharedResourcePointer<Metrics> metrics;
+    Metrics::Value& switchLatencyMetric = metrics->getGauge("player_track_switch_latency_ms", "Click-to-sound time of the last track switch");
+    Metrics::Value& switchCountMetric = metrics->getCounter("player_track_switches_total", "Track switches that reached the output");
+    Metrics::Value& readAheadFillMetric = metrics->getGauge("player_read_ahead_fill_ratio", "Decoded share of the current deck's read-ahead buffer");
+    Metrics::Value& readAheadBytesMetric = metrics->getGauge("player_read_ahead_bytes", "Memory held by the read-ahead buffers of loaded decks");
+
+    Deck& getCurrentDeck() const { return mixer.getDeck(currentDeck.load()); }
+    void prepareDeck(Deck& deck);
+    void openReaderAsync(std::function<std::unique_ptr<juce::AudioFormatReader>()> open, const JobScheduler::GroupPtr& group,
+                         ReaderCallback onOpened, double primeFromSeconds);
+    void releaseOutgoing();
+    void applyCommands();
+    void acknowledgeCommands();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlayerAudio)
 };
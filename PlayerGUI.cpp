@@ -1,19 +1,23 @@
 #include "PlayerGUI.h"
-#include <taglib/fileref.h>
-#include <taglib/tag.h>
+#include "StartupProfiler.h"
+#include "ChapterReader.h"
+#include "RealtimeChecker.h"
+#include "Tracer.h"
+#include "Session.h"
 #include <algorithm>
 
 // ------------------- Constructor -------------------
 PlayerGUI::PlayerGUI()
 {
-    setSize(900, 600);
-    formatManager.registerBasicFormats();
+    setSize(900, 700);
+    setWantsKeyboardFocus(true); // keyPressed only sees keys while this or a child has focus
 
     // All buttons
     auto buttons = { &loadButton, &restartButton, &playPauseButton, &stopButton,
                      &nextButton, &prevButton, &muteButton, &loopButton,
                      &goToStartButton, &goToEndButton, &forwardButton, &backwardButton,
-                     &addMarkerButton, &setAButton, &setBButton, &abLoopingButton };
+                     &addMarkerButton, &setAButton, &setBButton, &abLoopingButton,
+                     &prevMarkerButton, &nextMarkerButton, &recordButton, &openUrlButton };
     for(auto* btn : buttons)
     {
         btn->addListener(this);
@@ -22,13 +26,28 @@ PlayerGUI::PlayerGUI()
 
     // Sliders
     volumeSlider.setRange(0.0, 1.0, 0.01); volumeSlider.setValue(0.5); volumeSlider.addListener(this); addAndMakeVisible(volumeSlider);
+    playerAudio.setGain((float)volumeSlider.getValue());
     speedSlider.setRange(0.5, 2.0, 0.01); speedSlider.setValue(1.0); speedSlider.addListener(this); addAndMakeVisible(speedSlider);
     positionSlider.setRange(0.0, 1.0); positionSlider.addListener(this); addAndMakeVisible(positionSlider);
+    crossfadeSlider.setRange(0.0, 12.0, 0.5); crossfadeSlider.setTextValueSuffix(" s crossfade"); addAndMakeVisible(crossfadeSlider);
+
+    // Equaliser
+    for(int i = 0; i < (int)eqSliders.size(); ++i)
+    {
+        auto& knob = eqSliders[(size_t)i];
+        auto frequency = playerAudio.getEqualiser().getBand(i).frequency;
+        knob.setSliderStyle(juce::Slider::RotaryVerticalDrag); knob.setTextBoxStyle(juce::Slider::TextBoxBelow, true, 40, 16);
+        knob.setRange(-12.0, 12.0, 0.5); knob.setDoubleClickReturnValue(true, 0.0);
+        knob.setTooltip(frequency < 1000.0f ? juce::String(juce::roundToInt(frequency)) + " Hz" : juce::String(frequency / 1000.0f, 0) + " kHz");
+        knob.addListener(this); addAndMakeVisible(knob);
+    }
 
     // Labels
     auto labels = { &titleLabel, &artistLabel, &albumLabel, &durationLabel };
     for(auto* lbl : labels){ addAndMakeVisible(*lbl); lbl->setColour(juce::Label::textColourId, juce::Colours::white); }
     addAndMakeVisible(currentTimeLabel); currentTimeLabel.setText("00:00", juce::dontSendNotification);
+    addAndMakeVisible(switchLatencyLabel); switchLatencyLabel.setColour(juce::Label::textColourId, juce::Colours::grey);
+    addAndMakeVisible(recordingLabel); recordingLabel.setColour(juce::Label::textColourId, juce::Colours::grey);
 
     // Playlist
     playlistBox.addListener(this); addAndMakeVisible(playlistBox);
@@ -36,40 +55,49 @@ PlayerGUI::PlayerGUI()
     // Markers
     markerList.setModel(this); addAndMakeVisible(markerList);
 
+    // Output levels
+    addAndMakeVisible(meterDisplay);
+
+    // Loudness normalisation
+    normalisationBox.addItem("No normalisation", normalisationOff);
+    normalisationBox.addItem("Track gain", normalisationTrack);
+    normalisationBox.addItem("Album gain", normalisationAlbum);
+    normalisationBox.setSelectedId(normalisationTrack, juce::dontSendNotification);
+    normalisationBox.addListener(this); addAndMakeVisible(normalisationBox);
+    loudnessScanner.onResult = [this](const juce::File&){ applyNormalisation(); };
+
     setLightTheme();
     startTimerHz(30);
-    loadSession();
+
+    // Restore after the constructor returns so the window is shown first
+    juce::Component::SafePointer<PlayerGUI> safeThis(this);
+    juce::MessageManager::callAsync([safeThis]
+    {
+        if(safeThis != nullptr) safeThis->loadSession();
+    });
 }
 
 // ------------------- Destructor -------------------
 PlayerGUI::~PlayerGUI()
 {
+    controlServer = nullptr;
+    trackJobs->cancelAndWait();
+    thumbnailJobs->cancelAndWait();
+    for(auto& group : retiredJobs)
+        group->cancelAndWait();
     saveSession();
 }
 
 // ------------------- Audio callbacks -------------------
-void PlayerGUI::prepareToPlay(int samplesPerBlockExpected,double sampleRate)
+void PlayerGUI::prepareToPlay(int samplesPerBlockExpected,double sampleRate,int numOutputChannels)
 {
-    playerAudio.prepareToPlay(samplesPerBlockExpected,sampleRate);
+    playerAudio.prepareToPlay(samplesPerBlockExpected,sampleRate,numOutputChannels);
 }
 
 void PlayerGUI::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
+    // Looping and the A-B range are handled by the deck; the transport stops itself at the end
     playerAudio.getNextAudioBlock(bufferToFill);
-
-    // A-B Loop
-    if(isABLooping && loopEnd>0.0)
-    {
-        double pos = playerAudio.getCurrentPosition();
-        if(pos >= loopEnd) playerAudio.setPosition(loopStart);
-    }
-
-    // Normal Loop or Stop at end
-    if(playerAudio.getCurrentPosition() >= playerAudio.getLengthInSeconds())
-    {
-        if(isLooping) playerAudio.setPosition(0.0);
-        else playerAudio.stop();
-    }
 }
 
 void PlayerGUI::releaseResources()
@@ -80,8 +108,16 @@ void PlayerGUI::releaseResources()
 // ------------------- Paint -------------------
 void PlayerGUI::paint(juce::Graphics& g)
 {
+    const Tracer::Span span("paint", "gui");
+    auto paintStart = juce::Time::getMillisecondCounterHiRes();
     g.fillAll(juce::Colour(30,30,30));
 
+    if(!firstFramePainted)
+    {
+        firstFramePainted = true;
+        StartupProfiler::markFirstFrame();
+    }
+
     g.setColour(juce::Colours::white);
     g.setFont(20.0f);
     g.drawText(titleLabel.getText(), 10, 10, getWidth()-20, 25, juce::Justification::centredLeft);
@@ -91,15 +127,44 @@ void PlayerGUI::paint(juce::Graphics& g)
 
     if(audioThumbnail.getTotalLength() > 0.0)
     {
+        juce::Rectangle<int> waveArea(10, 70, getWidth()-20, 100);
+        double length = audioThumbnail.getTotalLength();
         g.setColour(juce::Colours::orange);
-        audioThumbnail.drawChannels(g, juce::Rectangle<int>(10, 70, getWidth()-20, 100), 0.0, audioThumbnail.getTotalLength(), 1.0f);
+        audioThumbnail.drawChannels(g, waveArea, 0.0, length, 1.0f);
+
+        // Only the markers inside the drawn range; dense ones collapse to one line per pixel
+        auto& markers = getMarkers();
+        auto visible = markers.findInRange(0.0, length);
+        g.setColour(juce::Colours::white.withAlpha(0.6f));
+        int lastX = -1;
+        for(int i = visible.getStart(); i < visible.getEnd(); ++i)
+        {
+            int x = waveArea.getX() + (int)(markers[i].position / length * waveArea.getWidth());
+            if(x == lastX) continue;
+            g.drawVerticalLine(x, (float)waveArea.getY(), (float)waveArea.getBottom());
+            lastX = x;
+        }
     }
+
+    drawSpectrum(g);
+
+    paintTimeMetric.set(juce::Time::getMillisecondCounterHiRes() - paintStart);
+    framesMetric.add(1.0);
 }
 
 // ------------------- Resized -------------------
 void PlayerGUI::resized()
 {
-    int margin=10, btnW=100, btnH=30, y=200;
+    int margin=10, btnW=100, btnH=30, y=300;
+
+    // The spectrogram keeps one image column per pixel of its area
+    auto spectrogramWidth = juce::jmax(1, getSpectrumArea().getWidth() - spectrumCurveWidth - margin);
+    if(!spectrogram.isValid() || spectrogram.getWidth() != spectrogramWidth)
+    {
+        spectrogram = juce::Image(juce::Image::RGB, spectrogramWidth, SpectrumAnalyser::numBands, true);
+        spectrogramWriteX = 0;
+    }
+
 
     loadButton.setBounds(margin,y,btnW,btnH); playPauseButton.setBounds(120,y,btnW,btnH); stopButton.setBounds(230,y,btnW,btnH); restartButton.setBounds(340,y,btnW,btnH);
     prevButton.setBounds(450,y,btnW,btnH); nextButton.setBounds(560,y,btnW,btnH); muteButton.setBounds(670,y,btnW,btnH); loopButton.setBounds(780,y,btnW,btnH);
@@ -115,59 +180,56 @@ void PlayerGUI::resized()
     titleLabel.setBounds(margin,y,400,20); artistLabel.setBounds(420,y,200,20); albumLabel.setBounds(630,y,200,20); durationLabel.setBounds(840,y,60,20);
 
     y += 30;
-    playlistBox.setBounds(margin,y,400,25);
-    markerList.setBounds(420,y,480,getHeight()-y-margin);
+    playlistBox.setBounds(margin,y,300,25); openUrlButton.setBounds(320,y,90,25);
+    prevMarkerButton.setBounds(margin,y+35,btnW,btnH); nextMarkerButton.setBounds(120,y+35,btnW,btnH); normalisationBox.setBounds(230,y+35,180,btnH);
+    switchLatencyLabel.setBounds(margin,y+70,190,20); recordButton.setBounds(205,y+67,80,25); recordingLabel.setBounds(290,y+70,120,20);
+    crossfadeSlider.setBounds(margin,y+100,400,20);
+    for(int i = 0; i < (int)eqSliders.size(); ++i) eqSliders[(size_t)i].setBounds(margin+i*40,y+130,40,getHeight()-y-130-margin);
+    markerList.setBounds(420,y,430,getHeight()-y-margin);
+    meterDisplay.setBounds(860,y,30,getHeight()-y-margin);
 }
 
 // ------------------- Button callbacks -------------------
 void PlayerGUI::buttonClicked(juce::Button* button)
 {
-    if(button == &setAButton)
-        loopStart = playerAudio.getCurrentPosition();
-    else if(button == &setBButton)
-        loopEnd = playerAudio.getCurrentPosition();
+    if(button == &setAButton || button == &setBButton)
+    {
+        (button == &setAButton ? loopStart : loopEnd) = playerAudio.getCurrentPosition();
+        if(isABLooping && loopEnd > loopStart) playerAudio.setLoopRange(loopStart, loopEnd);
+    }
     else if(button == &abLoopingButton)
     {
         if(loopStart >=0 && loopEnd>loopStart)
         {
             isABLooping = !isABLooping;
             abLoopingButton.setButtonText(isABLooping ? "Stop A-B Loop" : "Start A-B Loop");
+            if(isABLooping) playerAudio.setLoopRange(loopStart, loopEnd); else playerAudio.clearLoopRange();
         }
     }
     else if(button == &loopButton)
     {
         isLooping = !isLooping;
         loopButton.setButtonText(isLooping ? "Loop On" : "Loop Off");
+        playerAudio.setLooping(isLooping);
     }
     else if(button == &muteButton)
     {
-        if(!isMuted){ playerAudio.setGain(0.0f); muteButton.setButtonText("Unmute"); }
-        else{ playerAudio.setGain((float)volumeSlider.getValue()); muteButton.setButtonText("Mute"); }
+        // The gain stage fades out and back to the slider volume
         isMuted = !isMuted;
+        playerAudio.setMuted(isMuted);
+        muteButton.setButtonText(isMuted ? "Unmute" : "Mute");
     }
     else if(button == &loadButton)
     {
-        fileChooser = std::make_unique<juce::FileChooser>("Select audio files...", juce::File{}, "*.wav;*.mp3;*.aiff;*.ogg;*.flac");
+        fileChooser = std::make_unique<juce::FileChooser>("Select audio files...", juce::File{}, "*.wav;*.mp3;*.aiff;*.ogg;*.flac;*.m4a;*.m4b;*.cue");
         fileChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectMultipleItems,
             [this](const juce::FileChooser& chooser)
             {
-                auto files = chooser.getResults();
-                if(!files.isEmpty())
-                {
-                    playlist.clear(); playlistBox.clear();
-                    for(int i=0;i<files.size();i++)
-                    {
-                        playlist.push_back(files[i]);
-                        playlistBox.addItem(files[i].getFileName(), i+1);
-                    }
-                    currentTrackIndex = 0; playlistBox.setSelectedId(1, juce::dontSendNotification);
-                    if(loadCurrentTrack())
-                    {
-                        playerAudio.start();
-                        isPlaying = true;
-                        playPauseButton.setButtonText("Pause");
-                    }
-                }
+                std::vector<PlaylistEntry> entries;
+                for(auto& f : chooser.getResults())
+                    for(auto& e : ChapterReader::expand(f))
+                        entries.push_back(e);
+                if(!entries.empty()) replacePlaylist(entries);
             });
     }
     else if(button == &playPauseButton)
@@ -195,6 +257,8 @@ void PlayerGUI::buttonClicked(juce::Button* button)
     {
         playerAudio.setPosition(0.0); playerAudio.start(); playPauseButton.setButtonText("Pause"); isPlaying = true;
     }
+    else if(button == &recordButton) toggleRecording();
+    else if(button == &openUrlButton) askForUrl();
     else if(button == &nextButton) nextTrack();
     else if(button == &prevButton) prevTrack();
     else if(button == &goToStartButton) playerAudio.setPosition(0.0);
@@ -208,35 +272,61 @@ void PlayerGUI::buttonClicked(juce::Button* button)
     else if(button == &backwardButton) playerAudio.setPosition(std::max(playerAudio.getCurrentPosition()-10.0,0.0));
     else if(button == &addMarkerButton)
     {
-        markers.push_back({"Marker "+juce::String(markers.size()+1), playerAudio.getCurrentPosition()});
-        markerList.updateContent(); markerList.repaint();
+        auto& markers = getMarkers();
+        int row = markers.add({"Marker "+juce::String(markers.size()+1), playerAudio.getCurrentPosition()});
+        markerList.updateContent(); markerList.selectRow(row, true); markerList.repaint();
     }
+    else if(button == &nextMarkerButton) jumpToMarker(getMarkers().findNext(playerAudio.getCurrentPosition()));
+    else if(button == &prevMarkerButton) jumpToMarker(getMarkers().findPrevious(playerAudio.getCurrentPosition()));
 }
 
 // ------------------- Slider callbacks -------------------
 void PlayerGUI::sliderValueChanged(juce::Slider* slider)
 {
-    if(slider == &volumeSlider && !isMuted) playerAudio.setGain((float)volumeSlider.getValue());
+    if(slider == &volumeSlider) playerAudio.setGain((float)volumeSlider.getValue());
     else if(slider == &speedSlider) playerAudio.setPlaybackSpeed((float)speedSlider.getValue());
+    else if(auto knob = std::find_if(eqSliders.begin(), eqSliders.end(), [slider](auto& s){ return &s == slider; }); knob != eqSliders.end())
+    {
+        int band = (int)(knob - eqSliders.begin());
+        auto settings = playerAudio.getEqualiser().getBand(band);
+        settings.gainDb = (float)slider->getValue();
+        playerAudio.getEqualiser().setBand(band, settings);
+    }
     else if(slider == &positionSlider)
     {
-        isDraggingPosition = true;
-        double pos = slider->getValue() * playerAudio.getLengthInSeconds();
-        playerAudio.setPosition(pos);
+        // While dragging only the scrub target moves; the real seek happens on release
+        double pos = slider->getValue() * getTrackLength();
+        if(isDraggingPosition) playerAudio.scrubTo(getTrackStart() + pos);
+        else playerAudio.setPosition(getTrackStart() + pos);
         int minutes = (int)pos / 60;
         int seconds = (int)pos % 60;
         currentTimeLabel.setText(juce::String(minutes)+":"+juce::String(seconds).paddedLeft('0',2), juce::dontSendNotification);
-        isDraggingPosition = false;
     }
 }
 
+void PlayerGUI::sliderDragStarted(juce::Slider* slider)
+{
+    if(slider != &positionSlider) return;
+    isDraggingPosition = true;
+    playerAudio.beginScrub(getTrackStart() + slider->getValue() * getTrackLength());
+}
+
+void PlayerGUI::sliderDragEnded(juce::Slider* slider)
+{
+    if(slider != &positionSlider) return;
+    playerAudio.endScrub();
+    isDraggingPosition = false;
+}
+
 // ------------------- ComboBox callbacks -------------------
 void PlayerGUI::comboBoxChanged(juce::ComboBox* comboBox)
 {
+    if(comboBox == &normalisationBox) applyNormalisation();
+
     if(comboBox == &playlistBox)
     {
         int idx = playlistBox.getSelectedId()-1;
-        if(idx >=0 && idx < (int)playlist.size()){ currentTrackIndex = idx; loadCurrentTrack(); playerAudio.start(); isPlaying=true; playPauseButton.setButtonText("Pause"); }
+        if(idx >=0 && idx < (int)playlist.size()){ currentTrackIndex = idx; loadCurrentTrack(); }
     }
 }
 
@@ -252,12 +342,7 @@ void PlayerGUI::changeListenerCallback(juce::ChangeBroadcaster*)
         {
             currentTrackIndex++;
             playlistBox.setSelectedId(currentTrackIndex + 1, juce::dontSendNotification);
-            if(loadCurrentTrack())
-            {
-                playerAudio.start();
-                isPlaying = true;
-                playPauseButton.setButtonText("Pause");
-            }
+            loadCurrentTrack();
         }
         else
         {
@@ -268,29 +353,320 @@ void PlayerGUI::changeListenerCallback(juce::ChangeBroadcaster*)
 }
 
 // ------------------- Load Track -------------------
+// Fast-start path: the reader is opened (and its first block decoded) on the scheduler and
+// playback starts the moment it is handed over. Thumbnail and tags follow on their own jobs.
 bool PlayerGUI::loadCurrentTrack()
 {
-    if(currentTrackIndex>=0 && currentTrackIndex<(int)playlist.size())
+    if(currentTrackIndex<0 || currentTrackIndex>=(int)playlist.size())
+        return false;
+
+    auto& entry = playlist[currentTrackIndex];
+    playerAudio.beginSwitchTiming(juce::Time::getMillisecondCounterHiRes());
+    if(entry.isStream()) return loadStream(entry);
+
+    // Virtual tracks of the file that is already open only need a seek
+    if(entry.file == playerAudio.getLoadedFile())
+    {
+        playerAudio.setPositionInSamples(juce::roundToInt64(entry.startTime * playerAudio.getSourceSampleRate()));
+        playerAudio.armSwitchTiming();
+        startPlaying();
+        showTrackInfo(entry, currentTags);
+        return true;
+    }
+
+    cancelTrackJobs(); // work for the previous track (or a pending restore) is no longer wanted
+    currentTags = {};
+
+    if(!entry.file.existsAsFile())
+    {
+        trackFailedToOpen(entry);
+        return false;
+    }
+
+    juce::Component::SafePointer<PlayerGUI> safeThis(this);
+    auto group = trackJobs;
+    auto file = entry.file;
+    auto startTime = entry.startTime;
+
+    playerAudio.openReaderAsync(file, group, [safeThis, file, startTime](std::unique_ptr<juce::AudioFormatReader> reader)
     {
-        auto& file = playlist[currentTrackIndex];
-        if(playerAudio.loadFile(file))
+        if(safeThis == nullptr) return;
+        auto& gui = *safeThis;
+        if(!gui.playerAudio.loadReader(std::move(reader), file))
         {
-            playerAudio.setPosition(0.0);
-            audioThumbnail.clear(); audioThumbnail.setSource(new juce::FileInputSource(file));
+            gui.trackFailedToOpen(gui.playlist[(size_t)gui.currentTrackIndex]);
+            return;
+        }
+        gui.failedInARow = 0;
 
-            TagLib::FileRef f(file.getFullPathName().toStdString().c_str());
-            if(!f.isNull() && f.tag())
-            {
-                auto* tag = f.tag();
-                titleLabel.setText(tag->title().isEmpty()?file.getFileName():tag->title().to8Bit(true), juce::dontSendNotification);
-                artistLabel.setText(tag->artist().isEmpty()?"Unknown Artist":tag->artist().to8Bit(true), juce::dontSendNotification);
-                albumLabel.setText(tag->album().isEmpty()?"Unknown Album":tag->album().to8Bit(true), juce::dontSendNotification);
-                durationLabel.setText(juce::String(playerAudio.getLength(),2)+" s", juce::dontSendNotification);
-            }
-            return true;
+        gui.playerAudio.setPositionInSamples(juce::roundToInt64(startTime * gui.playerAudio.getSourceSampleRate()));
+        gui.startPlaying();
+
+        gui.startThumbnail(file);
+        gui.rebuildChapterMarkers();
+        gui.applyNormalisation();
+        gui.showTrackInfo(gui.playlist[(size_t)gui.currentTrackIndex], gui.currentTags);
+    }, startTime);
+
+    readTagsAsync(file);
+    prefetchNextStream();
+    return true;
+}
+
+// Says so in place of the title and moves on to the next track. The move is posted, so a run
+// of unplayable entries is walked one message at a time rather than by recursion, and it
+// stops after one full pass without a track that plays.
+void PlayerGUI::trackFailedToOpen(const PlaylistEntry& entry)
+{
+    juce::Logger::writeToLog("[load] could not play " + (entry.isStream() ? entry.url.toString(false) : entry.file.getFullPathName()));
+    titleLabel.setText("Can't play " + entry.getDisplayName(), juce::dontSendNotification);
+    artistLabel.setText({}, juce::dontSendNotification);
+    albumLabel.setText({}, juce::dontSendNotification);
+
+    if(++failedInARow >= (int)playlist.size())
+    {
+        failedInARow = 0;
+        playerAudio.stop();
+        isPlaying = false;
+        playPauseButton.setButtonText("Play");
+        return;
+    }
+
+    juce::Component::SafePointer<PlayerGUI> safeThis(this);
+    const int failedIndex = currentTrackIndex;
+    juce::MessageManager::callAsync([safeThis, failedIndex]
+    {
+        // Unless the user has picked another track meanwhile
+        if(safeThis == nullptr || safeThis->currentTrackIndex != failedIndex || safeThis->playlist.empty()) return;
+        auto& gui = *safeThis;
+        gui.currentTrackIndex = (failedIndex + 1) % (int)gui.playlist.size();
+        gui.playlistBox.setSelectedId(gui.currentTrackIndex + 1, juce::dontSendNotification);
+        gui.loadCurrentTrack();
+    });
+}
+
+void PlayerGUI::readTagsAsync(const juce::File& file)
+{
+    juce::Component::SafePointer<PlayerGUI> safeThis(this);
+    auto group = trackJobs;
+
+    scheduler->submit(JobScheduler::currentTrack, group, [safeThis, group, file](const JobScheduler::Group&)
+    {
+        auto tags = TrackTags::read(file);
+        juce::MessageManager::callAsync([safeThis, group, tags]
+        {
+            if(safeThis == nullptr || group->isCancelled()) return;
+            safeThis->currentTags = tags;
+            safeThis->showTrackInfo(safeThis->playlist[(size_t)safeThis->currentTrackIndex], tags);
+        });
+    });
+}
+
+void PlayerGUI::startPlaying()
+{
+    playerAudio.start();
+    isPlaying = true;
+    playPauseButton.setButtonText("Pause");
+}
+
+void PlayerGUI::showTrackInfo(const PlaylistEntry& entry, const TrackTags& tags)
+{
+    juce::String title = entry.isVirtual ? entry.title : (tags.valid ? tags.title : entry.getDisplayName());
+    juce::String artist = entry.artist.isNotEmpty() ? entry.artist : (tags.valid ? tags.artist : "Unknown Artist");
+    titleLabel.setText(title, juce::dontSendNotification);
+    artistLabel.setText(artist, juce::dontSendNotification);
+    albumLabel.setText(tags.valid ? tags.album : "Unknown Album", juce::dontSendNotification);
+    durationLabel.setText(juce::String(getTrackLength(),2)+" s", juce::dontSendNotification);
+}
+
+// ------------------- Playlist / virtual tracks -------------------
+void PlayerGUI::addToPlaylist(const std::vector<PlaylistEntry>& entries)
+{
+    for(auto& e : entries)
+    {
+        playlist.push_back(e);
+        playlistBox.addItem(e.getDisplayName(), (int)playlist.size());
+    }
+}
+
+// Starts playing the first of entries in place of the old playlist
+void PlayerGUI::replacePlaylist(const std::vector<PlaylistEntry>& entries)
+{
+    playlist.clear(); playlistBox.clear();
+    addToPlaylist(entries);
+    scanPlaylistLoudness();
+    currentTrackIndex = 0; playlistBox.setSelectedId(1, juce::dontSendNotification);
+    loadCurrentTrack();
+}
+
+int PlayerGUI::findEntryAt(const juce::File& file, double filePosition) const
+{
+    int fallback = -1;
+    for(int i=0;i<(int)playlist.size();i++)
+    {
+        if(playlist[i].file != file) continue;
+        if(playlist[i].contains(filePosition)) return i;
+        if(fallback < 0) fallback = i;
+    }
+    return fallback;
+}
+
+double PlayerGUI::getTrackStart() const
+{
+    if(currentTrackIndex<0 || currentTrackIndex>=(int)playlist.size()) return 0.0;
+    return playlist[currentTrackIndex].startTime;
+}
+
+double PlayerGUI::getTrackLength() const
+{
+    double fileLength = playerAudio.getLengthInSeconds();
+    if(currentTrackIndex<0 || currentTrackIndex>=(int)playlist.size()) return fileLength;
+    auto& entry = playlist[currentTrackIndex];
+    double end = entry.endTime < 0.0 ? fileLength : std::min(entry.endTime, fileLength);
+    return std::max(0.0, end - entry.startTime);
+}
+
+// ------------------- Loudness normalisation -------------------
+void PlayerGUI::scanPlaylistLoudness()
+{
+    juce::Array<juce::File> files;
+    for(auto& e : playlist)
+        if(!e.isStream()) files.addIfNotAlreadyThere(e.file);
+    loudnessScanner.scan(files);
+}
+
+// Album gain treats the playlist files sharing the current file's folder as one album
+void PlayerGUI::applyNormalisation()
+{
+    auto current = playerAudio.getLoadedFile();
+    LoudnessResult measured;
+    int mode = normalisationBox.getSelectedId();
+
+    if(current != juce::File() && mode == normalisationTrack)
+        loudnessScanner.getResult(current, measured);
+    else if(current != juce::File() && mode == normalisationAlbum)
+    {
+        juce::Array<juce::File> albumFiles;
+        for(auto& e : playlist)
+            if(e.file.getParentDirectory() == current.getParentDirectory())
+                albumFiles.addIfNotAlreadyThere(e.file);
+
+        std::vector<LoudnessResult> tracks;
+        for(auto& f : albumFiles)
+        {
+            LoudnessResult r;
+            if(loudnessScanner.getResult(f, r)) tracks.push_back(r);
         }
+        measured = LoudnessAnalyser::combine(tracks);
     }
-    return false;
+
+    playerAudio.setNormalisationGain(LoudnessAnalyser::getNormalisationGain(measured));
+}
+
+// ------------------- Markers -------------------
+MarkerStore& PlayerGUI::getMarkers()
+{
+    auto file = playerAudio.getLoadedFile();
+    if(file == juce::File()) return noTrackMarkers;
+    return markerStores[file.getFullPathName()];
+}
+
+// Chapters and cue tracks of the open file double as markers
+void PlayerGUI::rebuildChapterMarkers()
+{
+    std::vector<MarkerStore::Marker> chapters;
+    for(auto& e : playlist)
+        if(e.isVirtual && e.file == playerAudio.getLoadedFile())
+            chapters.push_back({ e.title, e.startTime, true });
+
+    auto& markers = getMarkers();
+    markers.removeChapters();
+    markers.addBatch(chapters);
+    markerList.updateContent(); markerList.repaint();
+}
+
+void PlayerGUI::jumpToMarker(int index)
+{
+    auto& markers = getMarkers();
+    if(index<0 || index>=markers.size()) return;
+    playerAudio.setPosition(markers[index].position);
+    markerList.selectRow(index, true);
+}
+
+// Playback crossing a chapter boundary just moves the selection; the reader keeps going
+void PlayerGUI::followVirtualTracks()
+{
+    if(currentTrackIndex<0 || currentTrackIndex>=(int)playlist.size()) return;
+    auto& entry = playlist[currentTrackIndex];
+    if(!entry.isVirtual || entry.file != playerAudio.getLoadedFile()) return;
+
+    double pos = playerAudio.getCurrentPosition();
+    if(entry.contains(pos)) return;
+
+    if(isLooping && entry.endTime >= 0.0 && pos >= entry.endTime)
+    {
+        playerAudio.setPositionInSamples(juce::roundToInt64(entry.startTime * playerAudio.getSourceSampleRate()));
+        return;
+    }
+
+    int idx = findEntryAt(entry.file, pos);
+    if(idx >= 0 && idx != currentTrackIndex)
+    {
+        currentTrackIndex = idx;
+        playlistBox.setSelectedId(idx+1, juce::dontSendNotification);
+        showTrackInfo(playlist[idx], currentTags);
+    }
+}
+
+// Near the end of a track the next file is opened into the idle deck; once the remaining
+// time equals the crossfade length the two overlap and the next track becomes current.
+// Virtual tracks of one file keep playing gaplessly.
+void PlayerGUI::updateCrossfade()
+{
+    playerAudio.update();
+
+    double fadeSeconds = crossfadeSlider.getValue();
+    int next = currentTrackIndex + 1;
+    if(fadeSeconds <= 0.0 || !isPlaying || isLooping || isABLooping || isDraggingPosition
+       || currentTrackIndex < 0 || next >= (int)playlist.size())
+        return;
+
+    // A stream next in line is already prefetching; it starts when this track ends
+    auto& entry = playlist[(size_t)next];
+    if(entry.isStream() || entry.file == playerAudio.getLoadedFile()) return;
+    if(playerAudio.hasPreloaded() && playerAudio.getPreloadedFile() != entry.file) playerAudio.cancelPreload();
+
+    double remaining = getTrackStart() + getTrackLength() - playerAudio.getCurrentPosition();
+    if(!playerAudio.hasPreloaded())
+    {
+        if(preloadPending || remaining > fadeSeconds + preloadLeadSeconds) return;
+
+        preloadPending = true;
+        juce::Component::SafePointer<PlayerGUI> safeThis(this);
+        auto file = entry.file;
+        auto startTime = entry.startTime;
+        playerAudio.openReaderAsync(file, trackJobs, [safeThis, file, startTime](std::unique_ptr<juce::AudioFormatReader> reader)
+        {
+            if(safeThis == nullptr) return;
+            safeThis->preloadPending = false;
+            safeThis->playerAudio.preloadNext(std::move(reader), file, startTime);
+        }, startTime);
+        return;
+    }
+
+    if(remaining > fadeSeconds) return;
+
+    playerAudio.crossfadeToPreloaded(juce::jmax(0.0, remaining));
+    cancelTrackJobs();
+    currentTrackIndex = next;
+    currentTags = {};
+    playlistBox.setSelectedId(next+1, juce::dontSendNotification);
+
+    startThumbnail(entry.file);
+    rebuildChapterMarkers();
+    applyNormalisation();
+    showTrackInfo(entry, currentTags);
+    readTagsAsync(entry.file);
 }
 
 // ------------------- Next / Prev -------------------
@@ -299,11 +675,8 @@ void PlayerGUI::nextTrack()
     if(!playlist.empty())
     {
         currentTrackIndex = (currentTrackIndex+1)%playlist.size();
-        playlistBox.setSelectedId(currentTrackIndex+1);
+        playlistBox.setSelectedId(currentTrackIndex+1, juce::dontSendNotification);
         loadCurrentTrack();
-        playerAudio.start();
-        isPlaying = true;
-        playPauseButton.setButtonText("Pause");
     }
 }
 
@@ -312,64 +685,180 @@ void PlayerGUI::prevTrack()
     if(!playlist.empty())
     {
         currentTrackIndex = (currentTrackIndex-1+playlist.size())%playlist.size();
-        playlistBox.setSelectedId(currentTrackIndex+1);
+        playlistBox.setSelectedId(currentTrackIndex+1, juce::dontSendNotification);
         loadCurrentTrack();
-        playerAudio.start();
-        isPlaying = true;
-        playPauseButton.setButtonText("Pause");
     }
 }
 
 // ------------------- Session management -------------------
 void PlayerGUI::saveSession()
 {
-    juce::DynamicObject sessionState;
+    const Tracer::Span span("saveSession", "session");
+    Session session;
     if(!playlist.empty() && currentTrackIndex>=0)
     {
-        sessionState.setProperty("lastFile", playlist[currentTrackIndex].getFullPathName());
-        sessionState.setProperty("position", playerAudio.getCurrentPosition());
+        session.lastFile = playlist[currentTrackIndex].file;
+        session.position = playerAudio.getCurrentPosition();
     }
-    juce::var sessionVar(&sessionState);
-    juce::String jsonString = juce::JSON::toString(sessionVar,true);
-    sessionFile.replaceWithText(jsonString);
+    session.crossfade = crossfadeSlider.getValue();
+    for(auto& knob : eqSliders) session.eqGains.push_back(knob.getValue());
+    session.markers = markerStores;
+
+    sessionFile.getParentDirectory().createDirectory();
+    sessionFile.replaceWithText(session.toJson());
 }
 
 void PlayerGUI::loadSession()
 {
-    if(sessionFile.existsAsFile())
+    juce::Component::SafePointer<PlayerGUI> safeThis(this);
+    auto group = trackJobs;
+    auto file = sessionFile;
+
+    // Reading and parsing happen on the scheduler; only applying the result touches the GUI
+    scheduler->submit(JobScheduler::currentTrack, group, [safeThis, group, file](const JobScheduler::Group&)
     {
-        juce::String jsonString = sessionFile.loadFileAsString();
-        juce::var sessionVar = juce::JSON::parse(jsonString);
-        if(auto* obj = sessionVar.getDynamicObject())
+        if(!file.existsAsFile()) return;
+        const Tracer::Span span("loadSession", "session");
+        auto session = std::make_shared<Session>(Session::parse(file.loadFileAsString()));
+
+        juce::MessageManager::callAsync([safeThis, group, session]
         {
-            juce::String lastFile = obj->getProperty("lastFile").toString();
-            double position = obj->getProperty("position");
+            if(safeThis == nullptr) return;
+            const Tracer::Span applySpan("applySession", "session");
+            auto& gui = *safeThis;
 
-            juce::File lastAudioFile(lastFile);
-            if(lastAudioFile.existsAsFile())
-            {
-                auto it = std::find_if(playlist.begin(), playlist.end(), [&](const juce::File& f){ return f==lastAudioFile; });
-                if(it==playlist.end()){ playlist.push_back(lastAudioFile); currentTrackIndex=(int)playlist.size()-1; }
-                else currentTrackIndex = (int)std::distance(playlist.begin(),it);
-                if(loadCurrentTrack())
-                {
-                    playerAudio.setPosition(position);
-                    playerAudio.start();
-                    isPlaying = true;
-                    playPauseButton.setButtonText("Pause");
-                }
-            }
+            gui.crossfadeSlider.setValue(session->crossfade, juce::dontSendNotification);
+            for(size_t i = 0; i < juce::jmin(session->eqGains.size(), gui.eqSliders.size()); ++i)
+                gui.eqSliders[i].setValue(session->eqGains[i], juce::sendNotificationSync);
+
+            for(auto& [path, store] : session->markers)
+                gui.markerStores[path] = store;
+            gui.rebuildChapterMarkers();
+
+            // Skip the track restore if the user already picked something else
+            if(!group->isCancelled() && session->lastFile.existsAsFile())
+                gui.restoreTrackAsync(session->lastFile, session->position);
+            StartupProfiler::mark("session parsed");
+        });
+    });
+}
+
+// Tags and chapters are read on one job while PlayerAudio opens the reader on another;
+// playback starts at the saved position as soon as the reader is ready
+void PlayerGUI::restoreTrackAsync(const juce::File& file, double position)
+{
+    juce::Component::SafePointer<PlayerGUI> safeThis(this);
+    auto group = trackJobs;
+
+    scheduler->submit(JobScheduler::currentTrack, group, [safeThis, group, file, position](const JobScheduler::Group&)
+    {
+        auto tags = TrackTags::read(file);
+        auto entries = ChapterReader::expand(file);
+
+        juce::MessageManager::callAsync([safeThis, group, file, position, tags, entries]
+        {
+            if(safeThis == nullptr || group->isCancelled()) return;
+            auto& gui = *safeThis;
+
+            if(gui.findEntryAt(file, position) < 0) gui.addToPlaylist(entries);
+            // The chapters read now may not cover the saved position, or the file may have none
+            const int index = gui.findEntryAt(file, position);
+            if(index < 0 && gui.playlist.empty()) return;
+            gui.currentTrackIndex = juce::jmax(0, index);
+            gui.playlistBox.setSelectedId(gui.currentTrackIndex+1, juce::dontSendNotification);
+            gui.currentTags = tags;
+            gui.showTrackInfo(gui.playlist[(size_t)gui.currentTrackIndex], tags);
+            gui.rebuildChapterMarkers();
+            gui.scanPlaylistLoudness();
+        });
+    });
+
+    playerAudio.openReaderAsync(file, group, [safeThis, file, position](std::unique_ptr<juce::AudioFormatReader> reader)
+    {
+        if(safeThis == nullptr) return;
+        auto& gui = *safeThis;
+        StartupProfiler::mark("reader opened");
+
+        if(!gui.playerAudio.loadReader(std::move(reader), file))
+            return;
+
+        gui.playerAudio.setPosition(position);
+        gui.startPlaying();
+        StartupProfiler::mark("playback restored");
+
+        gui.startThumbnail(file);
+        gui.rebuildChapterMarkers();
+        gui.applyNormalisation();
+        if(gui.currentTrackIndex >= 0 && gui.currentTrackIndex < (int)gui.playlist.size())
+            gui.showTrackInfo(gui.playlist[(size_t)gui.currentTrackIndex], gui.currentTags);
+    }, position);
+}
+
+void PlayerGUI::cancelTrackJobs()
+{
+    retireJobs(trackJobs);
+    preloadPending = false;
+}
+
+// Cancels without waiting and puts a fresh group in its place; the old one is kept until
+// its jobs are done, because they may still use this or playerAudio
+void PlayerGUI::retireJobs(JobScheduler::GroupPtr& group)
+{
+    group->cancel();
+    retiredJobs.erase(std::remove_if(retiredJobs.begin(), retiredJobs.end(),
+                                     [](const JobScheduler::GroupPtr& g) { return g->isIdle(); }),
+                      retiredJobs.end());
+    retiredJobs.push_back(group);
+    group = JobScheduler::createGroup();
+}
+
+// A decode still running for the previous track checks its group under the lock, so once
+// its group is cancelled here it adds nothing more
+void PlayerGUI::clearThumbnail()
+{
+    const juce::ScopedLock sl(thumbnailLock);
+    retireJobs(thumbnailJobs);
+    audioThumbnail.clear();
+}
+
+// Decodes the waveform overview on the scheduler instead of the thumbnail cache's own thread
+void PlayerGUI::startThumbnail(const juce::File& file)
+{
+    clearThumbnail();
+
+    scheduler->submit(JobScheduler::currentTrack, thumbnailJobs, [this, file](const JobScheduler::Group& group)
+    {
+        const Tracer::Span span("thumbnail", "decode");
+        auto reader = formats->createReaderFor(file);
+        if(reader == nullptr) return;
+
+        {
+            const juce::ScopedLock sl(thumbnailLock);
+            if(group.isCancelled()) return;
+            audioThumbnail.reset((int)reader->numChannels, reader->sampleRate, reader->lengthInSamples);
         }
-    }
+
+        juce::AudioBuffer<float> block((int)reader->numChannels, 32768);
+        for(juce::int64 pos = 0; pos < reader->lengthInSamples; pos += block.getNumSamples())
+        {
+            int n = (int)std::min((juce::int64)block.getNumSamples(), reader->lengthInSamples - pos);
+            reader->read(&block, 0, n, pos, true, true);
+
+            const juce::ScopedLock sl(thumbnailLock);
+            if(group.isCancelled()) return;
+            audioThumbnail.addBlock(pos, block, 0, n);
+        }
+    });
 }
 
 // ------------------- Track Markers ListBox -------------------
-int PlayerGUI::getNumRows(){ return (int)markers.size(); }
+int PlayerGUI::getNumRows(){ return getMarkers().size(); }
 
 void PlayerGUI::paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected)
 {
     g.fillAll(rowIsSelected ? juce::Colour(255,165,0) : juce::Colour(40,40,40));
-    if(rowNumber>=0 && rowNumber<(int)markers.size())
+    auto& markers = getMarkers();
+    if(rowNumber>=0 && rowNumber<markers.size())
     {
         auto& m = markers[rowNumber];
         g.setColour(juce::Colours::white);
@@ -379,7 +868,8 @@ void PlayerGUI::paintListBoxItem(int rowNumber, juce::Graphics& g, int width, in
 
 void PlayerGUI::listBoxItemClicked(int row,const juce::MouseEvent&)
 {
-    if(row>=0 && row<(int)markers.size())
+    auto& markers = getMarkers();
+    if(row>=0 && row<markers.size())
     {
         playerAudio.setPosition(markers[row].position); playerAudio.start(); playPauseButton.setButtonText("Pause"); isPlaying=true;
     }
@@ -388,8 +878,8 @@ void PlayerGUI::listBoxItemClicked(int row,const juce::MouseEvent&)
 // ------------------- Update Position Slider -------------------
 void PlayerGUI::updatePositionSlider()
 {
-    double pos = playerAudio.getCurrentPosition();
-    double len = playerAudio.getLengthInSeconds();
+    double pos = playerAudio.getCurrentPosition() - getTrackStart();
+    double len = getTrackLength();
     if(len>0.0)
     {
         positionSlider.setValue(pos/len, juce::dontSendNotification);
@@ -401,8 +891,322 @@ void PlayerGUI::updatePositionSlider()
 // ------------------- Timer callback -------------------
 void PlayerGUI::timerCallback()
 {
+    followVirtualTracks();
+    updateCrossfade();
+    updateSpectrum();
     if(!isDraggingPosition) updatePositionSlider();
-    repaint();
+
+    auto latency = playerAudio.takeSwitchLatency();
+    if(latency >= 0.0)
+    {
+        switchLatencyLabel.setText("Click to sound: " + juce::String(latency, 1) + " ms", juce::dontSendNotification);
+        juce::Logger::writeToLog("[switch] click-to-sound " + juce::String(latency, 1) + " ms");
+        Tracer::counter("switchLatencyMs", latency);
+
+        auto now = juce::Time::getMillisecondCounterHiRes();
+        if(latency > slowSwitchMs && now - lastTraceDumpMs > traceDumpIntervalMs)
+        {
+            lastTraceDumpMs = now;
+            dumpTrace("slow track switch");
+        }
+    }
+
+    if(playerAudio.getRecorder().isRecording()) updateRecordingLabel();
+    else if(recordingShown) recordingFinished(); // a device restart at a new rate ended it
+
+    if(RealtimeChecker::isEnabled())
+    {
+        auto report = RealtimeChecker::getReport();
+        if(report.isNotEmpty()) juce::Logger::writeToLog(report.trimEnd());
+    }
+
+    // A thumbnail keeps one min/max byte pair per channel for every 512 samples
+    thumbnailBytesMetric.set(audioThumbnail.getNumChannels() * (double)audioThumbnail.getNumSamplesFinished() / 512.0 * 2.0);
+    spectrogramBytesMetric.set(spectrogram.isValid() ? spectrogram.getWidth() * spectrogram.getHeight() * 4.0 : 0.0);
+
+    // Only the painted area above the controls changes every tick; child components repaint themselves
+    repaint(0, 0, getWidth(), getSpectrumArea().getBottom());
+}
+
+// ------------------- Tracing -------------------
+// Ctrl+Shift+T (Cmd+Shift+T on macOS) writes the trace buffers out
+bool PlayerGUI::keyPressed(const juce::KeyPress& key)
+{
+    if(key == juce::KeyPress('t', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0))
+    {
+        dumpTrace("requested");
+        return true;
+    }
+    return false;
+}
+
+void PlayerGUI::dumpTrace(const juce::String& reason)
+{
+    auto file = Tracer::createTraceFile();
+    if(Tracer::writeChromeTrace(file))
+        juce::Logger::writeToLog("[trace] " + reason + ", wrote " + file.getFullPathName());
+}
+
+// ------------------- Streams -------------------
+// Adds an HTTP(S) address to the end of the playlist and plays it
+void PlayerGUI::askForUrl()
+{
+    urlWindow = std::make_unique<juce::AlertWindow>("Open URL", "Address of an audio file on a web server", juce::MessageBoxIconType::NoIcon);
+    urlWindow->addTextEditor("url", "https://", "URL:");
+    urlWindow->addButton("Open", 1, juce::KeyPress(juce::KeyPress::returnKey));
+    urlWindow->addButton("Cancel", 0, juce::KeyPress(juce::KeyPress::escapeKey));
+
+    juce::Component::SafePointer<PlayerGUI> safeThis(this);
+    urlWindow->enterModalState(true, juce::ModalCallbackFunction::create([safeThis](int result)
+    {
+        if(safeThis == nullptr || result != 1) return;
+        auto& gui = *safeThis;
+        auto text = gui.urlWindow->getTextEditorContents("url").trim();
+        if(!text.startsWithIgnoreCase("http://") && !text.startsWithIgnoreCase("https://")) return;
+
+        PlaylistEntry entry;
+        entry.url = juce::URL(text);
+        gui.addToPlaylist({ entry });
+        gui.currentTrackIndex = (int)gui.playlist.size() - 1;
+        gui.playlistBox.setSelectedId(gui.currentTrackIndex + 1, juce::dontSendNotification);
+        gui.loadCurrentTrack();
+    }));
+}
+
+// Tags, waveform and loudness would each need the whole download, so a stream only shows its name
+bool PlayerGUI::loadStream(const PlaylistEntry& entry)
+{
+    cancelTrackJobs();
+    currentTags = {};
+    clearThumbnail();
+
+    juce::Component::SafePointer<PlayerGUI> safeThis(this);
+    auto url = entry.url;
+    playerAudio.openReaderAsync(url, trackJobs, [safeThis, url](std::unique_ptr<juce::AudioFormatReader> reader)
+    {
+        if(safeThis == nullptr) return;
+        auto& gui = *safeThis;
+        if(!gui.playerAudio.loadReader(std::move(reader), {}))
+        {
+            gui.trackFailedToOpen(gui.playlist[(size_t)gui.currentTrackIndex]);
+            return;
+        }
+        gui.failedInARow = 0;
+
+        gui.startPlaying();
+        gui.rebuildChapterMarkers();
+        gui.applyNormalisation();
+        gui.showTrackInfo(gui.playlist[(size_t)gui.currentTrackIndex], gui.currentTags);
+    });
+
+    prefetchNextStream();
+    return true;
+}
+
+void PlayerGUI::prefetchNextStream()
+{
+    const int next = currentTrackIndex + 1;
+    if(next < (int)playlist.size() && playlist[(size_t)next].isStream())
+        playerAudio.prefetch(playlist[(size_t)next].url);
+}
+
+// ------------------- Remote control -------------------
+bool PlayerGUI::startControlServer(int tcpPort, int oscPort)
+{
+    controlServer = std::make_unique<ControlServer>(playerAudio, *this);
+    if(controlServer->start(tcpPort, oscPort))
+    {
+        juce::Logger::writeToLog("[control] listening on 127.0.0.1, TCP port " + juce::String(controlServer->getTcpPort())
+                                 + ", OSC port " + juce::String(controlServer->getOscPort()));
+        return true;
+    }
+    juce::Logger::writeToLog("[control] could not open the control ports");
+    controlServer = nullptr;
+    return false;
+}
+
+// HTTP(S) addresses become stream entries, absolute paths are expanded like files from the Load button
+std::vector<PlaylistEntry> PlayerGUI::findEntriesFor(const juce::String& location) const
+{
+    if(location.startsWithIgnoreCase("http://") || location.startsWithIgnoreCase("https://"))
+    {
+        PlaylistEntry entry;
+        entry.url = juce::URL(location);
+        return { entry };
+    }
+    if(!juce::File::isAbsolutePath(location)) return {};
+    juce::File file(location);
+    return file.existsAsFile() ? ChapterReader::expand(file) : std::vector<PlaylistEntry>();
+}
+
+// Commands act through the same paths as the buttons, so the controls keep showing the truth
+bool PlayerGUI::handleControlCommand(const ControlServer::Command& command)
+{
+    using Command = ControlServer::Command;
+    switch(command.type)
+    {
+        case Command::play:
+            if(!isPlaying) buttonClicked(&playPauseButton);
+            return playerAudio.getLengthInSeconds() > 0.0;
+        case Command::pause:
+            if(isPlaying) buttonClicked(&playPauseButton);
+            return true;
+        case Command::toggle:
+            buttonClicked(&playPauseButton);
+            return true;
+        case Command::stop:
+            buttonClicked(&stopButton);
+            return true;
+        case Command::loop:
+            if(isLooping != (command.value != 0.0)) buttonClicked(&loopButton);
+            return true;
+        case Command::seek:
+            playerAudio.setPosition(juce::jmax(0.0, command.value));
+            updatePositionSlider();
+            return true;
+        // Already applied by the audio thread
+        case Command::gain:
+            volumeSlider.setValue(command.value, juce::dontSendNotification);
+            return true;
+        case Command::mute:
+            isMuted = command.value != 0.0;
+            muteButton.setButtonText(isMuted ? "Unmute" : "Mute");
+            return true;
+        case Command::load:
+        case Command::queue:
+        {
+            auto entries = findEntriesFor(command.text);
+            if(entries.empty()) return false;
+            if(command.type == Command::load || playlist.empty())
+            {
+                replacePlaylist(entries);
+                return true;
+            }
+            addToPlaylist(entries);
+            prefetchNextStream();
+            return true;
+        }
+        case Command::numTypes:
+            break;
+    }
+    return false;
+}
+
+ControlServer::State PlayerGUI::getControlState()
+{
+    ControlServer::State state;
+    state.playing = playerAudio.isPlaying();
+    state.position = playerAudio.getCurrentPosition();
+    state.length = playerAudio.getLengthInSeconds();
+    state.gain = (float)volumeSlider.getValue();
+    state.muted = isMuted;
+    state.looping = isLooping;
+    if(currentTrackIndex >= 0 && currentTrackIndex < (int)playlist.size())
+    {
+        state.track = playlist[(size_t)currentTrackIndex].getDisplayName();
+        state.queued = (int)playlist.size() - 1 - currentTrackIndex;
+    }
+    return state;
+}
+
+// ------------------- Recording -------------------
+// Records the output as heard; the file type follows the extension chosen
+void PlayerGUI::toggleRecording()
+{
+    auto& recorder = playerAudio.getRecorder();
+    if(recorder.isRecording())
+    {
+        recorder.stop();
+        recordingFinished();
+        return;
+    }
+
+    auto suggested = juce::File::getSpecialLocation(juce::File::userMusicDirectory)
+                         .getChildFile("Recording " + juce::Time::getCurrentTime().formatted("%Y-%m-%d %H-%M-%S") + ".wav");
+    fileChooser = std::make_unique<juce::FileChooser>("Record output to...", suggested, "*.wav;*.flac");
+    fileChooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::warnAboutOverwriting,
+        [this](const juce::FileChooser& chooser)
+        {
+            auto file = chooser.getResult();
+            if(file == juce::File()) return;
+            if(!file.hasFileExtension("wav;flac")) file = file.withFileExtension("wav");
+
+            if(playerAudio.getRecorder().start(file))
+            {
+                recordButton.setButtonText("Stop Rec");
+                recordingShown = true;
+                updateRecordingLabel();
+            }
+            else recordingLabel.setText("Can't write " + file.getFileName(), juce::dontSendNotification);
+        });
+}
+
+void PlayerGUI::recordingFinished()
+{
+    auto& recorder = playerAudio.getRecorder();
+    recordButton.setButtonText("Record");
+    recordingShown = false;
+    updateRecordingLabel();
+    juce::Logger::writeToLog("[record] wrote " + recorder.getFile().getFullPathName()
+                             + ", " + juce::String(recorder.getDroppedBlocks()) + " blocks dropped");
+}
+
+void PlayerGUI::updateRecordingLabel()
+{
+    auto& recorder = playerAudio.getRecorder();
+    auto seconds = (int)recorder.getRecordedSeconds();
+    juce::String text = juce::String(seconds / 60) + ":" + juce::String(seconds % 60).paddedLeft('0', 2);
+    if(recorder.getDroppedBlocks() > 0) text << ", " << recorder.getDroppedBlocks() << " dropped";
+    recordingLabel.setText(text, juce::dontSendNotification);
+}
+
+// ------------------- Spectrum -------------------
+void PlayerGUI::updateSpectrum()
+{
+    int numColumns = playerAudio.getAnalyser().popColumns(incomingColumns.data(), (int)incomingColumns.size());
+    if(numColumns == 0 || !spectrogram.isValid()) return;
+
+    {
+        juce::Image::BitmapData pixels(spectrogram, juce::Image::BitmapData::writeOnly);
+        for(int c = 0; c < numColumns; ++c)
+        {
+            auto& column = incomingColumns[(size_t)c];
+            for(int band = 0; band < SpectrumAnalyser::numBands; ++band)
+                pixels.setPixelColour(spectrogramWriteX, SpectrumAnalyser::numBands - 1 - band, juce::Colour(column.pixels[(size_t)band]));
+            spectrogramWriteX = (spectrogramWriteX + 1) % spectrogram.getWidth();
+        }
+    }
+    spectrumLevels = incomingColumns[(size_t)numColumns - 1].levels;
+}
+
+void PlayerGUI::drawSpectrum(juce::Graphics& g)
+{
+    auto area = getSpectrumArea();
+    auto curveArea = area.removeFromRight(spectrumCurveWidth);
+    area.removeFromRight(10);
+
+    // Oldest column at the left: the ring from the write position on, then its start
+    if(spectrogram.isValid())
+    {
+        const int older = spectrogram.getWidth() - spectrogramWriteX;
+        const int height = spectrogram.getHeight();
+        g.setImageResamplingQuality(juce::Graphics::lowResamplingQuality);
+        g.drawImage(spectrogram, area.getX(), area.getY(), older, area.getHeight(), spectrogramWriteX, 0, older, height);
+        if(spectrogramWriteX > 0)
+            g.drawImage(spectrogram, area.getX() + older, area.getY(), spectrogramWriteX, area.getHeight(), 0, 0, spectrogramWriteX, height);
+    }
+
+    g.setColour(juce::Colour(20,20,20));
+    g.fillRect(curveArea);
+    juce::Path curve;
+    for(int band = 0; band < SpectrumAnalyser::numBands; ++band)
+    {
+        float x = (float)curveArea.getX() + (float)band * (float)curveArea.getWidth() / (float)(SpectrumAnalyser::numBands - 1);
+        float y = (float)curveArea.getBottom() - spectrumLevels[(size_t)band] * (float)curveArea.getHeight();
+        if(band == 0) curve.startNewSubPath(x, y); else curve.lineTo(x, y);
+    }
+    g.setColour(juce::Colours::orange);
+    g.strokePath(curve, juce::PathStrokeType(1.5f));
 }
 
 // ------------------- Helper Functions -------------------
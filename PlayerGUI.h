@@ -1,10 +1,25 @@
 #pragma once
 #include <JuceHeader.h>
 #include "PlayerAudio.h"
+#include "PlaylistEntry.h"
+#include "MarkerStore.h"
+#include "LoudnessScanner.h"
+#include "JobScheduler.h"
+#include "MeterDisplay.h"
+#include "TrackTags.h"
+#include "ControlServer.h"
+#include <array>
+#include <map>
+#include <vector>
 
 class PlayerGUI : public juce::Component,
                   public juce::Button::Listener,
-                  public juce::Slider::Listener
+                  public juce::Slider::Listener,
+                  public juce::ComboBox::Listener,
+                  public juce::ChangeListener,
+                  public juce::ListBoxModel,
+                  private ControlServer::Target,
+                  private juce::Timer
 {
 public:
     PlayerGUI();
@@ -12,32 +27,184 @@ public:
 
     void resized() override;
     void paint(juce::Graphics& g) override;
-    void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+    bool keyPressed(const juce::KeyPress& key) override;
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numOutputChannels = 2);
     void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill);
     void releaseResources();
 
+    // Remote control from this machine; see ControlServer for the ports
+    bool startControlServer(int tcpPort, int oscPort);
+
+    // --- ListBoxModel (markers) ---
+    int getNumRows() override;
+    void paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected) override;
+    void listBoxItemClicked(int row, const juce::MouseEvent&) override;
+
 private:
     PlayerAudio playerAudio;
+    MeterDisplay meterDisplay { playerAudio.getLevelMeter() };
+
+    juce::SharedResourcePointer<FormatRegistry> formats;
+    juce::AudioThumbnailCache thumbnailCache{ 5 };
+    juce::AudioThumbnail audioThumbnail{ 512, formats->getFormatManager(), thumbnailCache };
 
     juce::TextButton loadButton{ "Load" };
     juce::TextButton restartButton{ "Restart" };
     juce::TextButton playPauseButton{ "Play" };
     juce::TextButton stopButton{ "Stop" };
+    juce::TextButton nextButton{ "Next" };
+    juce::TextButton prevButton{ "Prev" };
+    juce::TextButton muteButton{ "Mute" };
+    juce::TextButton loopButton{ "Loop Off" };
+    juce::TextButton goToStartButton{ "|<" };
+    juce::TextButton goToEndButton{ ">|" };
+    juce::TextButton forwardButton{ "+10s" };
+    juce::TextButton backwardButton{ "-10s" };
+    juce::TextButton addMarkerButton{ "Add Marker" };
+    juce::TextButton prevMarkerButton{ "<< Marker" };
+    juce::TextButton nextMarkerButton{ "Marker >>" };
+    juce::TextButton setAButton{ "Set A" };
+    juce::TextButton setBButton{ "Set B" };
+    juce::TextButton abLoopingButton{ "Start A-B Loop" };
+    juce::TextButton recordButton{ "Record" };
+    bool recordingShown = false; // the button says "Stop Rec"
+    juce::TextButton openUrlButton{ "Open URL" };
     juce::Slider volumeSlider;
+    juce::Slider speedSlider;
+    juce::Slider positionSlider;
+    juce::Slider crossfadeSlider;
+    std::array<juce::Slider, 10> eqSliders; // gain of each octave band
 
     // --- Metadata labels ---
     juce::Label titleLabel;
     juce::Label artistLabel;
     juce::Label albumLabel;
     juce::Label durationLabel;
+    juce::Label currentTimeLabel;
+    juce::Label switchLatencyLabel;
+    juce::Label recordingLabel;
+
+    // --- Playlist / markers ---
+    juce::ComboBox playlistBox;
+    juce::ComboBox normalisationBox;
+    juce::ListBox markerList;
+    std::vector<PlaylistEntry> playlist;
+    std::map<juce::String, MarkerStore> markerStores; // keyed by full path of the audio file
+    MarkerStore noTrackMarkers;
+    int currentTrackIndex = -1;
+    TrackTags currentTags; // tags of the open file, shared by its virtual tracks
 
     std::unique_ptr<juce::FileChooser> fileChooser;
+    std::unique_ptr<juce::AlertWindow> urlWindow;
     bool isPlaying = false;
+    bool isMuted = false;
+    bool isLooping = false;
+    bool isABLooping = false;
+    bool isDraggingPosition = false;
+    double loopStart = 0.0;
+    double loopEnd = 0.0;
+
+    // --- Loudness normalisation ---
+    enum NormalisationMode { normalisationOff = 1, normalisationTrack, normalisationAlbum };
+    LoudnessScanner loudnessScanner;
+
+    // --- Session ---
+    juce::File sessionFile = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+                                 .getChildFile("SimpleAudioPlayer").getChildFile("session.json");
+
+    // --- Background work ---
+    // Jobs for the open track are cancelled as soon as the user moves to another one
+    juce::SharedResourcePointer<JobScheduler> scheduler;
+    JobScheduler::GroupPtr trackJobs = JobScheduler::createGroup();
+    JobScheduler::GroupPtr thumbnailJobs = JobScheduler::createGroup();
+    // Cancelled groups whose jobs may still be running; those capture this, so the destructor waits
+    std::vector<JobScheduler::GroupPtr> retiredJobs;
+    // Held while the thumbnail decode adds a block, and while the thumbnail is handed to a new track
+    juce::CriticalSection thumbnailLock;
+    bool firstFramePainted = false;
+
+    // --- Tracing ---
+    // A switch slower than this dumps the trace buffers, at most once per traceDumpIntervalMs
+    static constexpr double slowSwitchMs = 250.0;
+    static constexpr double traceDumpIntervalMs = 60000.0;
+    double lastTraceDumpMs = -traceDumpIntervalMs;
+
+    // --- Metrics ---
+    juce::SharedResourcePointer<Metrics> metrics;
+    Metrics::Value& paintTimeMetric = metrics->getGauge("player_gui_paint_ms", "Time the last PlayerGUI paint took");
+    Metrics::Value& framesMetric = metrics->getCounter("player_gui_frames_total", "PlayerGUI paints");
+    Metrics::Value& thumbnailBytesMetric = metrics->getGauge("player_cache_bytes", "Memory held by GUI caches", "cache=\"thumbnail\"");
+    Metrics::Value& spectrogramBytesMetric = metrics->getGauge("player_cache_bytes", "Memory held by GUI caches", "cache=\"spectrogram\"");
+
+    // --- Crossfades ---
+    // The next file is opened this long before the overlap starts, so it is fully buffered
+    static constexpr double preloadLeadSeconds = 5.0;
+    bool preloadPending = false;
+    int failedInARow = 0; // entries skipped since one last played; a full pass of them stops
+
+    // --- Remote control ---
+    // Declared late so it is destroyed before anything it reaches
+    std::unique_ptr<ControlServer> controlServer;
+
+    // --- Spectrum ---
+    // Columns arrive already coloured; the spectrogram image is a ring written one column at a time
+    static constexpr int spectrumCurveWidth = 260;
+    juce::Image spectrogram;
+    int spectrogramWriteX = 0;
+    std::array<float, SpectrumAnalyser::numBands> spectrumLevels {};
+    std::vector<SpectrumAnalyser::Column> incomingColumns = std::vector<SpectrumAnalyser::Column>(64);
 
     void buttonClicked(juce::Button* button) override;
     void sliderValueChanged(juce::Slider* slider) override;
+    void sliderDragStarted(juce::Slider* slider) override;
+    void sliderDragEnded(juce::Slider* slider) override;
+    void comboBoxChanged(juce::ComboBox* comboBox) override;
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
+    void timerCallback() override;
+
+    bool loadCurrentTrack();
+    void startPlaying();
+    void readTagsAsync(const juce::File& file);
+    void trackFailedToOpen(const PlaylistEntry& entry);
+    void showTrackInfo(const PlaylistEntry& entry, const TrackTags& tags);
+    void addToPlaylist(const std::vector<PlaylistEntry>& entries);
+    int findEntryAt(const juce::File& file, double filePosition) const;
+    double getTrackStart() const;
+    double getTrackLength() const;
+    MarkerStore& getMarkers();
+    void rebuildChapterMarkers();
+    void scanPlaylistLoudness();
+    void applyNormalisation();
+    void jumpToMarker(int index);
+    void followVirtualTracks();
+    void updateCrossfade();
+    void updateSpectrum();
+    void drawSpectrum(juce::Graphics& g);
+    juce::Rectangle<int> getSpectrumArea() const { return { 10, 180, getWidth() - 20, 110 }; }
+    void nextTrack();
+    void prevTrack();
+
+    void saveSession();
+    void loadSession();
+    void restoreTrackAsync(const juce::File& file, double position);
+    void cancelTrackJobs();
+    void retireJobs(JobScheduler::GroupPtr& group);
+    void clearThumbnail();
+    void startThumbnail(const juce::File& file);
 
-    void loadFile(const juce::File& file); 
+    void updatePositionSlider();
+    void dumpTrace(const juce::String& reason);
+    void toggleRecording();
+    void recordingFinished();
+    void askForUrl();
+    bool loadStream(const PlaylistEntry& entry);
+    void prefetchNextStream();
+    void updateRecordingLabel();
+    std::vector<PlaylistEntry> findEntriesFor(const juce::String& location) const;
+    void replacePlaylist(const std::vector<PlaylistEntry>& entries);
+    bool handleControlCommand(const ControlServer::Command& command) override;
+    ControlServer::State getControlState() override;
+    void setLightTheme();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlayerGUI)
 };
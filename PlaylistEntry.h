@@ -0,0 +1,29 @@
+#pragma once
+#include <JuceHeader.h>
+
+// One row of the playlist. A plain entry plays a whole file; a virtual entry
+// (cue sheet track or embedded chapter) plays only [startTime, endTime) of it.
+// A stream entry plays from url and has no file.
+struct PlaylistEntry
+{
+    juce::File file;
+    juce::URL url;
+    juce::String title;
+    juce::String artist;
+    double startTime = 0.0;
+    double endTime = -1.0; // < 0 means "until the end of the file"
+    bool isVirtual = false;
+
+    bool isStream() const { return !url.isEmpty(); }
+
+    juce::String getDisplayName() const
+    {
+        if(isStream()) return juce::URL::removeEscapeChars(url.getFileName()) + " (" + url.getDomain() + ")";
+        return isVirtual ? file.getFileNameWithoutExtension() + " - " + title : file.getFileName();
+    }
+
+    bool contains(double filePosition) const
+    {
+        return filePosition >= startTime && (endTime < 0.0 || filePosition < endTime);
+    }
+};
@@ -0,0 +1,393 @@
+#include "RealtimeChecker.h"
+
+const char* RealtimeChecker::getKnownLockName(KnownLock site)
+{
+    switch(site)
+    {
+        case transportBlock: return "transport block";
+        case transportSeek:  return "transport seek";
+        default:             return "?";
+    }
+}
+
+#if SIMPLEAUDIOPLAYER_RT_CHECKS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+ #include <dbghelp.h>
+ #include <crtdbg.h>
+ #pragma comment(lib, "dbghelp.lib")
+#else
+ #include <execinfo.h>
+ #include <pthread.h>
+ #include <dlfcn.h>
+#endif
+
+namespace
+{
+    constexpr int maxFrames = 24;
+
+    struct Record
+    {
+        std::atomic<bool> ready { false };
+        int kind = 0;
+        juce::Thread::ThreadID thread = nullptr;
+        int numFrames = 0;
+        void* frames[maxFrames] {};
+    };
+
+    Record records[RealtimeChecker::maxRecords];
+    std::atomic<int> numRecords { 0 };
+    std::atomic<int> counts[RealtimeChecker::numKinds] {};
+    std::atomic<int> knownLockCounts[RealtimeChecker::numKnownLocks] {};
+    int numReported = 0; // reporting thread only
+
+    thread_local int audioDepth = 0;
+    thread_local int permitDepth = 0;
+    thread_local int knownLockSite = -1;
+    thread_local bool inHook = false; // stack capture or our own malloc calls must not recurse
+
+    struct HookGuard
+    {
+        bool wasInHook = inHook;
+        HookGuard() { inHook = true; }
+        ~HookGuard() { inHook = wasInHook; }
+    };
+
+    int captureStack(void** frames, int max)
+    {
+       #if JUCE_WINDOWS
+        return (int)CaptureStackBackTrace(2, (DWORD)max, frames, nullptr);
+       #else
+        return backtrace(frames, max);
+       #endif
+    }
+
+    // The first backtrace() loads the unwinder, which allocates; do that before any audio runs
+    const bool stackCapturePrimed = []
+    {
+        HookGuard guard;
+        void* frame = nullptr;
+        captureStack(&frame, 1);
+        return true;
+    }();
+
+    void* allocateUnchecked(std::size_t size)
+    {
+        HookGuard guard;
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void freeUnchecked(void* p)
+    {
+        HookGuard guard;
+        std::free(p);
+    }
+
+    void* allocateAlignedUnchecked(std::size_t size, std::align_val_t alignment)
+    {
+        HookGuard guard;
+       #if JUCE_WINDOWS
+        return _aligned_malloc(size == 0 ? 1 : size, (std::size_t)alignment);
+       #else
+        void* p = nullptr;
+        const auto align = juce::jmax((std::size_t)alignment, sizeof(void*));
+        return posix_memalign(&p, align, size == 0 ? 1 : size) == 0 ? p : nullptr;
+       #endif
+    }
+
+    void freeAlignedUnchecked(void* p)
+    {
+        HookGuard guard;
+       #if JUCE_WINDOWS
+        _aligned_free(p);
+       #else
+        std::free(p);
+       #endif
+    }
+
+    const char* kindName(int kind)
+    {
+        switch(kind)
+        {
+            case RealtimeChecker::allocation:   return "allocation";
+            case RealtimeChecker::deallocation: return "deallocation";
+            case RealtimeChecker::lock:         return "lock";
+            default:                            return "?";
+        }
+    }
+}
+
+RealtimeChecker::ScopedAudioCallback::ScopedAudioCallback()  { ++audioDepth; }
+RealtimeChecker::ScopedAudioCallback::~ScopedAudioCallback() { --audioDepth; }
+RealtimeChecker::ScopedPermit::ScopedPermit()  { ++permitDepth; }
+RealtimeChecker::ScopedPermit::~ScopedPermit() { --permitDepth; }
+RealtimeChecker::ScopedKnownLock::ScopedKnownLock(KnownLock site) : previous(knownLockSite) { knownLockSite = site; }
+RealtimeChecker::ScopedKnownLock::~ScopedKnownLock() { knownLockSite = previous; }
+
+void RealtimeChecker::recordViolation(Kind kind)
+{
+    if(audioDepth == 0 || permitDepth > 0 || inHook) return;
+    if(kind == lock && knownLockSite >= 0)
+    {
+        knownLockCounts[knownLockSite].fetch_add(1);
+        return;
+    }
+    HookGuard guard;
+
+    counts[kind].fetch_add(1);
+    int slot = numRecords.fetch_add(1);
+    if(slot >= maxRecords) return;
+
+    auto& record = records[slot];
+    record.kind = kind;
+    record.thread = juce::Thread::getCurrentThreadId();
+    record.numFrames = captureStack(record.frames, maxFrames);
+    record.ready.store(true);
+}
+
+int RealtimeChecker::getCount(Kind kind)
+{
+    return counts[kind].load();
+}
+
+int RealtimeChecker::getTotalCount()
+{
+    int total = 0;
+    for(auto& count : counts) total += count.load();
+    return total;
+}
+
+int RealtimeChecker::getKnownLockCount(KnownLock site)
+{
+    return knownLockCounts[site].load();
+}
+
+void RealtimeChecker::reset()
+{
+    for(auto& count : counts) count.store(0);
+    for(auto& count : knownLockCounts) count.store(0);
+    for(auto& record : records) record.ready.store(false);
+    numRecords.store(0);
+    numReported = 0;
+}
+
+juce::String RealtimeChecker::getReport()
+{
+    juce::String report;
+    const int available = juce::jmin(numRecords.load(), (int)maxRecords);
+    for(; numReported < available && records[numReported].ready.load(); ++numReported)
+    {
+        auto& record = records[numReported];
+        report << "[rt] " << kindName(record.kind) << " on the audio thread\n";
+
+       #if JUCE_WINDOWS
+        auto process = GetCurrentProcess();
+        static const bool symbolsLoaded = SymInitialize(process, nullptr, TRUE) != FALSE;
+        juce::ignoreUnused(symbolsLoaded);
+        alignas(SYMBOL_INFO) char storage[sizeof(SYMBOL_INFO) + 256] {};
+        auto* symbol = reinterpret_cast<SYMBOL_INFO*>(storage);
+        symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+        symbol->MaxNameLen = 255;
+        for(int i = 0; i < record.numFrames; ++i)
+        {
+            DWORD64 displacement = 0;
+            report << "    ";
+            if(SymFromAddr(process, (DWORD64)record.frames[i], &displacement, symbol))
+                report << symbol->Name << " + " << (int)displacement;
+            else
+                report << juce::String::toHexString((juce::pointer_sized_int)record.frames[i]);
+            report << "\n";
+        }
+       #else
+        if(char** symbols = backtrace_symbols(record.frames, record.numFrames))
+        {
+            for(int i = 0; i < record.numFrames; ++i)
+                report << "    " << symbols[i] << "\n";
+            std::free(symbols);
+        }
+       #endif
+    }
+
+    const int lost = numRecords.load() - maxRecords;
+    if(lost > 0 && report.isNotEmpty())
+        report << "[rt] " << lost << " more violations counted without a stack\n";
+    return report;
+}
+
+// ------------------- Hooks -------------------
+void* operator new(std::size_t size)
+{
+    RealtimeChecker::recordViolation(RealtimeChecker::allocation);
+    if(void* p = allocateUnchecked(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    RealtimeChecker::recordViolation(RealtimeChecker::allocation);
+    if(void* p = allocateUnchecked(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeChecker::recordViolation(RealtimeChecker::allocation);
+    return allocateUnchecked(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeChecker::recordViolation(RealtimeChecker::allocation);
+    return allocateUnchecked(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    if(p == nullptr) return;
+    RealtimeChecker::recordViolation(RealtimeChecker::deallocation);
+    freeUnchecked(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    if(p == nullptr) return;
+    RealtimeChecker::recordViolation(RealtimeChecker::deallocation);
+    freeUnchecked(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept   { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { operator delete[](p); }
+
+// Over-aligned types (alignas above the default) come through these
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    RealtimeChecker::recordViolation(RealtimeChecker::allocation);
+    if(void* p = allocateAlignedUnchecked(size, alignment)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    RealtimeChecker::recordViolation(RealtimeChecker::allocation);
+    if(void* p = allocateAlignedUnchecked(size, alignment)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    RealtimeChecker::recordViolation(RealtimeChecker::allocation);
+    return allocateAlignedUnchecked(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    RealtimeChecker::recordViolation(RealtimeChecker::allocation);
+    return allocateAlignedUnchecked(size, alignment);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    if(p == nullptr) return;
+    RealtimeChecker::recordViolation(RealtimeChecker::deallocation);
+    freeAlignedUnchecked(p);
+}
+
+void operator delete[](void* p, std::align_val_t alignment) noexcept { operator delete(p, alignment); }
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept   { operator delete(p, alignment); }
+void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept { operator delete(p, alignment); }
+void operator delete(void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept   { operator delete(p, alignment); }
+void operator delete[](void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept { operator delete(p, alignment); }
+
+#if JUCE_WINDOWS && defined(_DEBUG)
+// The debug CRT reports every heap operation, including plain malloc from C code
+namespace
+{
+    int crtAllocHook(int allocType, void*, size_t, int blockType, long, const unsigned char*, int)
+    {
+        if(blockType != _CRT_BLOCK) // the CRT's own bookkeeping
+            RealtimeChecker::recordViolation(allocType == _HOOK_FREE ? RealtimeChecker::deallocation : RealtimeChecker::allocation);
+        return TRUE;
+    }
+
+    const bool crtHookInstalled = (_CrtSetAllocHook(crtAllocHook), true);
+}
+#elif JUCE_LINUX
+// Symbols defined in the executable take precedence over libc's, so these see every call
+// from the app, JUCE and the shared libraries it loads; glibc's own entry points do the work.
+// glibc 2.34 made __pthread_mutex_lock a compat-only symbol, so the real pthread_mutex_lock is
+// looked up with dlsym instead, during static initialisation: long before any audio callback.
+namespace
+{
+    using MutexLockFunction = int (*)(pthread_mutex_t*);
+    std::atomic<MutexLockFunction> realMutexLock { nullptr };
+
+    MutexLockFunction resolveMutexLock()
+    {
+        auto function = reinterpret_cast<MutexLockFunction>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+        realMutexLock.store(function);
+        return function;
+    }
+
+    const bool mutexLockResolved = resolveMutexLock() != nullptr;
+}
+
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void __libc_free(void*);
+
+    void* malloc(size_t size)
+    {
+        RealtimeChecker::recordViolation(RealtimeChecker::allocation);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size)
+    {
+        RealtimeChecker::recordViolation(RealtimeChecker::allocation);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* p, size_t size)
+    {
+        RealtimeChecker::recordViolation(RealtimeChecker::allocation);
+        return __libc_realloc(p, size);
+    }
+
+    void free(void* p)
+    {
+        if(p != nullptr) RealtimeChecker::recordViolation(RealtimeChecker::deallocation);
+        __libc_free(p);
+    }
+
+    int pthread_mutex_lock(pthread_mutex_t* mutex)
+    {
+        RealtimeChecker::recordViolation(RealtimeChecker::lock);
+        // Locks taken by other static initialisers can arrive before ours has run
+        auto function = realMutexLock.load(std::memory_order_relaxed);
+        if(function == nullptr) function = resolveMutexLock();
+        return function(mutex);
+    }
+}
+#endif
+
+#else
+
+int RealtimeChecker::getCount(Kind) { return 0; }
+int RealtimeChecker::getTotalCount() { return 0; }
+int RealtimeChecker::getKnownLockCount(KnownLock) { return 0; }
+juce::String RealtimeChecker::getReport() { return {}; }
+void RealtimeChecker::reset() {}
+void RealtimeChecker::recordViolation(Kind) {}
+
+#endif
@@ -0,0 +1,83 @@
+#pragma once
+#include <JuceHeader.h>
+
+#ifndef SIMPLEAUDIOPLAYER_RT_CHECKS
+ #define SIMPLEAUDIOPLAYER_RT_CHECKS 0
+#endif
+
+// Finds allocations and locks on the audio thread. Enabled by configuring with
+// -DSIMPLEAUDIOPLAYER_RT_CHECKS=ON; otherwise everything here compiles to nothing.
+// - ScopedAudioCallback marks the calling thread as rendering audio for its lifetime.
+// - While a thread is marked, these are recorded as violations:
+//   - operator new and delete, on every platform;
+//   - malloc and free, through the debug CRT hook on Windows and by interposition on Linux;
+//   - pthread_mutex_lock on Linux, which is what CriticalSection and std::mutex end up calling.
+//   The aligned forms of new and delete count too.
+// - Every violation is counted. The first maxRecords also keep the stack they came from.
+// Recording never allocates or locks, so the hooks are safe to run on the audio thread.
+// getReport() symbolises the stacks, and must be called from another thread.
+class RealtimeChecker
+{
+public:
+    enum Kind { allocation, deallocation, lock, numKinds };
+
+    // Locks the player knows it takes on the audio thread, inside JUCE code it can't change.
+    // They are counted per site rather than as violations, so each one stays visible.
+    enum KnownLock
+    {
+        transportBlock, // AudioTransportSource's callback lock and BufferingAudioSource's range lock, once per block
+        transportSeek,  // the same two locks and the read-ahead thread's wake-up, when a seek lands
+        numKnownLocks
+    };
+    static constexpr int maxRecords = 64;
+
+    struct ScopedAudioCallback
+    {
+#if SIMPLEAUDIOPLAYER_RT_CHECKS
+        ScopedAudioCallback();
+        ~ScopedAudioCallback();
+#else
+        ScopedAudioCallback() {}
+#endif
+    };
+
+    // Lets known, accepted calls through without being recorded
+    struct ScopedPermit
+    {
+#if SIMPLEAUDIOPLAYER_RT_CHECKS
+        ScopedPermit();
+        ~ScopedPermit();
+#else
+        ScopedPermit() {}
+#endif
+    };
+
+    // Counts the locks taken in its scope against site instead of recording them; allocations
+    // are still violations. Keep the scope to the one JUCE call that takes the lock.
+    struct ScopedKnownLock
+    {
+#if SIMPLEAUDIOPLAYER_RT_CHECKS
+        explicit ScopedKnownLock(KnownLock site);
+        ~ScopedKnownLock();
+    private:
+        int previous;
+#else
+        explicit ScopedKnownLock(KnownLock) {}
+#endif
+    };
+
+    static bool isEnabled() { return SIMPLEAUDIOPLAYER_RT_CHECKS != 0; }
+    static int getCount(Kind kind);
+    static int getTotalCount();
+    static int getKnownLockCount(KnownLock site);
+    static const char* getKnownLockName(KnownLock site);
+
+    // Stacks of the violations recorded since the previous call, one block per violation
+    static juce::String getReport();
+
+    // Clears counts and records; only while no audio callback is running
+    static void reset();
+
+    // Called by the hooks
+    static void recordViolation(Kind kind);
+};
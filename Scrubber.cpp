@@ -0,0 +1,182 @@
+#include "Scrubber.h"
+#include <cmath>
+#include <limits>
+
+Scrubber::Scrubber(ReaderOpener openerToUse) : opener(std::move(openerToUse))
+{
+}
+
+Scrubber::~Scrubber()
+{
+    jobs->cancelAndWait();
+}
+
+// ------------------- Message thread -------------------
+void Scrubber::setFile(const juce::File& file)
+{
+    auto next = std::make_shared<Source>();
+    next->file = file;
+
+    // A decode still running for the old file finishes, but its window is dropped
+    std::unique_ptr<Window> old;
+    {
+        const juce::SpinLock::ScopedLockType sl(lock);
+        source = std::move(next);
+        old = std::move(window);
+    }
+    coveredFrom.store(0.0);
+    coveredTo.store(-1.0);
+}
+
+void Scrubber::begin(double seconds)
+{
+    targetSeconds.store(seconds);
+    active.store(true);
+    requestWindow();
+}
+
+void Scrubber::moveTo(double seconds)
+{
+    targetSeconds.store(seconds);
+    if(!isCovered(seconds)) requestWindow();
+}
+
+double Scrubber::end()
+{
+    active.store(false);
+    return targetSeconds.load();
+}
+
+// ------------------- Decoding -------------------
+// Re-decode before the target gets close to the edge, so a steady drag never runs out
+bool Scrubber::isCovered(double seconds) const
+{
+    const double margin = windowSeconds * 0.25;
+    return seconds >= coveredFrom.load() + margin && seconds <= coveredTo.load() - margin;
+}
+
+// At most one decode runs; when it finishes it looks at the newest target again,
+// so however fast the slider moves, only the latest position is ever decoded
+void Scrubber::requestWindow()
+{
+    if(decodeInFlight.exchange(true)) return;
+
+    scheduler->submit(JobScheduler::currentTrack, jobs, [this](const JobScheduler::Group& group)
+    {
+        for(;;)
+        {
+            std::shared_ptr<Source> src;
+            {
+                const juce::SpinLock::ScopedLockType sl(lock);
+                src = source;
+            }
+
+            const double target = targetSeconds.load();
+            const bool decoded = src != nullptr && (isCovered(target) || decodeAround(src, target));
+
+            decodeInFlight.store(false);
+            if(!decoded || group.isCancelled() || !active.load() || isCovered(targetSeconds.load()) || decodeInFlight.exchange(true))
+                return;
+        }
+    });
+}
+
+bool Scrubber::decodeAround(const std::shared_ptr<Source>& src, double seconds)
+{
+    if(src->reader == nullptr)
+        src->reader = opener(src->file);
+    auto* reader = src->reader.get();
+    if(reader == nullptr || reader->sampleRate <= 0.0) return false;
+
+    const double rate = reader->sampleRate;
+    const auto start = juce::jlimit((juce::int64)0, juce::jmax((juce::int64)0, reader->lengthInSamples - 1),
+                                    juce::roundToInt64((seconds - windowSeconds * 0.5) * rate));
+    const auto length = (int)juce::jmin(juce::roundToInt64(windowSeconds * rate), reader->lengthInSamples - start);
+    if(length <= 0) return false;
+
+    auto fresh = std::make_unique<Window>();
+    fresh->samples.setSize((int)reader->numChannels, length);
+    reader->read(&fresh->samples, 0, length, start, true, true);
+    fresh->start = start;
+    fresh->sampleRate = rate;
+
+    // The old window is freed here rather than on the audio thread
+    {
+        const juce::SpinLock::ScopedLockType sl(lock);
+        if(source != src) return false;
+        std::swap(window, fresh);
+    }
+
+    // A window that reaches either end of the file covers everything past that end
+    const double unbounded = std::numeric_limits<double>::max();
+    coveredFrom.store(start == 0 ? -unbounded : (double)start / rate);
+    coveredTo.store(start + length >= reader->lengthInSamples ? unbounded : (double)(start + length) / rate);
+    return true;
+}
+
+// ------------------- Audio thread -------------------
+void Scrubber::prepare(double outputSampleRate)
+{
+    outputRate = outputSampleRate > 0.0 ? outputSampleRate : 44100.0;
+}
+
+float Scrubber::readGrain(const Grain& grain, const Window& w, int channel, int grainLength) const
+{
+    const int length = w.samples.getNumSamples();
+    const auto index = (int)std::floor(grain.position);
+    if(index < 0 || index + 1 >= length) return 0.0f;
+
+    const auto* data = w.samples.getReadPointer(channel);
+    const auto frac = (float)(grain.position - index);
+    const float sample = data[index] + frac * (data[index + 1] - data[index]);
+
+    const float hann = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * (float)grain.age / (float)grainLength);
+    return sample * hann;
+}
+
+void Scrubber::render(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    bufferToFill.clearActiveBufferRegion();
+
+    const juce::SpinLock::ScopedTryLockType sl(lock);
+    if(!sl.isLocked() || window == nullptr) return;
+
+    const auto& w = *window;
+    const int numChannels = bufferToFill.buffer->getNumChannels();
+    const int sourceChannels = w.samples.getNumChannels();
+    if(sourceChannels == 0) return;
+
+    const double step = w.sampleRate / outputRate;
+    const int grainLength = juce::jmax(2, (int)(grainSeconds * outputRate));
+    const int hop = grainLength / 2;
+
+    for(int i = 0; i < bufferToFill.numSamples; ++i)
+    {
+        // Every half grain a new one starts at the target; a cursor that stays put fades to silence
+        if(--samplesToNextGrain <= 0)
+        {
+            previous = current;
+            const double target = targetSeconds.load();
+            current.live = target != lastGrainTarget;
+            current.position = target * w.sampleRate - (double)w.start;
+            current.age = 0;
+            lastGrainTarget = target;
+            samplesToNextGrain = hop;
+        }
+
+        for(int ch = 0; ch < numChannels; ++ch)
+        {
+            const int sourceChannel = juce::jmin(ch, sourceChannels - 1);
+            float out = 0.0f;
+            if(current.live) out += readGrain(current, w, sourceChannel, grainLength);
+            if(previous.live && previous.age < grainLength) out += readGrain(previous, w, sourceChannel, grainLength);
+            bufferToFill.buffer->setSample(ch, bufferToFill.startSample + i, out);
+        }
+
+        for(auto* g : { &current, &previous })
+        {
+            g->position += step;
+            ++g->age;
+        }
+    }
+}
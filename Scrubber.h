@@ -0,0 +1,84 @@
+#pragma once
+#include <JuceHeader.h>
+#include "JobScheduler.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Audible scrubbing while the position slider is dragged.
+// - The GUI only stores the latest target; intermediate drag positions are never seeked to.
+// - A background job decodes a short window of audio around the target with its own
+//   reader, so the playing reader is left alone and nothing is decoded on the audio thread.
+// - The audio thread plays short Hann-windowed grains from that window at the target,
+//   overlapped by half so each grain crossfades into the next.
+class Scrubber
+{
+public:
+    using ReaderOpener = std::function<std::unique_ptr<juce::AudioFormatReader>(const juce::File&)>;
+
+    explicit Scrubber(ReaderOpener openerToUse);
+    ~Scrubber();
+
+    // Message thread
+    void setFile(const juce::File& file);
+    void begin(double seconds);
+    void moveTo(double seconds);
+    double end(); // returns the last target
+
+    bool isActive() const { return active.load(); }
+
+    // Audio thread
+    void prepare(double outputSampleRate);
+    void render(const juce::AudioSourceChannelInfo& bufferToFill);
+
+    static constexpr double windowSeconds = 1.5;
+    static constexpr double grainSeconds = 0.04;
+
+private:
+    struct Source
+    {
+        juce::File file;
+        std::unique_ptr<juce::AudioFormatReader> reader; // only touched by the decode job
+    };
+
+    struct Window
+    {
+        juce::AudioBuffer<float> samples;
+        juce::int64 start = 0;
+        double sampleRate = 0.0;
+    };
+
+    struct Grain
+    {
+        double position = 0.0; // in window samples
+        int age = 0;
+        bool live = false;
+    };
+
+    ReaderOpener opener;
+    juce::SharedResourcePointer<JobScheduler> scheduler;
+    JobScheduler::GroupPtr jobs = JobScheduler::createGroup();
+
+    std::atomic<bool> active { false };
+    std::atomic<double> targetSeconds { 0.0 };
+    std::atomic<bool> decodeInFlight { false };
+    std::atomic<double> coveredFrom { 0.0 }, coveredTo { -1.0 };
+
+    // Guards source and window; the audio thread only ever try-locks it
+    juce::SpinLock lock;
+    std::shared_ptr<Source> source;
+    std::unique_ptr<Window> window;
+
+    // Audio thread state
+    double outputRate = 44100.0;
+    Grain current, previous;
+    double lastGrainTarget = -1.0;
+    int samplesToNextGrain = 0;
+
+    bool isCovered(double seconds) const;
+    void requestWindow();
+    bool decodeAround(const std::shared_ptr<Source>& src, double seconds);
+    float readGrain(const Grain& grain, const Window& w, int channel, int grainLength) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Scrubber)
+};
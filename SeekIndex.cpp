@@ -0,0 +1,309 @@
+#include "SeekIndex.h"
+#include "Tracer.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+    struct FrameInfo
+    {
+        int length = 0;
+        int samples = 0;
+        int sideInfoSize = 0;
+    };
+
+    // MPEG-1/2/2.5 layer I-III frame header; false for anything that isn't one
+    bool parseFrameHeader(const juce::uint8* p, FrameInfo& info)
+    {
+        if(p[0] != 0xff || (p[1] & 0xe0) != 0xe0) return false;
+
+        const int version = (p[1] >> 3) & 3; // 0 = 2.5, 2 = 2, 3 = 1
+        const int layer = 4 - ((p[1] >> 1) & 3);
+        const int bitrateIndex = p[2] >> 4;
+        const int rateIndex = (p[2] >> 2) & 3;
+        if(version == 1 || layer == 4 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3) return false;
+
+        static const int bitrates[5][15] = {
+            { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 }, // v1 L1
+            { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },    // v1 L2
+            { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },     // v1 L3
+            { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },    // v2 L1
+            { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 }          // v2 L2/L3
+        };
+        static const int sampleRates[3] = { 44100, 48000, 32000 };
+
+        const bool mpeg1 = version == 3;
+        const bool mono = (p[3] >> 6) == 3;
+        const int padding = (p[2] >> 1) & 1;
+        const int bitrate = 1000 * bitrates[mpeg1 ? layer - 1 : (layer == 1 ? 3 : 4)][bitrateIndex];
+        const int sampleRate = sampleRates[rateIndex] >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+
+        if(layer == 1)
+        {
+            info.length = (12 * bitrate / sampleRate + padding) * 4;
+            info.samples = 384;
+        }
+        else
+        {
+            const bool half = layer == 3 && !mpeg1;
+            info.length = (half ? 72 : 144) * bitrate / sampleRate + padding;
+            info.samples = half ? 576 : 1152;
+        }
+        info.sideInfoSize = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+        return info.length > 4;
+    }
+
+    // Xing/Info/VBRI frames carry no audio; decoders skip them, so the index does too
+    bool isVbrHeaderFrame(const juce::uint8* p, const FrameInfo& info)
+    {
+        auto matches = [&](int offset, const char* tag) { return offset + 4 <= info.length && std::memcmp(p + offset, tag, 4) == 0; };
+        return matches(4 + info.sideInfoSize, "Xing") || matches(4 + info.sideInfoSize, "Info") || matches(36, "VBRI");
+    }
+
+    constexpr int cacheMagic = 0x58444953; // "SIDX"
+    constexpr int cacheVersion = 1;
+}
+
+// ------------------- Building -------------------
+std::unique_ptr<SeekIndex> SeekIndex::build(const juce::File& file, const JobScheduler::Group& group)
+{
+    const Tracer::Span span("buildSeekIndex", "decode");
+    juce::MemoryMappedFile mapped(file, juce::MemoryMappedFile::readOnly);
+    auto* data = static_cast<const juce::uint8*>(mapped.getData());
+    const auto size = (juce::int64)mapped.getSize();
+    if(data == nullptr || size < 4) return nullptr;
+
+    juce::int64 pos = 0;
+    if(size >= 10 && std::memcmp(data, "ID3", 3) == 0)
+        pos = 10 + (((data[6] & 0x7f) << 21) | ((data[7] & 0x7f) << 14) | ((data[8] & 0x7f) << 7) | (data[9] & 0x7f))
+                 + ((data[5] & 0x10) != 0 ? 10 : 0);
+
+    auto index = std::make_unique<SeekIndex>();
+    juce::int64 sample = 0;
+    int frameCount = 0;
+    bool firstFrame = true;
+
+    while(pos + 4 <= size)
+    {
+        FrameInfo info, next;
+        const bool valid = parseFrameHeader(data + pos, info) && pos + info.length <= size;
+
+        // A lone 0xFFE pattern inside junk is not a frame unless another header follows it
+        const auto nextPos = pos + info.length;
+        if(!valid || (nextPos + 4 <= size && !parseFrameHeader(data + nextPos, next) && std::memcmp(data + nextPos, "TAG", 3) != 0))
+        {
+            if(size - pos >= 3 && std::memcmp(data + pos, "TAG", 3) == 0) break; // ID3v1 at the end
+            ++pos;
+            continue;
+        }
+
+        if(std::exchange(firstFrame, false) && isVbrHeaderFrame(data + pos, info))
+        {
+            pos = nextPos;
+            continue;
+        }
+
+        if(frameCount % framesPerCheckpoint == 0)
+        {
+            if(group.isCancelled()) return nullptr;
+            index->checkpoints.push_back({ sample, pos });
+        }
+
+        ++frameCount;
+        sample += info.samples;
+        pos = nextPos;
+    }
+
+    if(index->checkpoints.empty()) return nullptr;
+    index->totalSamples = sample;
+    return index;
+}
+
+// ------------------- Lookup -------------------
+int SeekIndex::findCheckpointIndex(juce::int64 sample) const
+{
+    auto it = std::upper_bound(checkpoints.begin(), checkpoints.end(), sample,
+                               [](juce::int64 s, const Checkpoint& c) { return s < c.sample; });
+    return juce::jmax(0, (int)(it - checkpoints.begin()) - 1);
+}
+
+const SeekIndex::Checkpoint& SeekIndex::findCheckpoint(juce::int64 sample) const
+{
+    return checkpoints[(size_t)findCheckpointIndex(sample)];
+}
+
+// ------------------- Disk cache -------------------
+juce::File SeekIndex::getCacheFileFor(const juce::File& file)
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+               .getChildFile("SimpleAudioPlayer").getChildFile("seek-index")
+               .getChildFile(juce::String::toHexString(file.getFullPathName().hashCode64()) + ".idx");
+}
+
+std::unique_ptr<SeekIndex> SeekIndex::loadCached(const juce::File& file)
+{
+    juce::FileInputStream in(getCacheFileFor(file));
+    if(!in.openedOk()) return nullptr;
+
+    // A file that changed since it was indexed is indexed again
+    if(in.readInt() != cacheMagic || in.readInt() != cacheVersion
+       || in.readInt64() != file.getSize() || in.readInt64() != file.getLastModificationTime().toMilliseconds())
+        return nullptr;
+
+    auto index = std::make_unique<SeekIndex>();
+    index->totalSamples = in.readInt64();
+    const int count = in.readInt();
+    if(count <= 0 || (juce::int64)count * 16 > in.getNumBytesRemaining()) return nullptr;
+
+    index->checkpoints.resize((size_t)count);
+    for(auto& c : index->checkpoints)
+    {
+        c.sample = in.readInt64();
+        c.byteOffset = in.readInt64();
+    }
+    return index;
+}
+
+void SeekIndex::saveToCache(const juce::File& file) const
+{
+    auto target = getCacheFileFor(file);
+    target.getParentDirectory().createDirectory();
+
+    juce::TemporaryFile temp(target);
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if(!out.openedOk()) return;
+
+        out.writeInt(cacheMagic);
+        out.writeInt(cacheVersion);
+        out.writeInt64(file.getSize());
+        out.writeInt64(file.getLastModificationTime().toMilliseconds());
+        out.writeInt64(totalSamples);
+        out.writeInt((int)checkpoints.size());
+        for(auto& c : checkpoints)
+        {
+            out.writeInt64(c.sample);
+            out.writeInt64(c.byteOffset);
+        }
+    }
+    temp.overwriteTargetFileWithTemporary();
+}
+
+// ------------------- Registry -------------------
+std::shared_ptr<SeekIndexRegistry::Entry> SeekIndexRegistry::get(const juce::File& file)
+{
+    const juce::ScopedLock sl(lock);
+    for(auto it = entries.begin(); it != entries.end();)
+        it = it->second.expired() ? entries.erase(it) : std::next(it);
+
+    auto& slot = entries[file.getFullPathName()];
+    if(auto existing = slot.lock()) return existing;
+
+    auto entry = std::make_shared<Entry>();
+    slot = entry;
+
+    juce::SharedResourcePointer<Metrics> metrics;
+    auto cached = SeekIndex::loadCached(file);
+    metrics->getCounter("player_cache_lookups_total", "Cache lookups by cache and result",
+                        cached != nullptr ? "cache=\"seek_index\",result=\"hit\"" : "cache=\"seek_index\",result=\"miss\"").add(1.0);
+    if(cached != nullptr)
+    {
+        entry->owner = std::move(cached);
+        entry->index.store(entry->owner.get());
+        return entry;
+    }
+
+    // Scanning a long file reads all of it, so it waits behind anything the current track needs.
+    // The job only holds a weak reference: readers closing the file cancel it.
+    std::weak_ptr<Entry> target = entry;
+    scheduler->submit(JobScheduler::background, entry->buildJob, [target, file](const JobScheduler::Group& group)
+    {
+        auto built = SeekIndex::build(file, group);
+        if(built == nullptr) return;
+        built->saveToCache(file);
+        if(auto e = target.lock())
+        {
+            e->owner = std::move(built);
+            e->index.store(e->owner.get());
+        }
+    });
+    return entry;
+}
+
+// ------------------- Indexed reader -------------------
+IndexedMp3Reader::IndexedMp3Reader(const juce::File& fileToRead, juce::AudioFormat& mp3Format,
+                                   std::unique_ptr<juce::AudioFormatReader> plainReader)
+    : juce::AudioFormatReader(nullptr, plainReader->getFormatName()), file(fileToRead), format(mp3Format), inner(std::move(plainReader))
+{
+    sampleRate = inner->sampleRate;
+    bitsPerSample = inner->bitsPerSample;
+    lengthInSamples = inner->lengthInSamples;
+    numChannels = inner->numChannels;
+    usesFloatingPointData = inner->usesFloatingPointData;
+    metadataValues = inner->metadataValues;
+
+    mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    if(mapped->getData() == nullptr) mapped.reset();
+    indexEntry = registry->get(file);
+}
+
+IndexedMp3Reader::~IndexedMp3Reader() = default;
+
+bool IndexedMp3Reader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                                   juce::int64 startSampleInFile, int numSamples)
+{
+    auto* index = indexEntry->index.load();
+    if(startSampleInFile != nextSample && index != nullptr)
+    {
+        auto distance = startSampleInFile - nextSample;
+        if(distance < 0 || distance > (juce::int64)(sampleRate * farSeekSeconds))
+            if(!repositionNear(*index, startSampleInFile) && innerStartSample > startSampleInFile)
+                reopenPlain();
+    }
+    nextSample = startSampleInFile + numSamples;
+
+    if(inner == nullptr || startSampleInFile < innerStartSample)
+    {
+        for(int ch = 0; ch < numDestChannels; ++ch)
+            if(destChannels[ch] != nullptr)
+                juce::zeromem(destChannels[ch] + startOffsetInDestBuffer, sizeof(int) * (size_t)numSamples);
+        return false;
+    }
+    return inner->readSamples(destChannels, numDestChannels, startOffsetInDestBuffer, startSampleInFile - innerStartSample, numSamples);
+}
+
+bool IndexedMp3Reader::repositionNear(const SeekIndex& index, juce::int64 targetSample)
+{
+    const Tracer::Span span("mp3Reposition", "decode");
+    auto& checkpoint = index[juce::jmax(0, index.findCheckpointIndex(targetSample) - prerollCheckpoints)];
+
+    // The decoder sees a stream that starts on a frame boundary and seeks inside it as usual,
+    // but its own header scan now only covers the few frames up to the target
+    auto reader = createDecoderAt(checkpoint.byteOffset);
+    if(reader == nullptr) return false;
+
+    inner = std::move(reader);
+    innerStartSample = checkpoint.sample;
+    return true;
+}
+
+bool IndexedMp3Reader::reopenPlain()
+{
+    auto reader = createDecoderAt(0);
+    if(reader == nullptr) return false;
+
+    inner = std::move(reader);
+    innerStartSample = 0;
+    return true;
+}
+
+std::unique_ptr<juce::AudioFormatReader> IndexedMp3Reader::createDecoderAt(juce::int64 byteOffset)
+{
+    if(mapped == nullptr || byteOffset >= (juce::int64)mapped->getSize()) return nullptr;
+
+    auto* start = static_cast<const char*>(mapped->getData()) + byteOffset;
+    auto* stream = new juce::MemoryInputStream(start, (size_t)((juce::int64)mapped->getSize() - byteOffset), false);
+    return std::unique_ptr<juce::AudioFormatReader>(format.createReaderFor(stream, true));
+}
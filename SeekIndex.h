@@ -0,0 +1,102 @@
+#pragma once
+#include <JuceHeader.h>
+#include "JobScheduler.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Sample -> byte offset table for an MPEG audio file, one checkpoint every few frames.
+// Built once by walking the frame headers (no decoding) and kept on disk next to the
+// other caches, so a long VBR MP3 is only scanned the first time it is opened.
+class SeekIndex
+{
+public:
+    struct Checkpoint
+    {
+        juce::int64 sample = 0;
+        juce::int64 byteOffset = 0;
+    };
+
+    static constexpr int framesPerCheckpoint = 8;
+
+    static std::unique_ptr<SeekIndex> build(const juce::File& file, const JobScheduler::Group& group);
+    static std::unique_ptr<SeekIndex> loadCached(const juce::File& file);
+    void saveToCache(const juce::File& file) const;
+
+    // Last checkpoint at or before sample (binary search)
+    const Checkpoint& findCheckpoint(juce::int64 sample) const;
+    int findCheckpointIndex(juce::int64 sample) const;
+    const Checkpoint& operator[](int index) const { return checkpoints[(size_t)index]; }
+    int size() const { return (int)checkpoints.size(); }
+    juce::int64 getTotalSamples() const { return totalSamples; }
+
+private:
+    std::vector<Checkpoint> checkpoints;
+    juce::int64 totalSamples = 0;
+
+    static juce::File getCacheFileFor(const juce::File& file);
+};
+
+// One index per file for every reader that has it open, e.g. the playing deck and the
+// scrubber. The first reader loads it from the disk cache or starts the background build;
+// the others share that. Shared through juce::SharedResourcePointer; thread-safe.
+class SeekIndexRegistry
+{
+public:
+    struct Entry
+    {
+        ~Entry() { buildJob->cancel(); } // the last reader has gone; the job holds no reference
+        std::atomic<const SeekIndex*> index { nullptr }; // null until loaded or built
+        std::unique_ptr<SeekIndex> owner;
+        JobScheduler::GroupPtr buildJob = JobScheduler::createGroup();
+    };
+
+    std::shared_ptr<Entry> get(const juce::File& file);
+
+private:
+    juce::CriticalSection lock;
+    std::map<juce::String, std::weak_ptr<Entry>> entries;
+    juce::SharedResourcePointer<JobScheduler> scheduler;
+};
+
+// Wraps JUCE's MP3 reader. Sequential reads go straight through; a far seek starts a
+// decoder a couple of checkpoints before the target and lets it decode forward, so seek
+// cost no longer grows with the position in the file. The file is mapped into memory once,
+// so a seek never opens it again: the new decoder reads the mapping from the checkpoint on.
+// Until the index is ready (it is built in the background) the plain reader is used.
+class IndexedMp3Reader : public juce::AudioFormatReader
+{
+public:
+    IndexedMp3Reader(const juce::File& file, juce::AudioFormat& mp3Format, std::unique_ptr<juce::AudioFormatReader> plainReader);
+    ~IndexedMp3Reader() override;
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                     juce::int64 startSampleInFile, int numSamples) override;
+
+    bool hasIndex() const { return indexEntry->index.load() != nullptr; }
+
+private:
+    juce::File file;
+    juce::AudioFormat& format;
+    std::unique_ptr<juce::MemoryMappedFile> mapped;
+
+    std::unique_ptr<juce::AudioFormatReader> inner;
+    juce::int64 innerStartSample = 0; // file sample that inner's sample 0 corresponds to
+    juce::int64 nextSample = 0;       // where a sequential read would continue
+
+    juce::SharedResourcePointer<SeekIndexRegistry> registry;
+    std::shared_ptr<SeekIndexRegistry::Entry> indexEntry;
+
+    // Closer forward jumps are left to the open decoder; everything else goes through the index
+    static constexpr double farSeekSeconds = 2.0;
+    // Extra checkpoints opened before the target so the bit reservoir is filled again
+    static constexpr int prerollCheckpoints = 1;
+
+    bool repositionNear(const SeekIndex& index, juce::int64 targetSample);
+    bool reopenPlain();
+    // A decoder over the mapped file from byteOffset on; null if the mapping failed
+    std::unique_ptr<juce::AudioFormatReader> createDecoderAt(juce::int64 byteOffset);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(IndexedMp3Reader)
+};
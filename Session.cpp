@@ -0,0 +1,68 @@
+#include "Session.h"
+#include <cmath>
+
+juce::String Session::toJson() const
+{
+    auto* state = new juce::DynamicObject();
+    juce::var sessionVar(state);
+    if(lastFile != juce::File())
+    {
+        state->setProperty("lastFile", lastFile.getFullPathName());
+        state->setProperty("position", position);
+    }
+    state->setProperty("crossfade", crossfade);
+    juce::Array<juce::var> gains;
+    for(auto gain : eqGains) gains.add(gain);
+    state->setProperty("eq", gains);
+
+    // User markers only; chapter markers are rebuilt from the files themselves
+    juce::Array<juce::var> markerFiles;
+    for(auto& [path, store] : markers)
+    {
+        auto saved = store.toVar();
+        if(saved.size() == 0) continue;
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty("file", path);
+        entry->setProperty("markers", saved);
+        markerFiles.add(juce::var(entry));
+    }
+    state->setProperty("markers", markerFiles);
+
+    return juce::JSON::toString(sessionVar, true);
+}
+
+Session Session::parse(const juce::String& json)
+{
+    Session session;
+    auto sessionVar = juce::JSON::parse(json);
+    auto* obj = sessionVar.getDynamicObject();
+    if(obj == nullptr) return session;
+
+    auto finiteOr = [](const juce::var& v, double fallback)
+    {
+        const double d = v.isDouble() || v.isInt() || v.isInt64() ? (double)v : fallback;
+        return std::isfinite(d) ? d : fallback;
+    };
+
+    // juce::File asserts on relative paths, and nothing else could have come from saveSession
+    auto lastFile = obj->getProperty("lastFile").toString();
+    if(juce::File::isAbsolutePath(lastFile))
+    {
+        session.lastFile = juce::File(lastFile);
+        session.position = juce::jmax(0.0, finiteOr(obj->getProperty("position"), 0.0));
+    }
+    session.crossfade = finiteOr(obj->getProperty("crossfade"), 0.0);
+
+    if(auto* gains = obj->getProperty("eq").getArray())
+        for(auto& gain : *gains)
+            session.eqGains.push_back(finiteOr(gain, 0.0));
+
+    if(auto* markerFiles = obj->getProperty("markers").getArray())
+        for(auto& entry : *markerFiles)
+        {
+            auto path = entry.getProperty("file", {}).toString();
+            if(path.isNotEmpty()) session.markers[path].fromVar(entry.getProperty("markers", {}));
+        }
+
+    return session;
+}
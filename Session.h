@@ -0,0 +1,20 @@
+#pragma once
+#include <JuceHeader.h>
+#include "MarkerStore.h"
+#include <map>
+#include <vector>
+
+// What the player remembers between runs: last track and position, crossfade, EQ gains
+// and user markers per file. Parsing is a pure function of the text: the session file is
+// read back from the user's disk, so anything malformed is dropped rather than trusted.
+struct Session
+{
+    juce::File lastFile;       // default File if none was saved or the path was not absolute
+    double position = 0.0;
+    double crossfade = 0.0;
+    std::vector<double> eqGains;
+    std::map<juce::String, MarkerStore> markers; // keyed by full path of the audio file
+
+    juce::String toJson() const;
+    static Session parse(const juce::String& json);
+};
@@ -0,0 +1,135 @@
+#include "SpectrumAnalyser.h"
+#include <algorithm>
+#include <cmath>
+
+SpectrumAnalyser::SpectrumAnalyser()
+    : juce::Thread("Spectrum analyser")
+{
+    sampleRing.assign((size_t)ringSize, 0.0f);
+    columns.resize((size_t)maxColumns);
+    frame.assign((size_t)fftSize, 0.0f);
+    fftData.assign((size_t)fftSize * 2, 0.0f);
+
+    // Black through blue and orange to white, in ARGB so columns copy straight into an image
+    juce::ColourGradient map(juce::Colours::black, 0.0f, 0.0f, juce::Colours::white, 1.0f, 0.0f, false);
+    map.addColour(0.35, juce::Colour(0xff1a237e));
+    map.addColour(0.65, juce::Colours::orange);
+    for(size_t i = 0; i < palette.size(); ++i)
+        palette[i] = map.getColourAtPosition((double)i / (double)(palette.size() - 1)).getARGB();
+
+    startThread(juce::Thread::Priority::low);
+}
+
+SpectrumAnalyser::~SpectrumAnalyser()
+{
+    stopThread(2000);
+}
+
+void SpectrumAnalyser::prepare(double newSampleRate)
+{
+    if(newSampleRate > 0.0)
+        sampleRate.store(newSampleRate);
+}
+
+float SpectrumAnalyser::getBandFrequency(int band)
+{
+    // Lower edge of the band; band numBands is the top edge of the last one
+    return 20.0f * std::pow(1000.0f, (float)band / (float)numBands);
+}
+
+// ------------------- Audio thread -------------------
+void SpectrumAnalyser::push(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if(bufferToFill.buffer == nullptr || bufferToFill.numSamples <= 0) return;
+    const int numChannels = bufferToFill.buffer->getNumChannels();
+    if(numChannels == 0) return;
+
+    // If the worker has fallen behind the newest audio is dropped, never waited for
+    const int toWrite = juce::jmin(bufferToFill.numSamples, sampleFifo.getFreeSpace());
+    const float scale = 1.0f / (float)numChannels;
+    auto write = sampleFifo.write(toWrite);
+
+    auto downmix = [&](int ringStart, int count, int offset)
+    {
+        if(count <= 0) return;
+        float* dest = sampleRing.data() + ringStart;
+        const int source = bufferToFill.startSample + offset;
+        juce::FloatVectorOperations::copyWithMultiply(dest, bufferToFill.buffer->getReadPointer(0, source), scale, count);
+        for(int ch = 1; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::addWithMultiply(dest, bufferToFill.buffer->getReadPointer(ch, source), scale, count);
+    };
+    downmix(write.startIndex1, write.blockSize1, 0);
+    downmix(write.startIndex2, write.blockSize2, write.blockSize1);
+}
+
+// ------------------- Message thread -------------------
+int SpectrumAnalyser::popColumns(Column* destination, int maxToRead)
+{
+    auto read = columnFifo.read(juce::jmin(maxToRead, columnFifo.getNumReady()));
+    int copied = 0;
+    for(int i = 0; i < read.blockSize1; ++i) destination[copied++] = columns[(size_t)(read.startIndex1 + i)];
+    for(int i = 0; i < read.blockSize2; ++i) destination[copied++] = columns[(size_t)(read.startIndex2 + i)];
+    return copied;
+}
+
+// ------------------- Worker -------------------
+void SpectrumAnalyser::run()
+{
+    while(!threadShouldExit())
+    {
+        if(sampleFifo.getNumReady() < hopSize)
+        {
+            wait(5);
+            continue;
+        }
+
+        // Slide the analysis frame along by one hop
+        std::copy(frame.begin() + hopSize, frame.end(), frame.begin());
+        {
+            auto read = sampleFifo.read(hopSize);
+            float* dest = frame.data() + fftSize - hopSize;
+            std::copy_n(sampleRing.data() + read.startIndex1, read.blockSize1, dest);
+            std::copy_n(sampleRing.data() + read.startIndex2, read.blockSize2, dest + read.blockSize1);
+        }
+
+        analyseFrame();
+    }
+}
+
+void SpectrumAnalyser::computeBandEdges(double rate)
+{
+    edgesSampleRate = rate;
+    const double binWidth = rate / fftSize;
+    for(int band = 0; band <= numBands; ++band)
+        bandEdges[(size_t)band] = juce::jlimit(1, fftSize / 2, (int)std::lround(getBandFrequency(band) / binWidth));
+}
+
+void SpectrumAnalyser::analyseFrame()
+{
+    const double rate = sampleRate.load();
+    if(rate != edgesSampleRate)
+        computeBandEdges(rate);
+
+    std::copy(frame.begin(), frame.end(), fftData.begin());
+    window.multiplyWithWindowingTable(fftData.data(), (size_t)fftSize);
+    fft.performFrequencyOnlyForwardTransform(fftData.data(), true);
+
+    if(columnFifo.getFreeSpace() == 0) return; // GUI not keeping up (or hidden)
+    auto write = columnFifo.write(1);
+    auto& column = columns[(size_t)(write.blockSize1 > 0 ? write.startIndex1 : write.startIndex2)];
+
+    // A full-scale sine through a Hann window peaks at fftSize / 4
+    const float normalise = 4.0f / (float)fftSize;
+    for(int band = 0; band < numBands; ++band)
+    {
+        // Low bands are narrower than one bin, so each band takes at least the bin it starts in
+        const int first = bandEdges[(size_t)band];
+        const int last = juce::jmax(first + 1, bandEdges[(size_t)band + 1]);
+        const float magnitude = *std::max_element(fftData.begin() + first, fftData.begin() + juce::jmin(last, fftSize / 2 + 1));
+        const float db = juce::Decibels::gainToDecibels(magnitude * normalise, minDb);
+        const float level = juce::jlimit(0.0f, 1.0f, (db - minDb) / (maxDb - minDb));
+
+        column.levels[(size_t)band] = level;
+        column.pixels[(size_t)band] = palette[(size_t)(level * (float)(palette.size() - 1))];
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <vector>
+
+// Feeds the spectrum and spectrogram display.
+// - The audio thread only downmixes its block into a lock-free sample ring.
+// - A worker thread takes hopSize samples at a time, windows the last fftSize of them,
+//   runs juce::dsp::FFT (which uses the platform's vectorised FFT where one is available)
+//   and folds the bins into numBands log-spaced bands from 20 Hz to 20 kHz.
+// - Each result is published as a Column: band levels for the analyser curve plus the
+//   spectrogram pixels for that column, already coloured, so the GUI only copies them.
+class SpectrumAnalyser : private juce::Thread
+{
+public:
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int hopSize = 512;
+    static constexpr int numBands = 128;
+    static constexpr float minDb = -90.0f;
+    static constexpr float maxDb = 0.0f;
+
+    struct Column
+    {
+        std::array<float, numBands> levels {};        // 0..1 across minDb..maxDb, lowest band first
+        std::array<juce::uint32, numBands> pixels {}; // ARGB, lowest band first
+    };
+
+    SpectrumAnalyser();
+    ~SpectrumAnalyser() override;
+
+    // Audio thread
+    void prepare(double sampleRate);
+    void push(const juce::AudioSourceChannelInfo& bufferToFill);
+
+    // Message thread: copies out up to maxColumns finished columns, oldest first
+    int popColumns(Column* destination, int maxColumns);
+
+    static float getBandFrequency(int band);
+
+private:
+    static constexpr int ringSize = 1 << 15;
+    static constexpr int maxColumns = 64;
+
+    juce::AbstractFifo sampleFifo { ringSize };
+    std::vector<float> sampleRing;
+    juce::AbstractFifo columnFifo { maxColumns };
+    std::vector<Column> columns;
+    std::atomic<double> sampleRate { 44100.0 };
+
+    // Worker state
+    juce::dsp::FFT fft { fftOrder };
+    juce::dsp::WindowingFunction<float> window { (size_t)fftSize, juce::dsp::WindowingFunction<float>::hann, false }; // unnormalised: coherent gain 0.5
+    std::vector<float> frame, fftData;
+    std::array<int, numBands + 1> bandEdges {};
+    double edgesSampleRate = 0.0;
+    std::array<juce::uint32, 256> palette {};
+
+    void run() override;
+    void analyseFrame();
+    void computeBandEdges(double rate);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumAnalyser)
+};
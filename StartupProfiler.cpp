@@ -0,0 +1,59 @@
+#include "StartupProfiler.h"
+
+juce::CriticalSection StartupProfiler::lock;
+juce::Array<StartupProfiler::Phase> StartupProfiler::phases;
+double StartupProfiler::startTimeMs = 0.0;
+bool StartupProfiler::firstFrameSeen = false;
+
+void StartupProfiler::begin()
+{
+    const juce::ScopedLock sl(lock);
+    phases.clear();
+    firstFrameSeen = false;
+    startTimeMs = juce::Time::getMillisecondCounterHiRes();
+}
+
+double StartupProfiler::getElapsedMs()
+{
+    return juce::Time::getMillisecondCounterHiRes() - startTimeMs;
+}
+
+void StartupProfiler::mark(const juce::String& phase)
+{
+    auto elapsed = getElapsedMs();
+    {
+        const juce::ScopedLock sl(lock);
+        phases.add({ phase, elapsed });
+    }
+    juce::Logger::writeToLog("[startup] " + phase + ": " + juce::String(elapsed, 1) + " ms");
+}
+
+void StartupProfiler::markFirstFrame()
+{
+    {
+        const juce::ScopedLock sl(lock);
+        if(firstFrameSeen) return;
+        firstFrameSeen = true;
+    }
+
+    mark("first frame");
+
+    auto elapsed = getElapsedMs();
+    if(elapsed > firstFrameBudgetMs)
+        juce::Logger::writeToLog("[startup] time-to-first-frame " + juce::String(elapsed, 1)
+                                 + " ms is over the " + juce::String(firstFrameBudgetMs, 0) + " ms budget");
+}
+
+juce::String StartupProfiler::getReport()
+{
+    const juce::ScopedLock sl(lock);
+    juce::String report;
+    double previous = 0.0;
+    for(auto& p : phases)
+    {
+        report << p.name << ": " << juce::String(p.elapsedMs, 1) << " ms (+"
+               << juce::String(p.elapsedMs - previous, 1) << ")\n";
+        previous = p.elapsedMs;
+    }
+    return report;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Records how long each startup phase takes, measured from application launch.
+// Phases can be marked from any thread; the report goes to the JUCE logger.
+class StartupProfiler
+{
+public:
+    // Time allowed between launch and the first painted frame.
+    static constexpr double firstFrameBudgetMs = 300.0;
+
+    static void begin();
+    static void mark(const juce::String& phase);
+    static void markFirstFrame();
+
+    static double getElapsedMs();
+    static juce::String getReport();
+
+private:
+    struct Phase
+    {
+        juce::String name;
+        double elapsedMs = 0.0;
+    };
+
+    static juce::CriticalSection lock;
+    static juce::Array<Phase> phases;
+    static double startTimeMs;
+    static bool firstFrameSeen;
+};
@@ -0,0 +1,133 @@
+#include <JuceHeader.h>
+#include "ClockBridge.h"
+#include <array>
+#include <cmath>
+
+// ClockBridge between two simulated device clocks: the writer's and the reader's callbacks
+// are interleaved at the times two real devices would call them, one of them off its
+// nominal rate. No hardware or real time is involved, so a minute of audio runs in moments.
+class ClockBridgeTests : public juce::UnitTest
+{
+public:
+    ClockBridgeTests() : juce::UnitTest("Clock bridge", "clock") {}
+
+    void runTest() override
+    {
+        struct Case { double writerRate; int writerBlock; double readerRate; int readerBlock; double readerErrorPpm; };
+        for(auto c : { Case { 48000.0, 512, 48000.0, 480, -100.0 },
+                       Case { 44100.0, 512, 48000.0, 256, 150.0 },
+                       Case { 48000.0, 480, 44100.0, 441, -500.0 } })
+        {
+            beginTest(juce::String(c.writerRate, 0) + " Hz into " + juce::String(c.readerRate, 0) + " Hz running "
+                      + juce::String(c.readerErrorPpm, 0) + " ppm off");
+
+            ClockBridge bridge;
+            auto result = simulate(bridge, c.writerRate, c.writerBlock, c.readerRate * (1.0 + c.readerErrorPpm * 1.0e-6),
+                                   c.readerRate, c.readerBlock, 60.0);
+            const auto stats = bridge.getStats();
+
+            // A reader running slow needs the ring drained faster: positive drift
+            expectWithinAbsoluteError(result.driftLow, -c.readerErrorPpm, 20.0);
+            expectWithinAbsoluteError(result.driftHigh, -c.readerErrorPpm, 20.0);
+            expectWithinAbsoluteError(result.meanBufferedMs, 40.0, 5.0);
+            expectEquals(stats.underruns, 0);
+            expectEquals(stats.overruns, 0);
+            expect(result.maxStep <= result.maxSineStep, "the output has a glitch of " + juce::String(result.maxStep));
+            expect(result.peak > 0.45f, "the output is missing the signal");
+        }
+
+        beginTest("A writer that stops leaves silence and an underrun");
+        {
+            ClockBridge bridge;
+            simulate(bridge, 48000.0, 512, 48000.0, 48000.0, 512, 2.0);
+            std::array<float, 512> left {}, right {};
+            float* outputs[] = { left.data(), right.data() };
+            for(int i = 0; i < 20; ++i)
+                bridge.read(outputs, 2, 512);
+            expectEquals(bridge.getStats().underruns, 1);
+            expectEquals(juce::FloatVectorOperations::findMaximum(left.data(), 512), 0.0f);
+        }
+
+        beginTest("A reader that stops costs the writer's blocks, not a wait");
+        {
+            ClockBridge bridge;
+            bridge.setInputRate(48000.0);
+            juce::AudioBuffer<float> block(1, 512);
+            block.clear();
+            for(int i = 0; i < 100; ++i)
+                bridge.write(juce::AudioSourceChannelInfo(&block, 0, 512));
+            expectGreaterThan(bridge.getStats().overruns, 0);
+        }
+    }
+
+private:
+    struct Result
+    {
+        double driftLow = 1.0e9, driftHigh = -1.0e9; // over the last ten seconds
+        double meanBufferedMs = 0.0;
+        float maxStep = 0.0f, maxSineStep = 0.0f, peak = 0.0f;
+    };
+
+    static constexpr double frequency = 1000.0;
+    static constexpr float amplitude = 0.5f;
+
+    // The reader's clock really runs at readerActualRate while the bridge is told readerRate
+    static Result simulate(ClockBridge& bridge, double writerRate, int writerBlock, double readerActualRate,
+                           double readerRate, int readerBlock, double seconds)
+    {
+        bridge.setInputRate(writerRate);
+        bridge.prepareOutput(readerRate, readerBlock);
+
+        juce::AudioBuffer<float> written(2, writerBlock), read(2, readerBlock);
+        Result result;
+        result.maxSineStep = 1.2f * amplitude * (float)(juce::MathConstants<double>::twoPi * frequency / readerRate);
+        double nextWrite = 0.0, nextRead = 0.0, phase = 0.0, bufferedSum = 0.0;
+        float previous = 0.0f;
+        int numMeasured = 0;
+        bool playing = false;
+
+        while(juce::jmin(nextWrite, nextRead) < seconds)
+        {
+            if(nextWrite <= nextRead)
+            {
+                for(int i = 0; i < writerBlock; ++i)
+                {
+                    const float sample = amplitude * (float)std::sin(phase);
+                    written.setSample(0, i, sample);
+                    written.setSample(1, i, sample);
+                    phase = std::fmod(phase + juce::MathConstants<double>::twoPi * frequency / writerRate, juce::MathConstants<double>::twoPi);
+                }
+                bridge.write(juce::AudioSourceChannelInfo(&written, 0, writerBlock));
+                nextWrite += writerBlock / writerRate;
+                continue;
+            }
+
+            bridge.read(read.getArrayOfWritePointers(), 2, readerBlock);
+            nextRead += readerBlock / readerActualRate;
+
+            // Silence while priming; after that every step must be one a sine could take
+            const float* samples = read.getReadPointer(0);
+            for(int i = 0; i < readerBlock; ++i)
+            {
+                if(playing) result.maxStep = juce::jmax(result.maxStep, std::abs(samples[i] - previous));
+                playing = playing || samples[i] != 0.0f;
+                previous = samples[i];
+            }
+
+            if(nextRead > seconds - 10.0)
+            {
+                const auto stats = bridge.getStats();
+                result.driftLow = juce::jmin(result.driftLow, stats.driftPpm);
+                result.driftHigh = juce::jmax(result.driftHigh, stats.driftPpm);
+                bufferedSum += stats.bufferedMs;
+                ++numMeasured;
+                result.peak = juce::jmax(result.peak, read.getMagnitude(0, 0, readerBlock));
+            }
+        }
+
+        result.meanBufferedMs = bufferedSum / juce::jmax(1, numMeasured);
+        return result;
+    }
+};
+
+static ClockBridgeTests clockBridgeTests;
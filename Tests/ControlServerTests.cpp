@@ -0,0 +1,241 @@
+#include "TestSignals.h"
+#include "ControlServer.h"
+#include <functional>
+#include <vector>
+
+// ControlServer against a PlayerAudio rendered by the test itself, which plays the audio
+// thread; update() stands in for the message thread. Covers:
+// - parsing;
+// - gain reaching the audio thread before the message thread has seen it;
+// - seek going through the Target and acknowledged once it is heard;
+// - acknowledgements with their latency;
+// - commands that go through the Target, including one it refuses;
+// - the state feed;
+// - the same commands and state over OSC.
+class ControlServerTests : public juce::UnitTest
+{
+public:
+    ControlServerTests() : juce::UnitTest("Control server", "control") {}
+
+    void runTest() override
+    {
+        using Command = ControlServer::Command;
+
+        beginTest("Parsing");
+        {
+            Command command;
+            juce::String error;
+            expect(ControlServer::parse("seek 12.5", command, error));
+            expect(command.type == Command::seek);
+            expectEquals(command.value, 12.5);
+            expect(ControlServer::parse("  GAIN 2 ", command, error));
+            expectEquals(command.value, 1.0, "gain is clamped to 0..1");
+            expect(ControlServer::parse("mute on", command, error));
+            expectEquals(command.value, 1.0);
+            expect(ControlServer::parse("load \"/music/a b.wav\"", command, error));
+            expectEquals(command.text, juce::String("/music/a b.wav"));
+
+            for(auto* bad : { "seek", "seek nan", "seek 1e999", "gain loud", "loop maybe", "play now", "load", "dance" })
+                expect(!ControlServer::parse(bad, command, error) && error.isNotEmpty(), juce::String("accepted \"") + bad + "\"");
+        }
+
+        auto fixture = TestSignals::writeFixture(TestSignals::getFixtureDirectory(), "tone-44k", 44100.0, 3.0);
+        PlayerAudio player(PlayerAudio::Rendering::offline);
+        player.prepareToPlay(blockSize, 44100.0);
+        expect(player.loadFile(fixture));
+        player.start();
+
+        FakeTarget target;
+        target.player = &player;
+        ControlServer server(player, target);
+        beginTest("Listening");
+        expect(server.start(0, 0), "could not open the control ports");
+
+        juce::StreamingSocket client;
+        expect(client.connect("127.0.0.1", server.getTcpPort(), 2000), "could not connect");
+
+        beginTest("Seek goes through the Target and is acknowledged once heard");
+        {
+            send(client, "seek 2.0");
+            auto reply = waitFor(client, player, server, [](const juce::var& v) { return v.hasProperty("ok"); }, false);
+            expect((bool)reply["ok"]);
+            const int id = reply["id"];
+
+            auto applied = waitFor(client, player, server, [id](const juce::var& v) { return v["event"] == "applied" && (int)v["id"] == id; });
+            expect((double)applied.getProperty("latencyMs", -1.0) >= 0.0, "no latency in the acknowledgement");
+            expect(target.commands.size() == 1 && target.commands[0].type == Command::seek);
+            expectWithinAbsoluteError(player.getPosition(), 2.0, 0.05);
+        }
+
+        beginTest("Gain reaches the audio thread without the message thread");
+        {
+            send(client, "gain 0");
+            waitFor(client, player, server, [](const juce::var& v) { return v["event"] == "applied" && v["command"] == "gain"; });
+            for(int i = 0; i < 20; ++i) renderBlock(player); // past the gain ramp
+            expectEquals(renderBlock(player), 0.0f, "gain 0 is not silent");
+            send(client, "gain 1");
+            waitFor(client, player, server, [](const juce::var& v) { return v["event"] == "applied" && v["command"] == "gain"; });
+        }
+
+        beginTest("Commands through the Target are acknowledged from the audio thread");
+        {
+            send(client, "pause");
+            auto applied = waitFor(client, player, server, [](const juce::var& v) { return v["event"] == "applied" && v["command"] == "pause"; });
+            expect((double)applied.getProperty("latencyMs", -1.0) >= 0.0);
+            expect(target.commands.back().type == Command::pause);
+
+            send(client, "load /nowhere/missing.wav");
+            waitFor(client, player, server, [](const juce::var& v) { return v["event"] == "failed" && v["command"] == "load"; });
+
+            send(client, "dance");
+            auto error = waitFor(client, player, server, [](const juce::var& v) { return v.hasProperty("error"); });
+            expect(!(bool)error["ok"]);
+
+            auto stats = server.getLatencyStats();
+            expectGreaterOrEqual(stats.count, 4);
+            expect(stats.p50Ms >= 0.0 && stats.p99Ms >= stats.p50Ms && stats.maxMs >= stats.p99Ms);
+        }
+
+        beginTest("State feed");
+        {
+            send(client, "subscribe");
+            auto reply = waitFor(client, player, server, [](const juce::var& v) { return v.hasProperty("state"); });
+            expect((bool)reply["ok"]);
+
+            target.state.track = "Second track";
+            target.state.queued = 3;
+            auto event = waitFor(client, player, server, [](const juce::var& v) { return v["event"] == "state" && v["track"] == "Second track"; });
+            expectEquals((int)event["queued"], 3);
+        }
+
+        beginTest("OSC");
+        {
+            OscCollector collector;
+            juce::DatagramSocket subscriberSocket;
+            expect(subscriberSocket.bindToPort(0, "127.0.0.1"));
+            juce::OSCReceiver subscriber;
+            expect(subscriber.connectToSocket(subscriberSocket));
+            subscriber.addListener(&collector);
+
+            juce::OSCSender sender;
+            expect(sender.connect("127.0.0.1", server.getOscPort()));
+            expect(sender.send("/player/subscribe", (juce::int32)subscriberSocket.getBoundPort()));
+            expect(sender.send("/player/gain", 0.5f));
+
+            pumpUntil(player, server, [&] { return !target.commands.empty() && target.commands.back().type == Command::gain
+                                                   && target.commands.back().value == 0.5; });
+            expectEquals(target.commands.back().value, 0.5);
+            pumpUntil(player, server, [&] { return collector.has("/player/applied") && collector.has("/player/state"); });
+            expect(collector.has("/player/applied"), "no acknowledgement over OSC");
+            expect(collector.has("/player/state"), "no state over OSC");
+
+            subscriber.removeListener(&collector);
+            subscriber.disconnect();
+        }
+    }
+
+private:
+    static constexpr int blockSize = 256;
+
+    struct FakeTarget : ControlServer::Target
+    {
+        std::vector<ControlServer::Command> commands;
+        ControlServer::State state;
+        PlayerAudio* player = nullptr;
+
+        bool handleControlCommand(const ControlServer::Command& command) override
+        {
+            commands.push_back(command);
+            if(command.type == ControlServer::Command::seek) player->setPosition(command.value);
+            return command.type != ControlServer::Command::load;
+        }
+
+        ControlServer::State getControlState() override { return state; }
+    };
+
+    struct OscCollector : juce::OSCReceiver::Listener<juce::OSCReceiver::RealtimeCallback>
+    {
+        juce::CriticalSection lock;
+        juce::StringArray addresses;
+
+        void oscMessageReceived(const juce::OSCMessage& message) override
+        {
+            const juce::ScopedLock sl(lock);
+            addresses.add(message.getAddressPattern().toString());
+        }
+
+        bool has(const juce::String& address)
+        {
+            const juce::ScopedLock sl(lock);
+            return addresses.contains(address);
+        }
+    };
+
+    std::string received;
+    std::vector<juce::var> lines;
+
+    static void send(juce::StreamingSocket& client, const juce::String& line)
+    {
+        auto text = line + "\n";
+        client.write(text.toRawUTF8(), (int)text.getNumBytesAsUTF8());
+    }
+
+    // Returns the block's peak
+    static float renderBlock(PlayerAudio& player)
+    {
+        juce::AudioBuffer<float> block(2, blockSize);
+        juce::AudioSourceChannelInfo info(&block, 0, blockSize);
+        player.getNextAudioBlock(info);
+        return block.getMagnitude(0, blockSize);
+    }
+
+    // One audio block and one message-thread update per turn, as a running player would
+    void pumpUntil(PlayerAudio& player, ControlServer& server, std::function<bool()> done, bool runEngine = true)
+    {
+        for(int i = 0; i < 400 && !done(); ++i)
+        {
+            if(runEngine)
+            {
+                renderBlock(player);
+                server.update();
+            }
+            juce::Thread::sleep(5);
+        }
+    }
+
+    // The first line, old or new, that matches; the others are kept for later calls
+    juce::var waitFor(juce::StreamingSocket& client, PlayerAudio& player, ControlServer& server,
+                      std::function<bool(const juce::var&)> match, bool runEngine = true)
+    {
+        juce::var found;
+        pumpUntil(player, server, [&]
+        {
+            char buffer[4096];
+            while(client.waitUntilReady(true, 0) == 1)
+            {
+                const int n = client.read(buffer, (int)sizeof(buffer), false);
+                if(n <= 0) break;
+                received.append(buffer, (size_t)n);
+            }
+            for(auto end = received.find('\n'); end != std::string::npos; end = received.find('\n'))
+            {
+                lines.push_back(juce::JSON::parse(juce::String::fromUTF8(received.data(), (int)end)));
+                received.erase(0, end + 1);
+            }
+
+            for(auto it = lines.begin(); it != lines.end(); ++it)
+                if(match(*it))
+                {
+                    found = *it;
+                    lines.erase(it);
+                    return true;
+                }
+            return false;
+        }, runEngine);
+
+        expect(!found.isVoid(), "timed out waiting for a reply");
+        return found;
+    }
+};
+
+static ControlServerTests controlServerTests;
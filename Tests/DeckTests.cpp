@@ -0,0 +1,51 @@
+#include <JuceHeader.h>
+#include "Deck.h"
+#include "TestSignals.h"
+
+// Cue points on a deck whose source and output rates differ. Virtual tracks of one file are
+// switched by seeking, so a cue that lands a sample early plays the previous track's last one.
+class DeckTests : public juce::UnitTest
+{
+public:
+    DeckTests() : juce::UnitTest("Deck", "deck") {}
+
+    void runTest() override
+    {
+        beginTest("44.1 kHz cue points survive the trip through 48 kHz output samples");
+        {
+            int misses = 0;
+            for(juce::int64 cue = 0; cue < 44100 * 600; cue += 13)
+            {
+                auto output = Deck::sourceToOutputSample(cue, 44100.0, 48000.0);
+                // What the transport seeks its reader to, and what it reports back
+                auto read = (juce::int64)((double)output * 44100.0 / 48000.0);
+                auto reported = (juce::int64)((double)cue * (48000.0 / 44100.0));
+                if(read != cue || Deck::outputToSourceSample(reported, 44100.0, 48000.0) != cue)
+                    ++misses;
+            }
+            expectEquals(misses, 0);
+        }
+
+        beginTest("A 44.1 kHz deck on a 48 kHz output reads back the cue it was given");
+        {
+            auto fixture = TestSignals::writeFixture(TestSignals::getFixtureDirectory(), "tone-44k", 44100.0, 3.0);
+            juce::AudioFormatManager formats;
+            formats.registerBasicFormats();
+
+            Deck deck(nullptr);
+            deck.prepare(512, 48000.0);
+            expect(deck.load(std::unique_ptr<juce::AudioFormatReader>(formats.createReaderFor(fixture)), fixture));
+
+            for(juce::int64 cue : { (juce::int64)0, (juce::int64)1, (juce::int64)147, (juce::int64)44099,
+                                    (juce::int64)44100, (juce::int64)100001, (juce::int64)123457 })
+            {
+                deck.setPositionInSamples(cue);
+                expectEquals((int)deck.getPositionInSamples(), (int)cue);
+            }
+            deck.unload();
+            deck.release();
+        }
+    }
+};
+
+static DeckTests deckTests;
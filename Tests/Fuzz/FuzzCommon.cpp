@@ -0,0 +1,50 @@
+#include "FuzzCommon.h"
+
+namespace Fuzz
+{
+void initialise()
+{
+    static juce::ScopedJuceInitialiser_GUI juceInitialiser;
+}
+
+static juce::File getInputDirectory()
+{
+    auto dir = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                   .getChildFile("SimpleAudioPlayerFuzz").getChildFile(juce::String(juce::Process::getCurrentProcessId()));
+    dir.createDirectory();
+    return dir;
+}
+
+// A new name per input: the format cache keys on path, size and time, and a reused path
+// could hand one input the format sniffed from the previous one
+InputFile::InputFile(const uint8_t* data, size_t size)
+{
+    static juce::int64 counter = 0; // never wraps, and each file is deleted after its input
+    const int extension = size > 0 ? data[0] % numExtensions : 0;
+    file = getInputDirectory().getChildFile("input-" + juce::String(counter++) + extensions[extension]);
+    file.deleteFile();
+    if(size > 1) file.replaceWithData(data + 1, size - 1);
+    else file.create();
+}
+
+InputFile::~InputFile()
+{
+    file.deleteFile();
+}
+
+juce::MemoryBlock makeSeed(const juce::File& source)
+{
+    juce::MemoryBlock seed;
+    for(int i = 0; i < numExtensions && seed.isEmpty(); ++i)
+    {
+        const auto selector = (uint8_t)i;
+        if(source.hasFileExtension(extensions[i])) seed.append(&selector, 1);
+    }
+    if(seed.isEmpty()) return {};
+
+    juce::MemoryBlock contents;
+    source.loadFileAsData(contents);
+    seed.append(contents.getData(), contents.getSize());
+    return seed;
+}
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <JuceHeader.h>
+#include <cstddef>
+#include <cstdint>
+
+// Shared by the libFuzzer targets and the seed generator.
+// The first byte of every file input picks the extension it is saved under, so the fuzzer can
+// steer each input to a different format's parser; the rest is the file's contents.
+namespace Fuzz
+{
+    inline constexpr const char* extensions[] = { ".wav", ".aiff", ".flac", ".ogg", ".mp3", ".m4a", ".opus", ".cue" };
+    inline constexpr int numExtensions = (int)(sizeof(extensions) / sizeof(extensions[0]));
+
+    // JUCE (message manager included) for the life of the process
+    void initialise();
+
+    // Writes data[1..] to a fresh temporary file named by data[0]; the file is deleted with the object
+    class InputFile
+    {
+    public:
+        InputFile(const uint8_t* data, size_t size);
+        ~InputFile();
+
+        const juce::File& getFile() const { return file; }
+
+    private:
+        juce::File file;
+    };
+
+    // Prefixes a seed file with the selector byte of its extension
+    juce::MemoryBlock makeSeed(const juce::File& source);
+}
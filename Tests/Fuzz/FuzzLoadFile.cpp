@@ -0,0 +1,44 @@
+#include "FuzzCommon.h"
+#include "PlayerAudio.h"
+
+// PlayerAudio::loadFile on arbitrary bytes, then the reads playback would make: the start,
+// a seek into the middle, and the last block. One player is reused across inputs, as in the
+// app, so state left behind by a bad file is exercised by the next one.
+// Inputs claiming huge lengths must not make any step slow; the run targets set -timeout.
+extern "C" int LLVMFuzzerInitialize(int*, char***)
+{
+    Fuzz::initialise();
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    static constexpr int blockSize = 512;
+    static PlayerAudio player(PlayerAudio::Rendering::offline);
+    static juce::AudioBuffer<float> block(2, blockSize);
+    static const bool prepared = (player.prepareToPlay(blockSize, 44100.0), true);
+    juce::ignoreUnused(prepared);
+
+    Fuzz::InputFile input(data, size);
+    if(!player.loadFile(input.getFile()))
+        return 0;
+
+    auto render = [](int numBlocks)
+    {
+        for(int i = 0; i < numBlocks; ++i)
+        {
+            juce::AudioSourceChannelInfo info(&block, 0, blockSize);
+            player.getNextAudioBlock(info);
+        }
+    };
+
+    player.start();
+    render(8);
+    player.setPosition(player.getLengthInSeconds() * 0.5);
+    render(4);
+    player.setPosition(juce::jmax(0.0, player.getLengthInSeconds() - 0.01));
+    render(4);
+    player.stop();
+    player.update();
+    return 0;
+}
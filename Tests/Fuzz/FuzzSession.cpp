@@ -0,0 +1,30 @@
+#include "FuzzCommon.h"
+#include "Session.h"
+#include <cmath>
+
+// Session::parse on arbitrary session files. Whatever it accepts must be sane to apply to the
+// GUI and must survive a save and reload unchanged in shape.
+extern "C" int LLVMFuzzerInitialize(int*, char***)
+{
+    Fuzz::initialise();
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    // loadFileAsString decodes the same way
+    auto session = Session::parse(juce::String::createStringFromData(data, (int)size));
+
+    if(!std::isfinite(session.position) || session.position < 0.0 || !std::isfinite(session.crossfade))
+        __builtin_trap();
+    for(auto gain : session.eqGains)
+        if(!std::isfinite(gain)) __builtin_trap();
+
+    auto reloaded = Session::parse(session.toJson());
+    if(reloaded.lastFile != session.lastFile || reloaded.eqGains.size() != session.eqGains.size())
+        __builtin_trap();
+    for(auto& [path, store] : session.markers)
+        if(!store.isEmpty() && reloaded.markers[path].size() != store.size())
+            __builtin_trap();
+    return 0;
+}
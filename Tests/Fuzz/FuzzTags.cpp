@@ -0,0 +1,28 @@
+#include "FuzzCommon.h"
+#include "TrackTags.h"
+#include "ChapterReader.h"
+#include <cmath>
+
+// What loadCurrentTrack reads through TagLib from a file the user opened: title, artist and
+// album, and the cue sheet or chapter tags that split it into virtual tracks.
+extern "C" int LLVMFuzzerInitialize(int*, char***)
+{
+    Fuzz::initialise();
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    Fuzz::InputFile input(data, size);
+    auto tags = TrackTags::read(input.getFile());
+    auto entries = ChapterReader::expand(input.getFile());
+
+    // Every virtual track must cover a real, ordered range of the file
+    for(auto& entry : entries)
+        if(entry.isVirtual && (!std::isfinite(entry.startTime) || entry.startTime < 0.0
+                               || (entry.endTime >= 0.0 && entry.endTime < entry.startTime)))
+            __builtin_trap();
+
+    juce::ignoreUnused(tags);
+    return 0;
+}
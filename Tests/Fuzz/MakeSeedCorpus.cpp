@@ -0,0 +1,160 @@
+#include "FuzzCommon.h"
+#include "Session.h"
+#include <taglib/fileref.h>
+#include <taglib/tag.h>
+#include <taglib/tpropertymap.h>
+#include <cmath>
+#include <iostream>
+
+// Writes small valid inputs for each fuzz target, so mutation starts from files the parsers
+// accept instead of having to discover every header from nothing.
+// Usage: PlayerFuzzSeeds <corpus directory>; creates load/, tags/ and session/ inside it.
+namespace
+{
+juce::AudioBuffer<float> makeTone(double sampleRate, double seconds)
+{
+    juce::AudioBuffer<float> buffer(2, juce::roundToInt(sampleRate * seconds));
+    for(int i = 0; i < buffer.getNumSamples(); ++i)
+    {
+        const double phase = juce::MathConstants<double>::twoPi * 440.0 * i / sampleRate;
+        buffer.setSample(0, i, (float)(0.5 * std::sin(phase)));
+        buffer.setSample(1, i, (float)(0.5 * std::sin(phase * 1.5)));
+    }
+    return buffer;
+}
+
+bool writeAudio(juce::AudioFormat& format, const juce::File& file, double sampleRate, int bitsPerSample)
+{
+    auto tone = makeTone(sampleRate, 0.1);
+    file.deleteFile();
+    auto stream = std::make_unique<juce::FileOutputStream>(file);
+    std::unique_ptr<juce::AudioFormatWriter> writer(format.createWriterFor(stream.get(), sampleRate, 2, bitsPerSample, {}, 0));
+    if(writer == nullptr) return false;
+    stream.release(); // the writer owns it now
+    return writer->writeFromAudioSampleBuffer(tone, 0, tone.getNumSamples());
+}
+
+// Ten silent MPEG-1 layer III frames (128 kbit/s, 44.1 kHz): a header and all-zero side info
+void writeSilentMp3(const juce::File& file)
+{
+    juce::MemoryBlock data;
+    const uint8_t header[] = { 0xff, 0xfb, 0x90, 0x64 };
+    for(int frame = 0; frame < 10; ++frame)
+    {
+        data.append(header, sizeof(header));
+        juce::MemoryBlock body(417 - sizeof(header), true);
+        data.append(body.getData(), body.getSize());
+    }
+    file.replaceWithData(data.getData(), data.getSize());
+}
+
+// Plain tags, chapter properties and a cue sheet, each where the format can hold them
+void addTags(const juce::File& file, bool withChapters)
+{
+    TagLib::FileRef f(file.getFullPathName().toStdString().c_str());
+    if(f.isNull() || f.tag() == nullptr) return;
+
+    f.tag()->setTitle("Seed title");
+    f.tag()->setArtist("Seed artist");
+    f.tag()->setAlbum("Seed album");
+    if(withChapters)
+    {
+        auto properties = f.properties();
+        properties.replace("CHAPTER001", TagLib::StringList("00:00:00.000"));
+        properties.replace("CHAPTER001NAME", TagLib::StringList("Intro"));
+        properties.replace("CHAPTER002", TagLib::StringList("00:00:00.050"));
+        properties.replace("CHAPTER002NAME", TagLib::StringList("Outro"));
+        f.setProperties(properties);
+    }
+    f.save();
+}
+
+const char* cueSheet = "PERFORMER \"Seed artist\"\n"
+                       "TITLE \"Seed album\"\n"
+                       "FILE \"seed.wav\" WAVE\n"
+                       "  TRACK 01 AUDIO\n"
+                       "    TITLE \"One\"\n"
+                       "    INDEX 01 00:00:00\n"
+                       "  TRACK 02 AUDIO\n"
+                       "    TITLE \"Two\"\n"
+                       "    INDEX 00 00:00:70\n"
+                       "    INDEX 01 00:01:00\n";
+
+void addSeed(const juce::File& source, const juce::File& directory)
+{
+    auto seed = Fuzz::makeSeed(source);
+    if(!seed.isEmpty())
+        directory.getChildFile(source.getFileName() + ".seed").replaceWithData(seed.getData(), seed.getSize());
+}
+
+void writeSessionSeeds(const juce::File& directory)
+{
+    Session empty;
+    directory.getChildFile("empty.json").replaceWithText(empty.toJson());
+
+    Session full;
+    full.lastFile = juce::File::getSpecialLocation(juce::File::userMusicDirectory).getChildFile("album.flac");
+    full.position = 83.25;
+    full.crossfade = 2.0;
+    full.eqGains = { 0.0, 1.5, -3.0, 0.0, 0.0, 2.0, 0.0, 0.0, -1.0, 0.0 };
+    for(int i = 0; i < 5; ++i)
+        full.markers[full.lastFile.getFullPathName()].add({ "Marker " + juce::String(i), i * 12.5, false });
+    full.markers["/other/file.mp3"].add({ "Only", 1.0, false });
+    directory.getChildFile("full.json").replaceWithText(full.toJson());
+
+    directory.getChildFile("not-an-object.json").replaceWithText("[1, 2, 3]");
+    directory.getChildFile("wrong-types.json").replaceWithText("{ \"lastFile\": 3, \"position\": \"x\", \"eq\": {}, \"markers\": [ 1, { \"file\": [] } ] }");
+}
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: PlayerFuzzSeeds <corpus directory>" << std::endl;
+        return 1;
+    }
+
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    auto root = juce::File::getCurrentWorkingDirectory().getChildFile(argv[1]);
+    auto load = root.getChildFile("load"), tags = root.getChildFile("tags"), session = root.getChildFile("session");
+    for(auto& dir : { load, tags, session }) dir.createDirectory();
+
+    juce::TemporaryFile scratchDirectory;
+    auto scratch = scratchDirectory.getFile();
+    scratch.createDirectory();
+
+    juce::WavAudioFormat wav;
+    juce::AiffAudioFormat aiff;
+    juce::FlacAudioFormat flac;
+    juce::OggVorbisAudioFormat ogg;
+    struct { juce::AudioFormat* format; const char* name; double rate; int bits; } audio[] = {
+        { &wav, "seed.wav", 44100.0, 16 }, { &wav, "seed-24.wav", 48000.0, 24 },
+        { &aiff, "seed.aiff", 44100.0, 16 }, { &flac, "seed.flac", 44100.0, 16 },
+        { &ogg, "seed.ogg", 44100.0, 16 } };
+
+    for(auto& a : audio)
+    {
+        auto file = scratch.getChildFile(a.name);
+        if(!writeAudio(*a.format, file, a.rate, a.bits)) continue;
+        addSeed(file, load);
+        addTags(file, true);
+        addSeed(file, tags);
+    }
+
+    auto mp3 = scratch.getChildFile("seed.mp3");
+    writeSilentMp3(mp3);
+    addSeed(mp3, load);
+    addTags(mp3, false);
+    addSeed(mp3, tags);
+
+    auto cue = scratch.getChildFile("seed.cue");
+    cue.replaceWithText(cueSheet);
+    addSeed(cue, tags);
+
+    writeSessionSeeds(session);
+    scratch.deleteRecursively();
+
+    std::cout << "Seeds written to " << root.getFullPathName() << std::endl;
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include "TestSignals.h"
+
+// Renders generated fixtures through PlayerAudio offline and compares the output with the
+// fingerprints in Tests/golden.
+// - A missing golden file is a failure, so a checkout without them can't pass by accident.
+// - PLAYER_TESTS_UPDATE_GOLDEN=1 records every golden file from the current output, the first
+//   time or after an intended change; commit them.
+// - Output must match each golden's block RMS and peak within tolerance. With
+//   PLAYER_TESTS_EXACT=1 it must match bit for bit, for refactors that should not change a sample.
+class GoldenRenderTests : public juce::UnitTest
+{
+public:
+    GoldenRenderTests() : juce::UnitTest("Golden renders", "golden") {}
+
+    static constexpr double outputRate = 44100.0;
+    static constexpr float tolerance = 1.0e-4f; // -80 dB
+
+    void runTest() override
+    {
+        auto dir = TestSignals::getFixtureDirectory();
+        auto tone = TestSignals::writeFixture(dir, "tone-44k", 44100.0, 3.0);
+        auto shortTone = TestSignals::writeFixture(dir, "tone-short", 44100.0, 0.5);
+        auto tone48 = TestSignals::writeFixture(dir, "tone-48k", 48000.0, 2.0);
+
+        beginTest("Plain playback");
+        render("plain", tone, [](PlayerAudio& player, TestSignals::Recorder& rec)
+        {
+            player.start();
+            rec.render(2.0);
+        });
+
+        beginTest("Seeks");
+        render("seek", tone, [](PlayerAudio& player, TestSignals::Recorder& rec)
+        {
+            player.setPosition(1.25);
+            player.start();
+            rec.render(0.5);
+            player.setPosition(0.3);
+            rec.render(0.5);
+            player.setPositionInSamples(100000);
+            rec.render(0.25);
+        });
+
+        beginTest("Whole-file loop");
+        render("loop-file", shortTone, [](PlayerAudio& player, TestSignals::Recorder& rec)
+        {
+            player.setLooping(true);
+            player.start();
+            rec.render(1.6);
+        });
+
+        beginTest("A-B loop");
+        render("loop-range", tone, [](PlayerAudio& player, TestSignals::Recorder& rec)
+        {
+            player.setLoopRange(0.5, 0.8);
+            player.setPosition(0.5);
+            player.start();
+            rec.render(1.5);
+        });
+
+        beginTest("Playback speed");
+        render("speed", tone, [](PlayerAudio& player, TestSignals::Recorder& rec)
+        {
+            player.start();
+            rec.render(0.5);
+            player.setPlaybackSpeed(1.5f);
+            rec.render(0.5);
+            player.setPlaybackSpeed(0.75f);
+            rec.render(0.5);
+            player.setPlaybackSpeed(1.0f);
+            rec.render(0.25);
+        });
+
+        beginTest("Gain and mute ramps");
+        render("gain", tone, [](PlayerAudio& player, TestSignals::Recorder& rec)
+        {
+            player.start();
+            rec.render(0.25);
+            player.setGain(0.25f);
+            rec.render(0.25);
+            player.setMuted(true);
+            rec.render(0.25);
+            player.setMuted(false);
+            rec.render(0.25);
+        });
+
+        beginTest("Sample-rate conversion");
+        render("resample-48k", tone48, [](PlayerAudio& player, TestSignals::Recorder& rec)
+        {
+            player.start();
+            rec.render(1.0);
+        });
+
+        beginTest("Stop");
+        render("stop", tone, [](PlayerAudio& player, TestSignals::Recorder& rec)
+        {
+            player.start();
+            rec.render(0.25);
+            player.stop();
+            rec.render(0.25);
+        });
+    }
+
+private:
+    template <typename Scenario>
+    void render(const juce::String& name, const juce::File& fixture, Scenario scenario)
+    {
+        expect(fixture.existsAsFile(), "fixture " + fixture.getFileName() + " was not written");
+
+        PlayerAudio player(PlayerAudio::Rendering::offline);
+        TestSignals::Recorder recorder(player, outputRate);
+        player.setGain(1.0f);
+        if(!player.loadFile(fixture))
+        {
+            expect(false, "could not load " + fixture.getFileName());
+            return;
+        }
+
+        scenario(player, recorder);
+        compareWithGolden(name, TestSignals::Fingerprint::of(recorder.getOutput()));
+    }
+
+    void compareWithGolden(const juce::String& name, const TestSignals::Fingerprint& actual)
+    {
+        auto golden = juce::File(PLAYER_TESTS_GOLDEN_DIR).getChildFile(name + ".golden");
+        if(isSet("PLAYER_TESTS_UPDATE_GOLDEN"))
+        {
+            golden.getParentDirectory().createDirectory();
+            expect(golden.replaceWithText(actual.toText()), "could not write " + golden.getFullPathName());
+            logMessage("Recorded " + golden.getFullPathName());
+            return;
+        }
+
+        if(!golden.existsAsFile())
+        {
+            expect(false, "no golden file " + golden.getFullPathName() + "; record it with PLAYER_TESTS_UPDATE_GOLDEN=1");
+            return;
+        }
+
+        TestSignals::Fingerprint expected;
+        if(!TestSignals::Fingerprint::parse(golden.loadFileAsString(), expected))
+        {
+            expect(false, golden.getFileName() + " is not a fingerprint");
+            return;
+        }
+
+        expectEquals(actual.numSamples, expected.numSamples, name + ": length");
+        const float difference = actual.maxDifference(expected);
+        expect(difference <= tolerance, name + ": block levels differ from the golden file by " + juce::String(difference));
+
+        if(actual.hash != expected.hash)
+        {
+            if(isSet("PLAYER_TESTS_EXACT")) expect(false, name + ": output is not bit-exact");
+            else logMessage(name + ": within tolerance but not bit-exact (max difference " + juce::String(difference) + ")");
+        }
+    }
+
+    static bool isSet(const char* variable)
+    {
+        return juce::SystemStats::getEnvironmentVariable(variable, {}) == "1";
+    }
+};
+
+static GoldenRenderTests goldenRenderTests;
@@ -0,0 +1,138 @@
+#include "TestSignals.h"
+#include "LoopbackHttpServer.h"
+#include "HttpStream.h"
+#include <cstring>
+
+// HttpStream and PlayerAudio::loadURL against a loopback server: byte-exact reads through a
+// ring smaller than the file, seeks as range requests (and without them), underrun counting
+// on a throttled link, and a stream rendering the same audio as the local file.
+class HttpStreamTests : public juce::UnitTest
+{
+public:
+    HttpStreamTests() : juce::UnitTest("HTTP streaming", "http") {}
+
+    void runTest() override
+    {
+        LoopbackHttpServer server;
+        beginTest("Loopback server");
+        expect(server.start(), "could not listen on 127.0.0.1");
+
+        const auto data = makeData(1500000);
+        server.serve("/data.bin", data);
+
+        HttpStream::Options smallRing;
+        smallRing.bufferBytes = 256 << 10;
+        smallRing.headBytes = 16 << 10;
+
+        beginTest("Sequential reads through a ring smaller than the file");
+        {
+            HttpStream stream(server.getURL("/data.bin"), smallRing);
+            expectEquals(stream.getTotalLength(), (juce::int64)data.getSize());
+
+            juce::MemoryBlock received(data.getSize());
+            int done = 0;
+            while(done < (int)data.getSize())
+            {
+                const int n = stream.read(static_cast<char*>(received.getData()) + done, juce::jmin(10000, (int)data.getSize() - done));
+                if(n <= 0) break;
+                done += n;
+            }
+            expectEquals(done, (int)data.getSize());
+            expect(received == data, "bytes differ from the served file");
+            expect(stream.isExhausted());
+        }
+
+        beginTest("Seeks are range requests; the header stays cached");
+        {
+            const int requestsBefore = server.getRangeHeaders().size();
+            HttpStream stream(server.getURL("/data.bin"), smallRing);
+            expectRead(stream, data, 0, 20000);
+            expect(stream.setPosition(1000000));
+            expectRead(stream, data, 1000000, 5000);
+            expect(stream.setPosition(100));
+            expectRead(stream, data, 100, 5000);
+
+            auto ranges = server.getRangeHeaders();
+            expectEquals(ranges.size() - requestsBefore, 2, "the seek back into the header must not reconnect");
+            expect(ranges.contains("bytes=1000000-"), "no range request for the seek");
+            expect(stream.getHealth().rangeRequests);
+        }
+
+        beginTest("Seeks on a server without range support");
+        {
+            server.setRangeRequests(false);
+            HttpStream stream(server.getURL("/data.bin"), smallRing);
+            expect(stream.setPosition(700000));
+            expectRead(stream, data, 700000, 5000);
+            expect(!stream.getHealth().rangeRequests);
+            server.setRangeRequests(true);
+        }
+
+        beginTest("Underruns on a slow link");
+        {
+            const auto slowData = makeData(200000);
+            server.serve("/slow.bin", slowData);
+            server.setBytesPerSecond(400000);
+
+            HttpStream::Options options = smallRing;
+            options.rebufferBytes = 8192;
+            HttpStream stream(server.getURL("/slow.bin"), options);
+            expectRead(stream, slowData, 0, (int)slowData.getSize(), 4096);
+            expectGreaterThan(stream.getHealth().underruns, 0);
+            server.setBytesPerSecond(0);
+        }
+
+        beginTest("A stream plays like the local file");
+        {
+            auto fixture = TestSignals::writeFixture(TestSignals::getFixtureDirectory(), "tone-44k", 44100.0, 3.0);
+            juce::MemoryBlock wav;
+            expect(fixture.loadFileAsData(wav));
+            server.serve("/tone.wav", wav);
+
+            auto local = render([&](PlayerAudio& player) { return player.loadFile(fixture); });
+            auto streamed = render([&](PlayerAudio& player) { return player.loadURL(server.getURL("/tone.wav")); });
+            expectEquals(streamed.numSamples, local.numSamples);
+            expectEquals(streamed.maxDifference(local), 0.0f);
+        }
+    }
+
+private:
+    static juce::MemoryBlock makeData(int size)
+    {
+        juce::MemoryBlock block((size_t)size);
+        juce::Random random(size);
+        random.fillBitsRandomly(block.getData(), block.getSize());
+        return block;
+    }
+
+    void expectRead(HttpStream& stream, const juce::MemoryBlock& data, int offset, int size, int readSize = 1 << 30)
+    {
+        juce::MemoryBlock received((size_t)size);
+        int done = 0;
+        while(done < size)
+        {
+            const int n = stream.read(static_cast<char*>(received.getData()) + done, juce::jmin(readSize, size - done));
+            if(n <= 0) break;
+            done += n;
+        }
+        expectEquals(done, size, "short read at " + juce::String(offset));
+        expect(std::memcmp(received.getData(), static_cast<const char*>(data.getData()) + offset, (size_t)done) == 0,
+               "bytes at " + juce::String(offset) + " differ from the served file");
+    }
+
+    template <typename Load>
+    TestSignals::Fingerprint render(Load load)
+    {
+        PlayerAudio player(PlayerAudio::Rendering::offline);
+        TestSignals::Recorder recorder(player, 44100.0);
+        player.setGain(1.0f);
+        expect(load(player), "could not load");
+        player.start();
+        recorder.render(1.0);
+        player.setPosition(2.0);
+        recorder.render(0.5);
+        return TestSignals::Fingerprint::of(recorder.getOutput());
+    }
+};
+
+static HttpStreamTests httpStreamTests;
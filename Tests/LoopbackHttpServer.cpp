@@ -0,0 +1,151 @@
+#include "LoopbackHttpServer.h"
+
+class LoopbackHttpServer::Connection : public juce::Thread
+{
+public:
+    Connection(LoopbackHttpServer& serverToUse, juce::StreamingSocket* socketToServe)
+        : juce::Thread("Loopback HTTP connection"), server(serverToUse), socket(socketToServe)
+    {
+        startThread();
+    }
+
+    ~Connection() override
+    {
+        signalThreadShouldExit();
+        socket->close();
+        stopThread(2000);
+    }
+
+private:
+    LoopbackHttpServer& server;
+    std::unique_ptr<juce::StreamingSocket> socket;
+
+    void run() override
+    {
+        server.respond(*socket, *this);
+        socket->close();
+    }
+};
+
+LoopbackHttpServer::LoopbackHttpServer() : juce::Thread("Loopback HTTP server") {}
+
+LoopbackHttpServer::~LoopbackHttpServer()
+{
+    signalThreadShouldExit();
+    listener.close();
+    stopThread(2000);
+    connections.clear();
+}
+
+bool LoopbackHttpServer::start()
+{
+    if(!listener.createListener(0, "127.0.0.1")) return false;
+    port = listener.getBoundPort();
+    startThread();
+    return true;
+}
+
+juce::URL LoopbackHttpServer::getURL(const juce::String& path) const
+{
+    return juce::URL("http://127.0.0.1:" + juce::String(port) + path);
+}
+
+void LoopbackHttpServer::serve(const juce::String& path, const juce::MemoryBlock& data)
+{
+    const juce::ScopedLock sl(lock);
+    files[path] = data;
+}
+
+juce::StringArray LoopbackHttpServer::getRangeHeaders() const
+{
+    const juce::ScopedLock sl(lock);
+    return rangeHeaders;
+}
+
+void LoopbackHttpServer::run()
+{
+    while(!threadShouldExit())
+    {
+        if(listener.waitUntilReady(true, 100) != 1) continue;
+        auto* socket = listener.waitForNextConnection();
+        if(socket == nullptr) continue;
+
+        const juce::ScopedLock sl(lock);
+        for(int i = connections.size(); --i >= 0;)
+            if(!connections[i]->isThreadRunning()) connections.remove(i);
+        connections.add(new Connection(*this, socket));
+    }
+}
+
+void LoopbackHttpServer::respond(juce::StreamingSocket& socket, juce::Thread& thread)
+{
+    // Request line and headers, up to the blank line
+    juce::MemoryOutputStream request;
+    while(!request.toString().contains("\r\n\r\n") && request.getDataSize() < 16384)
+    {
+        if(thread.threadShouldExit() || socket.waitUntilReady(true, 2000) != 1) return;
+        char c = 0;
+        if(socket.read(&c, 1, false) != 1) return;
+        request.writeByte(c);
+    }
+
+    auto lines = juce::StringArray::fromLines(request.toString());
+    auto path = lines[0].fromFirstOccurrenceOf(" ", false, false).upToFirstOccurrenceOf(" ", false, false);
+    juce::String range;
+    for(auto& line : lines)
+        if(line.startsWithIgnoreCase("Range:"))
+            range = line.fromFirstOccurrenceOf(":", false, false).trim();
+
+    juce::MemoryBlock body;
+    {
+        const juce::ScopedLock sl(lock);
+        rangeHeaders.add(range);
+        auto it = files.find(path);
+        if(it == files.end())
+        {
+            juce::String notFound("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            socket.write(notFound.toRawUTF8(), (int)notFound.getNumBytesAsUTF8());
+            return;
+        }
+        body = it->second;
+    }
+
+    const auto total = (juce::int64)body.getSize();
+    juce::int64 first = 0, last = total - 1;
+    const bool partial = honourRanges.load() && range.startsWithIgnoreCase("bytes=");
+    if(partial)
+    {
+        auto spec = range.fromFirstOccurrenceOf("=", false, false);
+        first = spec.upToFirstOccurrenceOf("-", false, false).getLargeIntValue();
+        auto end = spec.fromFirstOccurrenceOf("-", false, false).trim();
+        if(end.isNotEmpty()) last = juce::jmin(last, end.getLargeIntValue());
+        if(first >= total)
+        {
+            juce::String unsatisfiable("HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */" + juce::String(total)
+                                       + "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            socket.write(unsatisfiable.toRawUTF8(), (int)unsatisfiable.getNumBytesAsUTF8());
+            return;
+        }
+    }
+
+    juce::String header;
+    header << (partial ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n")
+           << "Content-Type: application/octet-stream\r\n"
+           << "Content-Length: " << (last - first + 1) << "\r\n";
+    if(partial) header << "Content-Range: bytes " << first << "-" << last << "/" << total << "\r\n";
+    if(honourRanges.load()) header << "Accept-Ranges: bytes\r\n";
+    header << "Connection: close\r\n\r\n";
+    if(socket.write(header.toRawUTF8(), (int)header.getNumBytesAsUTF8()) < 0) return;
+
+    // Throttled links send one small chunk per interval
+    constexpr int chunkBytes = 4096;
+    for(auto position = first; position <= last && !thread.threadShouldExit();)
+    {
+        const int n = (int)juce::jmin((juce::int64)chunkBytes, last + 1 - position);
+        if(socket.write(static_cast<const char*>(body.getData()) + position, n) != n) return;
+        position += n;
+
+        if(auto rate = bytesPerSecond.load(); rate > 0)
+            juce::Thread::sleep(juce::jmax(1, n * 1000 / rate));
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <map>
+
+// A minimal HTTP server on 127.0.0.1 for the streaming tests.
+// Serves byte blocks by path and honours "Range: bytes=N-" and "bytes=N-M" unless ranges are
+// switched off. It can be throttled to imitate a slow link. Every connection gets its own
+// thread and is closed after one response.
+class LoopbackHttpServer : private juce::Thread
+{
+public:
+    LoopbackHttpServer();
+    ~LoopbackHttpServer() override;
+
+    // Listens on a free port
+    bool start();
+    juce::URL getURL(const juce::String& path) const;
+
+    void serve(const juce::String& path, const juce::MemoryBlock& data);
+    void setRangeRequests(bool shouldHonourRanges) { honourRanges.store(shouldHonourRanges); }
+    void setBytesPerSecond(int rate) { bytesPerSecond.store(rate); } // 0 = as fast as possible
+
+    // Range header of every request so far, empty where there was none
+    juce::StringArray getRangeHeaders() const;
+
+private:
+    class Connection;
+
+    juce::StreamingSocket listener;
+    int port = 0;
+    juce::CriticalSection lock;
+    std::map<juce::String, juce::MemoryBlock> files;
+    juce::StringArray rangeHeaders;
+    juce::OwnedArray<Connection> connections;
+    std::atomic<bool> honourRanges { true };
+    std::atomic<int> bytesPerSecond { 0 };
+
+    void run() override;
+    void respond(juce::StreamingSocket& socket, juce::Thread& thread);
+};
@@ -0,0 +1,57 @@
+#include "TestSignals.h"
+
+// The recorded file must hold exactly what PlayerAudio rendered, to 24-bit precision
+class OutputRecorderTests : public juce::UnitTest
+{
+public:
+    OutputRecorderTests() : juce::UnitTest("Output recorder", "recorder") {}
+
+    void runTest() override
+    {
+        auto dir = TestSignals::getFixtureDirectory();
+        auto tone = TestSignals::writeFixture(dir, "tone-44k", 44100.0, 3.0);
+
+        for(auto* extension : { "wav", "flac" })
+        {
+            beginTest(juce::String("Recording to ") + extension);
+            auto recording = dir.getChildFile("recording").withFileExtension(extension);
+
+            PlayerAudio player(PlayerAudio::Rendering::offline);
+            TestSignals::Recorder rendered(player, 44100.0);
+            expect(player.loadFile(tone));
+            expect(player.getRecorder().start(recording), "could not start recording");
+
+            player.start();
+            rendered.render(0.5);
+            player.setPlaybackSpeed(1.5f);
+            rendered.render(0.5);
+            player.getRecorder().stop();
+
+            expectEquals(player.getRecorder().getDroppedBlocks(), 0);
+            compare(recording, rendered.getOutput());
+            recording.deleteFile();
+        }
+    }
+
+private:
+    void compare(const juce::File& recording, const juce::AudioBuffer<float>& expected)
+    {
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+        std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(recording));
+        expect(reader != nullptr, "could not read " + recording.getFileName());
+        if(reader == nullptr) return;
+
+        expectEquals((int)reader->lengthInSamples, expected.getNumSamples());
+        juce::AudioBuffer<float> actual(2, (int)reader->lengthInSamples);
+        reader->read(&actual, 0, actual.getNumSamples(), 0, true, true);
+
+        float difference = 0.0f;
+        for(int ch = 0; ch < 2; ++ch)
+            for(int i = 0; i < juce::jmin(actual.getNumSamples(), expected.getNumSamples()); ++i)
+                difference = juce::jmax(difference, std::abs(actual.getSample(ch, i) - expected.getSample(ch, i)));
+        expect(difference <= 1.0f / (1 << 22), "recording differs from the output by " + juce::String(difference));
+    }
+};
+
+static OutputRecorderTests outputRecorderTests;
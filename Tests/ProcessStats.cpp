@@ -0,0 +1,110 @@
+#include "ProcessStats.h"
+#include "RealtimeChecker.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+ #include <psapi.h>
+ #pragma comment(lib, "psapi.lib")
+#else
+ #include <dirent.h>
+ #include <unistd.h>
+ #if JUCE_MAC
+  #include <mach/mach.h>
+ #endif
+#endif
+
+// ------------------- Allocation counting -------------------
+// RealtimeChecker replaces operator new itself when it is compiled in, so counting stays off then
+#if !SIMPLEAUDIOPLAYER_RT_CHECKS
+namespace
+{
+    std::atomic<juce::int64> allocations { 0 };
+    std::atomic<juce::int64> deallocations { 0 };
+
+    void* countedAllocate(std::size_t size)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void countedFree(void* p)
+    {
+        if(p == nullptr) return;
+        deallocations.fetch_add(1, std::memory_order_relaxed);
+        std::free(p);
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    if(void* p = countedAllocate(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    if(void* p = countedAllocate(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept   { return countedAllocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size); }
+void operator delete(void* p) noexcept                 { countedFree(p); }
+void operator delete[](void* p) noexcept               { countedFree(p); }
+void operator delete(void* p, std::size_t) noexcept    { countedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept  { countedFree(p); }
+
+juce::int64 ProcessStats::getLiveAllocations() { return allocations.load() - deallocations.load(); }
+juce::int64 ProcessStats::getTotalAllocations() { return allocations.load(); }
+#else
+juce::int64 ProcessStats::getLiveAllocations() { return -1; }
+juce::int64 ProcessStats::getTotalAllocations() { return -1; }
+#endif
+
+// ------------------- Memory and handles -------------------
+juce::int64 ProcessStats::getResidentBytes()
+{
+   #if JUCE_WINDOWS
+    PROCESS_MEMORY_COUNTERS counters {};
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return (juce::int64)counters.WorkingSetSize;
+    return -1;
+   #elif JUCE_MAC
+    mach_task_basic_info info {};
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if(task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS)
+        return (juce::int64)info.resident_size;
+    return -1;
+   #else
+    long pages = 0, resident = 0;
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if(statm == nullptr) return -1;
+    int fields = std::fscanf(statm, "%ld %ld", &pages, &resident);
+    std::fclose(statm);
+    return fields == 2 ? (juce::int64)resident * sysconf(_SC_PAGESIZE) : -1;
+   #endif
+}
+
+int ProcessStats::getOpenHandles()
+{
+   #if JUCE_WINDOWS
+    DWORD handles = 0;
+    return GetProcessHandleCount(GetCurrentProcess(), &handles) ? (int)handles : -1;
+   #else
+    // One entry per open descriptor, less the one used to list them
+    DIR* dir = opendir(JUCE_MAC ? "/dev/fd" : "/proc/self/fd");
+    if(dir == nullptr) return -1;
+    int count = 0;
+    while(auto* entry = readdir(dir))
+        if(entry->d_name[0] != '.') ++count;
+    closedir(dir);
+    return count - 1;
+   #endif
+}
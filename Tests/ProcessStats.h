@@ -0,0 +1,14 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Resource usage of the test process, for spotting leaks in long runs.
+// Each returns -1 where the platform (or build) can't tell.
+namespace ProcessStats
+{
+    juce::int64 getResidentBytes();
+    int getOpenHandles();
+
+    // operator new calls not yet matched by a delete, counted by the test binary itself
+    juce::int64 getLiveAllocations();
+    juce::int64 getTotalAllocations();
+}
@@ -0,0 +1,76 @@
+#include "TestSignals.h"
+#include "RealtimeChecker.h"
+
+// Renders PlayerAudio the way the device callback does, inside ScopedAudioCallback, and
+// expects no allocation, deallocation or lock on that thread other than the known JUCE
+// transport locks, which are logged per site. Seeks, loops, speed and gain changes are made
+// between blocks, as the message thread would. Both renderings are covered: offline decodes
+// in the callback, realtime goes through the read-ahead buffer as a device would.
+// Only meaningful in a build configured with -DSIMPLEAUDIOPLAYER_RT_CHECKS=ON; without it
+// the checker counts nothing and the test says so.
+class RealtimeTests : public juce::UnitTest
+{
+public:
+    RealtimeTests() : juce::UnitTest("Real-time safety", "realtime") {}
+
+    void runTest() override
+    {
+        if(!RealtimeChecker::isEnabled())
+            logMessage("Built without SIMPLEAUDIOPLAYER_RT_CHECKS: nothing is intercepted");
+
+        auto fixture = TestSignals::writeFixture(TestSignals::getFixtureDirectory(), "tone-44k", 44100.0, 3.0);
+
+        beginTest("Offline rendering");
+        renderScenario(PlayerAudio::Rendering::offline, fixture);
+
+        beginTest("Realtime rendering with read-ahead");
+        renderScenario(PlayerAudio::Rendering::realtime, fixture);
+    }
+
+private:
+    static constexpr int blockSize = 512;
+
+    void renderScenario(PlayerAudio::Rendering rendering, const juce::File& fixture)
+    {
+        PlayerAudio player(rendering);
+        player.prepareToPlay(blockSize, 44100.0);
+        expect(player.loadFile(fixture));
+        juce::AudioBuffer<float> block(2, blockSize);
+
+        RealtimeChecker::reset();
+        player.start();
+        render(player, block, 0.5);
+        player.setPosition(1.5);
+        render(player, block, 0.25);
+        player.setLoopRange(0.5, 0.6); // the jump back happens on the audio thread
+        render(player, block, 0.3);
+        player.clearLoopRange();
+        player.setPlaybackSpeed(1.5f);
+        render(player, block, 0.25);
+        player.setPlaybackSpeed(1.0f);
+        player.setGain(0.25f);
+        render(player, block, 0.25);
+
+        expectEquals(RealtimeChecker::getTotalCount(), 0, RealtimeChecker::getReport());
+        for(int site = 0; site < RealtimeChecker::numKnownLocks; ++site)
+        {
+            const auto known = (RealtimeChecker::KnownLock)site;
+            logMessage(juce::String("Known lock, ") + RealtimeChecker::getKnownLockName(known) + ": "
+                       + juce::String(RealtimeChecker::getKnownLockCount(known)));
+        }
+
+        RealtimeChecker::reset();
+    }
+
+    static void render(PlayerAudio& player, juce::AudioBuffer<float>& block, double seconds)
+    {
+        for(int done = 0; done < juce::roundToInt(seconds * 44100.0); done += blockSize)
+        {
+            const juce::AudioSourceChannelInfo info(&block, 0, blockSize);
+            const RealtimeChecker::ScopedAudioCallback realtimeScope;
+            player.getNextAudioBlock(info);
+        }
+    }
+};
+
+static RealtimeTests realtimeTests;
@@ -0,0 +1,235 @@
+#include "TestSignals.h"
+#include "ProcessStats.h"
+#include "PlaylistEntry.h"
+#include <algorithm>
+#include <array>
+#include <vector>
+
+// Long-run stability: hundreds of thousands of random load, seek, loop, skip and crossfade
+// operations over a generated playlist, rendering audio between them like the device would.
+// Every window of operations samples RSS, live allocations, open handles and per-operation
+// latency percentiles. The test fails if any of them keeps growing once warmed up.
+// PLAYER_SOAK_OPERATIONS (default 200000) and PLAYER_SOAK_SEED change the run.
+class SoakTests : public juce::UnitTest
+{
+public:
+    SoakTests() : juce::UnitTest("Soak", "soak") {}
+
+    void runTest() override
+    {
+        const int operations = getEnvInt("PLAYER_SOAK_OPERATIONS", 200000);
+        const int windowSize = juce::jmax(500, operations / 40);
+        juce::Random random(getEnvInt("PLAYER_SOAK_SEED", 1));
+
+        beginTest("Randomised playlist operations");
+        auto playlist = makePlaylist();
+        expect(!playlist.empty(), "no fixtures");
+        if(playlist.empty()) return;
+
+        PlayerAudio player(PlayerAudio::Rendering::offline);
+        player.prepareToPlay(blockSize, sampleRate);
+        juce::AudioBuffer<float> block(2, blockSize);
+        int current = 0;
+        bool looping = false;
+
+        std::array<std::vector<double>, numOperations> latencies;
+        std::vector<Window> windows;
+
+        for(int n = 1; n <= operations; ++n)
+        {
+            const auto op = (Operation)random.nextInt(numOperations);
+            const auto start = juce::Time::getHighResolutionTicks();
+            switch(op)
+            {
+                case load:
+                    current = random.nextInt((int)playlist.size());
+                    playEntry(player, playlist[(size_t)current], true);
+                    break;
+                case seek:
+                    player.setPosition(random.nextDouble() * player.getLengthInSeconds());
+                    break;
+                case loop:
+                    looping = !looping;
+                    player.setLooping(looping);
+                    break;
+                case loopRange:
+                {
+                    auto a = random.nextDouble() * player.getLengthInSeconds();
+                    if(random.nextBool()) player.setLoopRange(a, a + 0.05 + random.nextDouble() * 0.5);
+                    else player.clearLoopRange();
+                    break;
+                }
+                case skip:
+                    current = (current + (random.nextBool() ? 1 : (int)playlist.size() - 1)) % (int)playlist.size();
+                    playEntry(player, playlist[(size_t)current], false);
+                    break;
+                case speed:
+                    player.setPlaybackSpeed(0.5f + random.nextFloat() * 1.5f);
+                    break;
+                case crossfade:
+                {
+                    current = (current + 1) % (int)playlist.size();
+                    auto& entry = playlist[(size_t)current];
+                    if(player.preloadNext(player.createReaderFor(entry.file), entry.file, entry.startTime))
+                        player.crossfadeToPreloaded(random.nextDouble() * 0.2);
+                    break;
+                }
+                case startStop:
+                    if(player.isPlaying()) player.stop(); else player.start();
+                    break;
+                case numOperations:
+                    break;
+            }
+            latencies[(size_t)op].push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0);
+
+            // The device keeps pulling audio, and the GUI timer runs update(), between user actions
+            for(int b = random.nextInt(4); b >= 0; --b)
+            {
+                juce::AudioSourceChannelInfo info(&block, 0, blockSize);
+                player.getNextAudioBlock(info);
+            }
+            player.update();
+
+            if(n % windowSize == 0)
+            {
+                windows.push_back(sampleWindow(n, latencies));
+                for(auto& l : latencies) l.clear();
+            }
+        }
+
+        checkForGrowth(windows);
+    }
+
+private:
+    enum Operation { load, seek, loop, loopRange, skip, speed, crossfade, startStop, numOperations };
+    static constexpr const char* operationNames[] = { "load", "seek", "loop", "loopRange", "skip", "speed", "crossfade", "startStop" };
+    static constexpr int blockSize = 256;
+    static constexpr double sampleRate = 44100.0;
+
+    struct Window
+    {
+        int operations = 0;
+        double residentMb = 0.0;
+        double liveAllocations = 0.0;
+        double openHandles = 0.0;
+        std::array<double, numOperations> p50 {}, p99 {}, worst {};
+    };
+
+    // Plain files at several rates and lengths, plus one file split into virtual tracks
+    static std::vector<PlaylistEntry> makePlaylist()
+    {
+        auto dir = TestSignals::getFixtureDirectory();
+        std::vector<PlaylistEntry> playlist;
+        const double rates[] = { 44100.0, 48000.0, 22050.0, 96000.0, 44100.0, 48000.0 };
+        for(int i = 0; i < 6; ++i)
+        {
+            PlaylistEntry entry;
+            entry.file = TestSignals::writeFixture(dir, "soak-" + juce::String(i), rates[i], 0.3 + 0.4 * i);
+            if(entry.file.existsAsFile()) playlist.push_back(entry);
+        }
+
+        auto album = TestSignals::writeFixture(dir, "soak-album", 44100.0, 3.0);
+        for(int i = 0; i < 3 && album.existsAsFile(); ++i)
+        {
+            PlaylistEntry entry;
+            entry.file = album;
+            entry.isVirtual = true;
+            entry.title = "Chapter " + juce::String(i + 1);
+            entry.startTime = i * 1.0;
+            entry.endTime = (i + 1) * 1.0;
+            playlist.push_back(entry);
+        }
+        return playlist;
+    }
+
+    // Same rules as PlayerGUI::loadCurrentTrack: another track in the open file is only a seek
+    static void playEntry(PlayerAudio& player, const PlaylistEntry& entry, bool forceLoad)
+    {
+        if(!forceLoad && entry.file == player.getLoadedFile())
+        {
+            player.setPositionInSamples(juce::roundToInt64(entry.startTime * player.getSourceSampleRate()));
+            return;
+        }
+        if(player.loadFile(entry.file))
+        {
+            player.setPosition(entry.startTime);
+            player.start();
+        }
+    }
+
+    Window sampleWindow(int operationsSoFar, std::array<std::vector<double>, numOperations>& latencies)
+    {
+        Window w;
+        w.operations = operationsSoFar;
+        w.residentMb = (double)ProcessStats::getResidentBytes() / (1024.0 * 1024.0);
+        w.liveAllocations = (double)ProcessStats::getLiveAllocations();
+        w.openHandles = ProcessStats::getOpenHandles();
+
+        juce::String line;
+        line << "ops " << operationsSoFar << ": rss " << juce::String(w.residentMb, 1) << " MB, live allocations "
+             << (juce::int64)w.liveAllocations << ", handles " << (int)w.openHandles << ", p99 ms";
+        for(int op = 0; op < numOperations; ++op)
+        {
+            auto& l = latencies[(size_t)op];
+            if(l.empty()) continue;
+            std::sort(l.begin(), l.end());
+            w.p50[(size_t)op] = l[l.size() / 2];
+            w.p99[(size_t)op] = l[juce::jmin(l.size() - 1, l.size() * 99 / 100)];
+            w.worst[(size_t)op] = l.back();
+            line << " " << operationNames[op] << "=" << juce::String(w.p99[(size_t)op], 3);
+        }
+        logMessage(line);
+        return w;
+    }
+
+    // Compares the first and last quarter of the windows after a warm-up fifth
+    void checkForGrowth(const std::vector<Window>& windows)
+    {
+        const size_t warmup = windows.size() / 5;
+        if(windows.size() - warmup < 4)
+        {
+            logMessage("Too few windows to judge growth; run more operations");
+            return;
+        }
+
+        const size_t quarter = (windows.size() - warmup) / 4;
+        auto mean = [&](size_t from, auto field)
+        {
+            double sum = 0.0;
+            for(size_t i = from; i < from + quarter; ++i) sum += field(windows[i]);
+            return sum / (double)quarter;
+        };
+        auto early = [&](auto field) { return mean(warmup, field); };
+        auto late = [&](auto field) { return mean(windows.size() - quarter, field); };
+
+        auto rss = [](const Window& w) { return w.residentMb; };
+        auto allocs = [](const Window& w) { return w.liveAllocations; };
+        auto handles = [](const Window& w) { return w.openHandles; };
+
+        if(early(rss) > 0.0)
+            expect(late(rss) - early(rss) < juce::jmax(16.0, early(rss) * 0.25),
+                   "RSS grew from " + juce::String(early(rss), 1) + " MB to " + juce::String(late(rss), 1) + " MB");
+        if(early(allocs) >= 0.0)
+            expect(late(allocs) - early(allocs) < juce::jmax(2000.0, early(allocs) * 0.1),
+                   "live allocations grew from " + juce::String(early(allocs), 0) + " to " + juce::String(late(allocs), 0));
+        if(early(handles) >= 0.0)
+            expect(late(handles) - early(handles) <= 4.0,
+                   "open handles grew from " + juce::String(early(handles), 1) + " to " + juce::String(late(handles), 1));
+
+        for(int op = 0; op < numOperations; ++op)
+        {
+            auto p99 = [op](const Window& w) { return w.p99[(size_t)op]; };
+            expect(late(p99) <= early(p99) * 3.0 + 1.0,
+                   juce::String(operationNames[op]) + " p99 latency grew from " + juce::String(early(p99), 3)
+                   + " ms to " + juce::String(late(p99), 3) + " ms");
+        }
+    }
+
+    static int getEnvInt(const char* variable, int fallback)
+    {
+        auto value = juce::SystemStats::getEnvironmentVariable(variable, {});
+        return value.isNotEmpty() ? value.getIntValue() : fallback;
+    }
+};
+
+static SoakTests soakTests;
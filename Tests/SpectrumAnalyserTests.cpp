@@ -0,0 +1,60 @@
+#include <JuceHeader.h>
+#include "SpectrumAnalyser.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// The analyser's scale: a sine centred on an FFT bin must read its own level in dBFS.
+// The display tops out at 0 dB, so a reading that is too high shows up one step down.
+class SpectrumAnalyserTests : public juce::UnitTest
+{
+public:
+    SpectrumAnalyserTests() : juce::UnitTest("Spectrum analyser", "spectrum") {}
+
+    void runTest() override
+    {
+        beginTest("A full-scale sine reads 0 dBFS");
+        expectWithinAbsoluteError(peakDecibels(1.0f), 0.0f, 0.5f);
+
+        beginTest("A half-scale sine reads -6 dBFS");
+        expectWithinAbsoluteError(peakDecibels(0.5f), -6.02f, 0.5f);
+    }
+
+private:
+    static constexpr double sampleRate = 44100.0;
+    static constexpr int bin = 93; // about 2 kHz
+
+    float peakDecibels(float amplitude)
+    {
+        SpectrumAnalyser analyser;
+        analyser.prepare(sampleRate);
+
+        // Two frames' worth, so the last column's frame holds nothing but the sine
+        const int length = SpectrumAnalyser::fftSize * 2;
+        juce::AudioBuffer<float> sine(2, length);
+        for(int i = 0; i < length; ++i)
+        {
+            const float value = amplitude * (float)std::sin(juce::MathConstants<double>::twoPi * bin * i / SpectrumAnalyser::fftSize);
+            sine.setSample(0, i, value);
+            sine.setSample(1, i, value);
+        }
+        analyser.push(juce::AudioSourceChannelInfo(&sine, 0, length));
+
+        const int expected = length / SpectrumAnalyser::hopSize;
+        std::vector<SpectrumAnalyser::Column> columns((size_t)expected);
+        int received = 0;
+        for(auto deadline = juce::Time::getMillisecondCounter() + 2000; received < expected && juce::Time::getMillisecondCounter() < deadline;)
+        {
+            received += analyser.popColumns(columns.data() + received, expected - received);
+            juce::Thread::sleep(5);
+        }
+        expectEquals(received, expected);
+        if(received == 0) return SpectrumAnalyser::minDb;
+
+        const auto& last = columns[(size_t)received - 1];
+        const float level = *std::max_element(last.levels.begin(), last.levels.end());
+        return SpectrumAnalyser::minDb + level * (SpectrumAnalyser::maxDb - SpectrumAnalyser::minDb);
+    }
+};
+
+static SpectrumAnalyserTests spectrumAnalyserTests;
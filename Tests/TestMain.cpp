@@ -0,0 +1,22 @@
+#include <JuceHeader.h>
+#include <iostream>
+
+// Headless test runner. With a category argument only that category runs (see add_test in
+// CMakeLists.txt); without one, everything does. The exit code is the number of failures.
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser; // message manager for code that posts to it
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+
+    if(argc > 1) runner.runTestsInCategory(argv[1]);
+    else runner.runAllTests();
+
+    int failures = 0;
+    for(int i = 0; i < runner.getNumResults(); ++i)
+        failures += runner.getResult(i)->failures;
+
+    std::cout << (failures == 0 ? "All tests passed" : juce::String(failures) + " failures") << std::endl;
+    return juce::jmin(failures, 125);
+}
@@ -0,0 +1,125 @@
+#include "TestSignals.h"
+#include <cmath>
+#include <cstring>
+
+namespace TestSignals
+{
+juce::File getFixtureDirectory()
+{
+    auto dir = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("SimpleAudioPlayerTests");
+    dir.createDirectory();
+    return dir;
+}
+
+juce::File writeFixture(const juce::File& directory, const juce::String& name, double sampleRate, double seconds)
+{
+    auto file = directory.getChildFile(name + ".wav");
+    const int numSamples = juce::roundToInt(sampleRate * seconds);
+
+    juce::AudioBuffer<float> buffer(2, numSamples);
+    const double twoPi = juce::MathConstants<double>::twoPi;
+    for(int i = 0; i < numSamples; ++i)
+    {
+        const double t = i / sampleRate;
+        const double progress = (double)i / numSamples;
+        const double chirpPhase = twoPi * (100.0 * t + (5000.0 - 100.0) * t * t / (2.0 * seconds));
+        buffer.setSample(0, i, (float)(0.5 * (0.2 + 0.8 * progress) * std::sin(twoPi * 440.0 * t)));
+        buffer.setSample(1, i, (float)(0.4 * std::sin(chirpPhase)));
+    }
+
+    file.deleteFile();
+    juce::WavAudioFormat wav;
+    auto stream = std::make_unique<juce::FileOutputStream>(file);
+    std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), sampleRate, 2, 24, {}, 0));
+    if(writer == nullptr) return {};
+    stream.release(); // the writer owns it now
+    if(!writer->writeFromAudioSampleBuffer(buffer, 0, numSamples)) return {};
+    return file;
+}
+
+// ------------------- Recorder -------------------
+Recorder::Recorder(PlayerAudio& playerToRender, double rate, int blockSizeToUse)
+    : player(playerToRender), sampleRate(rate), blockSize(blockSizeToUse)
+{
+    player.prepareToPlay(blockSize, sampleRate);
+}
+
+void Recorder::render(double seconds)
+{
+    const int numSamples = juce::roundToInt(seconds * sampleRate);
+    output.setSize(2, numRendered + numSamples, true, true);
+    for(int done = 0; done < numSamples; done += blockSize)
+    {
+        juce::AudioSourceChannelInfo info(&output, numRendered + done, juce::jmin(blockSize, numSamples - done));
+        player.getNextAudioBlock(info);
+    }
+    numRendered += numSamples;
+}
+
+// ------------------- Fingerprint -------------------
+Fingerprint Fingerprint::of(const juce::AudioBuffer<float>& buffer)
+{
+    Fingerprint f;
+    f.numChannels = buffer.getNumChannels();
+    f.numSamples = buffer.getNumSamples();
+
+    // FNV-1a over the raw sample bits
+    f.hash = 14695981039346656037ull;
+    for(int ch = 0; ch < f.numChannels; ++ch)
+        for(int i = 0; i < f.numSamples; ++i)
+        {
+            juce::uint32 bits;
+            float sample = buffer.getSample(ch, i);
+            std::memcpy(&bits, &sample, sizeof(bits));
+            f.hash = (f.hash ^ bits) * 1099511628211ull;
+        }
+
+    for(int start = 0; start < f.numSamples; start += blockSize)
+    {
+        const int n = juce::jmin(blockSize, f.numSamples - start);
+        for(int ch = 0; ch < f.numChannels; ++ch)
+        {
+            f.values.push_back(buffer.getRMSLevel(ch, start, n));
+            f.values.push_back(buffer.getMagnitude(ch, start, n));
+        }
+    }
+    return f;
+}
+
+juce::String Fingerprint::toText() const
+{
+    juce::String text;
+    text << "channels " << numChannels << "\n"
+         << "samples " << numSamples << "\n"
+         << "hash " << juce::String::toHexString((juce::int64)hash) << "\n";
+    const int perBlock = numChannels * 2;
+    for(size_t i = 0; i < values.size(); ++i)
+        text << juce::String(values[i], 7) << ((int)(i + 1) % perBlock == 0 ? "\n" : " ");
+    return text;
+}
+
+bool Fingerprint::parse(const juce::String& text, Fingerprint& result)
+{
+    auto tokens = juce::StringArray::fromTokens(text, " \n\r", {});
+    tokens.removeEmptyStrings();
+    if(tokens.size() < 6 || tokens[0] != "channels" || tokens[2] != "samples" || tokens[4] != "hash")
+        return false;
+
+    result = {};
+    result.numChannels = tokens[1].getIntValue();
+    result.numSamples = tokens[3].getIntValue();
+    result.hash = (juce::uint64)tokens[5].getHexValue64();
+    for(int i = 6; i < tokens.size(); ++i)
+        result.values.push_back(tokens[i].getFloatValue());
+    return true;
+}
+
+float Fingerprint::maxDifference(const Fingerprint& other) const
+{
+    if(values.size() != other.values.size()) return 1.0f;
+    float worst = 0.0f;
+    for(size_t i = 0; i < values.size(); ++i)
+        worst = juce::jmax(worst, std::abs(values[i] - other.values[i]));
+    return worst;
+}
+}
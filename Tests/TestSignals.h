@@ -0,0 +1,47 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PlayerAudio.h"
+#include <vector>
+
+// Fixtures and helpers shared by the headless tests.
+namespace TestSignals
+{
+    // Stereo WAV: a 440 Hz sine whose level rises over the file on the left, a 100 Hz to 5 kHz
+    // chirp on the right. Every position sounds different, so a wrong seek or loop shows up.
+    juce::File writeFixture(const juce::File& directory, const juce::String& name, double sampleRate, double seconds);
+
+    juce::File getFixtureDirectory();
+
+    // Renders a PlayerAudio in fixed-size blocks, appending to one buffer
+    class Recorder
+    {
+    public:
+        Recorder(PlayerAudio& playerToRender, double sampleRate, int blockSize = 512);
+
+        void render(double seconds);
+        const juce::AudioBuffer<float>& getOutput() const { return output; }
+
+    private:
+        PlayerAudio& player;
+        double sampleRate;
+        int blockSize;
+        juce::AudioBuffer<float> output;
+        int numRendered = 0;
+    };
+
+    // Block RMS and peak per channel, plus a hash of the exact sample bits
+    struct Fingerprint
+    {
+        static constexpr int blockSize = 2048;
+
+        juce::uint64 hash = 0;
+        int numChannels = 0;
+        int numSamples = 0;
+        std::vector<float> values; // per block: rms and peak of each channel
+
+        static Fingerprint of(const juce::AudioBuffer<float>& buffer);
+        static bool parse(const juce::String& text, Fingerprint& result);
+        juce::String toText() const;
+        float maxDifference(const Fingerprint& other) const;
+    };
+}
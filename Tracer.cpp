@@ -0,0 +1,153 @@
+#include "Tracer.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    struct Event
+    {
+        const char* name = nullptr;
+        const char* category = nullptr;
+        char phase = 'X'; // 'X' complete span, 'C' counter
+        juce::int64 startTicks = 0;
+        juce::int64 durationTicks = 0;
+        double value = 0.0;
+    };
+
+    // Written only by its own thread; readers copy and then discard anything overwritten meanwhile
+    struct ThreadBuffer
+    {
+        int id = 0;
+        juce::String name;
+        std::unique_ptr<Event[]> events { new Event[(size_t)Tracer::eventsPerThread] };
+        std::atomic<juce::uint64> written { 0 };
+    };
+
+    std::atomic<bool> enabled { true };
+
+    // Buffers outlive their threads so finished jobs still show up in the dump
+    juce::SpinLock registryLock;
+    std::vector<std::unique_ptr<ThreadBuffer>> registry;
+    thread_local ThreadBuffer* localBuffer = nullptr;
+
+    ThreadBuffer& getLocalBuffer()
+    {
+        if(localBuffer != nullptr) return *localBuffer;
+
+        auto buffer = std::make_unique<ThreadBuffer>();
+        if(auto* mm = juce::MessageManager::getInstanceWithoutCreating(); mm != nullptr && mm->isThisTheMessageThread())
+            buffer->name = "Message thread";
+        else if(auto* thread = juce::Thread::getCurrentThread())
+            buffer->name = thread->getThreadName();
+
+        const juce::SpinLock::ScopedLockType sl(registryLock);
+        buffer->id = (int)registry.size() + 1;
+        if(buffer->name.isEmpty()) buffer->name = "Thread " + juce::String(buffer->id);
+        localBuffer = buffer.get();
+        registry.push_back(std::move(buffer));
+        return *localBuffer;
+    }
+
+    void append(const Event& event)
+    {
+        auto& buffer = getLocalBuffer();
+        auto index = buffer.written.load(std::memory_order_relaxed);
+        buffer.events[(size_t)(index % Tracer::eventsPerThread)] = event;
+        buffer.written.store(index + 1, std::memory_order_release);
+    }
+}
+
+// ------------------- Recording -------------------
+Tracer::Span::Span(const char* spanName, const char* spanCategory)
+    : name(spanName), category(spanCategory),
+      startTicks(enabled.load(std::memory_order_relaxed) ? juce::Time::getHighResolutionTicks() : 0)
+{
+}
+
+Tracer::Span::~Span()
+{
+    if(startTicks == 0) return;
+    Event event;
+    event.name = name;
+    event.category = category;
+    event.startTicks = startTicks;
+    event.durationTicks = juce::Time::getHighResolutionTicks() - startTicks;
+    append(event);
+}
+
+void Tracer::counter(const char* name, double value)
+{
+    if(!enabled.load(std::memory_order_relaxed)) return;
+    Event event;
+    event.name = name;
+    event.category = "counter";
+    event.phase = 'C';
+    event.startTicks = juce::Time::getHighResolutionTicks();
+    event.value = value;
+    append(event);
+}
+
+void Tracer::setEnabled(bool shouldRecord) { enabled.store(shouldRecord); }
+bool Tracer::isEnabled() { return enabled.load(); }
+
+// ------------------- Export -------------------
+juce::File Tracer::createTraceFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+               .getChildFile("SimpleAudioPlayer").getChildFile("traces")
+               .getNonexistentChildFile("trace-" + juce::Time::getCurrentTime().formatted("%Y%m%d-%H%M%S"), ".json");
+}
+
+bool Tracer::writeChromeTrace(const juce::File& file)
+{
+    std::vector<ThreadBuffer*> buffers;
+    {
+        const juce::SpinLock::ScopedLockType sl(registryLock);
+        for(auto& b : registry) buffers.push_back(b.get());
+    }
+
+    const double microsPerTick = 1.0e6 / (double)juce::Time::getHighResolutionTicksPerSecond();
+    const int pid = 1;
+    juce::MemoryOutputStream json;
+    json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separator = [&] { if(!first) json << ",\n"; first = false; };
+
+    std::vector<Event> events;
+    for(auto* buffer : buffers)
+    {
+        separator();
+        json << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << buffer->id
+             << ",\"args\":{\"name\":" << juce::JSON::toString(buffer->name) << "}}";
+
+        // Copy the newest events, then drop any the owner overwrote while we were copying
+        auto end = buffer->written.load(std::memory_order_acquire);
+        auto begin = end > (juce::uint64)eventsPerThread ? end - (juce::uint64)eventsPerThread : 0;
+        events.clear();
+        for(auto i = begin; i < end; ++i)
+            events.push_back(buffer->events[(size_t)(i % eventsPerThread)]);
+        auto after = buffer->written.load(std::memory_order_acquire);
+        auto firstIntact = after > (juce::uint64)eventsPerThread ? after - (juce::uint64)eventsPerThread : 0;
+        auto skip = (size_t)std::min<juce::uint64>(firstIntact > begin ? firstIntact - begin : 0, events.size());
+
+        for(size_t i = skip; i < events.size(); ++i)
+        {
+            auto& e = events[i];
+            separator();
+            json << "{\"ph\":\"" << juce::String::charToString(e.phase) << "\",\"name\":\"" << e.name
+                 << "\",\"cat\":\"" << e.category << "\",\"pid\":" << pid << ",\"tid\":" << buffer->id
+                 << ",\"ts\":" << juce::String((double)e.startTicks * microsPerTick, 1);
+            if(e.phase == 'X')
+                json << ",\"dur\":" << juce::String((double)e.durationTicks * microsPerTick, 1);
+            else
+                json << ",\"args\":{\"value\":" << juce::String(e.value) << "}";
+            json << "}";
+        }
+    }
+    json << "\n]}\n";
+
+    file.getParentDirectory().createDirectory();
+    return file.replaceWithData(json.getData(), json.getDataSize());
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Always-on flight recorder for the load, seek and decode paths.
+// - Span marks the lifetime of a scope and counter() a sampled value. Both are appended to
+//   a fixed ring owned by the calling thread: no locks and no allocation once the thread
+//   has recorded its first event.
+// - writeChromeTrace() dumps the last eventsPerThread events of every thread as Chrome trace
+//   JSON, which chrome://tracing and ui.perfetto.dev open directly.
+// Names and categories must be string literals; only the pointers are stored.
+class Tracer
+{
+public:
+    static constexpr int eventsPerThread = 8192;
+
+    class Span
+    {
+    public:
+        explicit Span(const char* name, const char* category = "player");
+        ~Span();
+
+    private:
+        const char* name;
+        const char* category;
+        juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE(Span)
+    };
+
+    static void counter(const char* name, double value);
+
+    static void setEnabled(bool shouldRecord);
+    static bool isEnabled();
+
+    static bool writeChromeTrace(const juce::File& file);
+    // traces/trace-<date>.json in the app's data folder
+    static juce::File createTraceFile();
+};
@@ -0,0 +1,20 @@
+#include "TrackTags.h"
+#include "Tracer.h"
+#include <taglib/fileref.h>
+#include <taglib/tag.h>
+
+TrackTags TrackTags::read(const juce::File& file)
+{
+    const Tracer::Span span("readTags", "tags");
+    TrackTags tags;
+    TagLib::FileRef f(file.getFullPathName().toStdString().c_str());
+    if(!f.isNull() && f.tag())
+    {
+        auto* tag = f.tag();
+        tags.valid = true;
+        tags.title = tag->title().isEmpty()?file.getFileName():juce::String(juce::CharPointer_UTF8(tag->title().toCString(true)));
+        tags.artist = tag->artist().isEmpty()?"Unknown Artist":juce::String(juce::CharPointer_UTF8(tag->artist().toCString(true)));
+        tags.album = tag->album().isEmpty()?"Unknown Album":juce::String(juce::CharPointer_UTF8(tag->album().toCString(true)));
+    }
+    return tags;
+}
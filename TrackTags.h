@@ -0,0 +1,13 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Title, artist and album of an audio file, read through TagLib.
+// valid is false if TagLib could not open the file or it has no tag.
+struct TrackTags
+{
+    bool valid = false;
+    juce::String title, artist, album;
+
+    // Blocking; runs on the scheduler
+    static TrackTags read(const juce::File& file);
+};
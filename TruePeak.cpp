@@ -0,0 +1,63 @@
+#include "TruePeak.h"
+#include <cmath>
+
+TruePeak::TruePeak() : phases(getPhases())
+{
+}
+
+// Built once, by whichever TruePeak is constructed first
+const TruePeak::Phases& TruePeak::getPhases()
+{
+    static const Phases phases = []
+    {
+        // Phase p estimates the signal p/4 of a sample after the centre tap
+        Phases result {};
+        constexpr int centre = tapsPerPhase / 2;
+        for(int p = 1; p < oversampling; ++p)
+        {
+            auto& taps = result[(size_t)p];
+            float sum = 0.0f;
+            for(int j = 0; j < tapsPerPhase; ++j)
+            {
+                double t = (double)(j - centre) + (double)p / oversampling;
+                double sinc = std::sin(juce::MathConstants<double>::pi * t) / (juce::MathConstants<double>::pi * t);
+                double window = 0.5 + 0.5 * std::cos(juce::MathConstants<double>::pi * t / (centre + 1.0));
+                taps[(size_t)j] = (float)(sinc * window);
+                sum += taps[(size_t)j];
+            }
+            for(auto& tap : taps)
+                tap /= sum;
+        }
+        return result;
+    }();
+    return phases;
+}
+
+void TruePeak::reset()
+{
+    history.fill(0.0f);
+    historyPos = 0;
+}
+
+float TruePeak::process(const float* data, int numSamples)
+{
+    float truePeak = 0.0f;
+    for(int i = 0; i < numSamples; ++i)
+    {
+        history[(size_t)historyPos] = history[(size_t)(historyPos + tapsPerPhase)] = data[i];
+        historyPos = (historyPos + 1) % tapsPerPhase;
+        truePeak = juce::jmax(truePeak, std::abs(data[i]));
+
+        // Oldest to newest: history[historyPos .. historyPos + tapsPerPhase)
+        const float* window = history.data() + historyPos;
+        for(int p = 1; p < oversampling; ++p)
+        {
+            const auto& taps = phases[(size_t)p];
+            float y = 0.0f;
+            for(int j = 0; j < tapsPerPhase; ++j)
+                y += window[tapsPerPhase - 1 - j] * taps[(size_t)j];
+            truePeak = juce::jmax(truePeak, std::abs(y));
+        }
+    }
+    return truePeak;
+}
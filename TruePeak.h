@@ -0,0 +1,28 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+
+// True peak of one channel (BS.1770 style): the largest of the samples and the three points
+// between each pair of them, interpolated by a 4x windowed-sinc polyphase filter with unity
+// gain at DC. Used by the output meter, a block at a time on the audio thread, and by the
+// loudness analyser over whole files, so both report the same figure for the same audio.
+class TruePeak
+{
+public:
+    static constexpr int oversampling = 4;
+    static constexpr int tapsPerPhase = 12;
+
+    TruePeak();
+
+    // Continues from the samples before data; no allocation, no locks
+    float process(const float* data, int numSamples);
+    void reset();
+
+private:
+    using Phases = std::array<std::array<float, tapsPerPhase>, oversampling>;
+    static const Phases& getPhases();
+
+    const Phases& phases;
+    std::array<float, tapsPerPhase * 2> history {}; // written twice so taps read contiguously
+    int historyPos = 0;
+};